@@ -0,0 +1,74 @@
+#include <rlottie.h>
+
+#include<iostream>
+#include<string>
+
+class App {
+public:
+    int compile()
+    {
+        auto player = rlottie::Animation::loadFromFile(fileName, false);
+        if (!player) return help();
+
+        if (!player->saveCompiled(binName)) {
+            std::cout<<"Failed to write : "<<binName<<std::endl;
+            return 1;
+        }
+        return result();
+    }
+
+    int setup(int argc, char **argv)
+    {
+        if (argc < 2) return help();
+
+        fileName = argv[1];
+        if (!jsonFile()) return help();
+
+        if (argc > 2) {
+            binName = argv[2];
+        } else {
+            binName = basename(fileName);
+            binName.replace(binName.size() - 5, 5, ".bin");
+        }
+        return 0;
+    }
+
+private:
+    std::string basename(const std::string &str)
+    {
+        return str.substr(str.find_last_of("/\\") + 1);
+    }
+
+    bool jsonFile() {
+        std::string extn = ".json";
+        if ( fileName.size() <= extn.size() ||
+             fileName.substr(fileName.size()- extn.size()) != extn )
+            return false;
+
+        return true;
+    }
+
+    int result() {
+        std::cout<<"Generated compiled file : "<<binName<<std::endl;
+        return 0;
+    }
+
+    int help() {
+        std::cout<<"Usage: \n   lottie2bin [lottieFileName] [outputFileName]\n\nExamples: \n    $ lottie2bin input.json\n    $ lottie2bin input.json input.bin\n\n";
+        return 1;
+    }
+
+private:
+    std::string fileName;
+    std::string binName;
+};
+
+int
+main(int argc, char **argv)
+{
+    App app;
+
+    if (app.setup(argc, argv)) return 1;
+
+    return app.compile();
+}
@@ -3,7 +3,9 @@
 #include <dirent.h>
 #include <algorithm>
 #include <chrono>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <cstring>
 
 #include <rlottie.h>
@@ -14,8 +16,17 @@ static bool isJsonFile(const char *filename) {
   return !strcmp(dot + 1, "json");
 }
 
+// a layer with a track matte carries the "tt" attribute.
+static bool hasTrackMatte(const std::string &filename)
+{
+    std::ifstream file(filename);
+    std::string content((std::istreambuf_iterator<char>(file)),
+                        std::istreambuf_iterator<char>());
+    return content.find("\"tt\":") != std::string::npos;
+}
+
 static std::vector<std::string>
-jsonFiles(const std::string &dirName)
+jsonFiles(const std::string &dirName, bool matteOnly)
 {
     DIR *d;
     struct dirent *dir;
@@ -23,8 +34,10 @@ jsonFiles(const std::string &dirName)
     d = opendir(dirName.c_str());
     if (d) {
       while ((dir = readdir(d)) != NULL) {
-        if (isJsonFile(dir->d_name))
-          result.push_back(dirName + dir->d_name);
+        if (!isJsonFile(dir->d_name)) continue;
+        std::string filename = dirName + dir->d_name;
+        if (!matteOnly || hasTrackMatte(filename))
+          result.push_back(filename);
       }
       closedir(d);
     }
@@ -37,12 +50,12 @@ jsonFiles(const std::string &dirName)
 class Renderer
 {
 public:
-    explicit Renderer(const std::string& filename)
+    explicit Renderer(const std::string& filename, size_t size)
     {
         _animation = rlottie::Animation::loadFromFile(filename);
         _frames = _animation->totalFrame();
-        _buffer = std::make_unique<uint32_t[]>(100 * 100);
-        _surface = rlottie::Surface(_buffer.get(), 100, 100, 100 * 4);
+        _buffer = std::make_unique<uint32_t[]>(size * size);
+        _surface = rlottie::Surface(_buffer.get(), size, size, size * 4);
     }
     void render()
     {
@@ -70,10 +83,11 @@ private:
 class PerfTest
 {
 public:
-    explicit PerfTest(size_t resourceCount, size_t iterations):
-        _resourceCount(resourceCount), _iterations(iterations)
+    explicit PerfTest(size_t resourceCount, size_t iterations, size_t size,
+                      bool matteOnly):
+        _resourceCount(resourceCount), _iterations(iterations), _size(size)
     {
-        _resourceList = jsonFiles(std::string(DEMO_DIR));
+        _resourceList = jsonFiles(std::string(DEMO_DIR), matteOnly);
     }
     void test(bool async)
     {
@@ -86,7 +100,8 @@ public:
         std::cout<< " Test Finished.\n";
         std::cout<< " \nPerformance Report: \n\n";
         std::cout<< " \t Resource Rendered per Frame : "<< _resourceCount <<"\n";
-        std::cout<< " \t Render Buffer Size          : (100 X 100) \n";
+        std::cout<< " \t Resource Files              : "<< _resourceList.size() <<"\n";
+        std::cout<< " \t Render Buffer Size          : ("<< _size <<" X "<< _size <<") \n";
         std::cout<< " \t Render Mode                 : "<< (async ? "Async" : "Sync")<<"\n";
         std::cout<< " \t Total Frames Rendered       : "<< _iterations<<"\n";
         std::cout<< " \t Total Render Time           : "<< secs.count()<<"sec\n";
@@ -99,7 +114,7 @@ private:
     {
         for (auto i = 0u; i < _resourceCount; i++) {
             auto index = i % _resourceList.size();
-            _renderers.push_back(std::make_unique<Renderer>(_resourceList[index]));
+            _renderers.push_back(std::make_unique<Renderer>(_resourceList[index], _size));
         }
     }
 
@@ -118,6 +133,7 @@ private:
 private:
     size_t  _resourceCount;
     size_t  _iterations;
+    size_t  _size;
 
     std::vector<std::string>                 _resourceList;
     std::vector<std::unique_ptr<Renderer>>   _renderers;
@@ -125,17 +141,21 @@ private:
 
 static int help()
 {
-    std::cout<<"\nUsage : ./perf [--sync] [-c] [resource count] [-i] [iteration count] \n";
+    std::cout<<"\nUsage : ./perf [--sync] [--matte] [-c] [resource count] [-i] [iteration count] [-s] [buffer size] \n";
     std::cout<<"\nExample : ./perf -c 50 -i 100 \n";
-    std::cout<<"\n\t runs perf test for 100 iterations. renders 50 resource per iteration\n\n";
+    std::cout<<"\n\t runs perf test for 100 iterations. renders 50 resource per iteration\n";
+    std::cout<<"\nExample : ./perf --matte -s 512 \n";
+    std::cout<<"\n\t renders only the resources with track mattes into 512 X 512 buffers\n\n";
     return 0;
 }
 int
 main(int argc, char ** argv)
 {
     bool async = true;
+    bool matteOnly = false;
     size_t resourceCount = 250;
     size_t iterations = 500;
+    size_t size = 100;
     auto index = 0;
 
     while (index < argc) {
@@ -145,16 +165,21 @@ main(int argc, char ** argv)
           return help();
       } else if (!strcmp(option,"--sync")) {
           async = false;
+      } else if (!strcmp(option,"--matte")) {
+          matteOnly = true;
       } else if (!strcmp(option,"-c")) {
          resourceCount = (index < argc) ? atoi(argv[index]) : resourceCount;
          index++;
       } else if (!strcmp(option,"-i")) {
          iterations = (index < argc) ? atoi(argv[index]) : iterations;
          index++;
+      } else if (!strcmp(option,"-s")) {
+         size = (index < argc) ? atoi(argv[index]) : size;
+         index++;
       }
    }
 
-    PerfTest obj(resourceCount, iterations);
+    PerfTest obj(resourceCount, iterations, size, matteOnly);
     obj.test(async);
     return 0;
 }
@@ -23,7 +23,9 @@
 #ifndef _RLOTTIE_H_
 #define _RLOTTIE_H_
 
+#include <functional>
 #include <future>
+#include <string>
 #include <vector>
 #include <memory>
 
@@ -64,6 +66,215 @@ namespace rlottie {
  */
 RLOTTIE_API void configureModelCacheSize(size_t cacheSize);
 
+/**
+ *  @brief Configures the memory budget of the rlottie model cache.
+ *
+ *  Each cached model is accounted with the memory it holds (its object
+ *  arena and embedded image data). Decoded images are accounted in the
+ *  image cache, see configureImageCacheSize(). The least recently used models are
+ *  evicted until both this budget and the cache size configured with
+ *  configureModelCacheSize() are met.
+ *
+ *  @param[in] bytes  Maximum bytes held by the cached models.
+ *
+ *  @note the budget is unlimited by default. Configuring it with 0
+ *        disables the cache.
+ *
+ *  @internal
+ */
+RLOTTIE_API void configureModelCacheMemory(size_t bytes);
+
+/**
+ *  @brief Evicts least recently used models from the model cache.
+ *
+ *  Evicts models until the cache holds at most the given number of bytes.
+ *  The configured budget is not changed.
+ *
+ *  @param[in] bytes  Maximum bytes the cache may hold afterwards.
+ *
+ *  @internal
+ */
+RLOTTIE_API void trimModelCache(size_t bytes);
+
+/**
+ *  @brief Statistics of the rlottie model cache.
+ *
+ *  @see modelCacheStats()
+ *
+ *  @internal
+ */
+struct ModelCacheStats {
+    bool   enabled{false};  // false if rlottie is built without the cache
+    size_t entries{0};      // cached models
+    size_t bytes{0};        // bytes held by the cached models
+    size_t hits{0};         // lookups served from the cache
+    size_t misses{0};       // lookups that had to parse the resource
+    size_t evictions{0};    // models dropped to honor the cache limits
+};
+
+/**
+ *  @brief Returns the current statistics of the model cache.
+ *
+ *  @return the number of entries and bytes in the cache as well as the
+ *          hit, miss and eviction counters since startup. All of them stay
+ *          0 and enabled is false if rlottie is built without the cache.
+ *
+ *  @internal
+ */
+RLOTTIE_API ModelCacheStats modelCacheStats();
+
+/**
+ *  @brief Configures rlottie rendered frame cache policy.
+ *
+ *  Keeps recently rendered frames of animations loaded with cachePolicy
+ *  enabled, so that several players showing the same animation at the
+ *  same size copy the pixels instead of rendering the frame again.
+ *  Frames are keyed by animation, frame number, surface geometry and the
+ *  property overrides set with setValue(). The least recently used frames
+ *  are evicted once the budget is exceeded.
+ *
+ *  @param[in] bytes  Maximum number of pixel bytes the cache may hold.
+ *
+ *  @note the cache is disabled by default. Configure it with 0 to disable
+ *        it again and flush all the cached frames.
+ *
+ *  @internal
+ */
+RLOTTIE_API void configureFrameCacheSize(size_t bytes);
+
+/**
+ *  @brief Configures the rlottie decoded image cache.
+ *
+ *  Image assets are decoded when an image layer is rendered the first
+ *  time. The decoded images are kept in a cache shared by all animations
+ *  and keyed by the image path or the embedded image data, so an image
+ *  used by several animations is decoded once. The least recently used
+ *  images are evicted once the budget is exceeded.
+ *
+ *  @param[in] bytes  Maximum number of pixel bytes the cache may hold.
+ *
+ *  @note the default budget is 64 MB. Configure it with 0 to disable the
+ *        cache and flush all the cached images.
+ *
+ *  @internal
+ */
+RLOTTIE_API void configureImageCacheSize(size_t bytes);
+
+/**
+ *  @brief Configures the rlottie shape coverage (rle) cache.
+ *
+ *  The coverage of a shape is computed from its path, fill rule or stroke
+ *  parameters and clip. Identical shapes rasterized a second time, for
+ *  example by several animations of the same content rendered at the
+ *  same size, share the cached coverage instead of rasterizing the shape
+ *  again. The least recently used entries are evicted once the budget is
+ *  exceeded.
+ *
+ *  @param[in] bytes  Maximum number of bytes the cache may hold.
+ *
+ *  @note the default budget is 8 MB. Configure it with 0 to disable the
+ *        cache and flush all the cached shapes.
+ *
+ *  @internal
+ */
+RLOTTIE_API void configureRleCacheSize(size_t bytes);
+
+/**
+ *  @brief Configures the rlottie offscreen surface cache.
+ *
+ *  Track mattes and layers with transparency over overlapping content are
+ *  rendered into offscreen surfaces first. The surfaces are kept in a pool
+ *  shared by all the animations and reused by the following frames. The
+ *  least recently released surfaces are freed once the budget is exceeded,
+ *  and surfaces not reused for a few seconds are freed as well.
+ *
+ *  @param[in] bytes  Maximum number of bytes the idle surfaces may hold.
+ *
+ *  @note the default budget is 32 MB. Configure it with 0 to free every
+ *        surface as soon as it is not needed anymore.
+ *
+ *  @internal
+ */
+RLOTTIE_API void configureSurfaceCacheSize(size_t bytes);
+
+/**
+ *  @brief Frees idle surfaces of the offscreen surface cache.
+ *
+ *  Frees the least recently released surfaces until the idle ones hold at
+ *  most the given number of bytes, for example when the application goes
+ *  to the background. The configured budget is not changed.
+ *
+ *  @param[in] bytes  Maximum bytes the idle surfaces may hold afterwards.
+ *
+ *  @internal
+ */
+RLOTTIE_API void trimSurfaceCache(size_t bytes);
+
+/**
+ *  @brief Statistics of the rlottie offscreen surface cache.
+ *
+ *  @see surfaceCacheStats()
+ *
+ *  @internal
+ */
+struct SurfaceCacheStats {
+    size_t entries{0};    // idle surfaces kept for reuse
+    size_t bytes{0};      // bytes held by the idle surfaces
+    size_t inUse{0};      // bytes of the surfaces being rendered into
+    size_t hits{0};       // requests served with a kept surface
+    size_t misses{0};     // requests that had to allocate a surface
+    size_t evictions{0};  // surfaces freed for the budget or being idle
+};
+
+/**
+ *  @brief Returns the current statistics of the offscreen surface cache.
+ *
+ *  @return the number of idle surfaces and the bytes they hold, the bytes
+ *          in use as well as the hit, miss and eviction counters since
+ *          startup.
+ *
+ *  @internal
+ */
+RLOTTIE_API SurfaceCacheStats surfaceCacheStats();
+
+/**
+ *  @brief Configuration of the rlottie thread pool.
+ *
+ *  @see configureThreadPool()
+ *
+ *  @internal
+ */
+struct ThreadPoolConfig {
+    unsigned         threads{0};      // worker threads, 0 for one per core
+    std::vector<int> cpuAffinity;     // cpus the workers may run on
+    std::string      threadName{"rlottie"};  // workers are named name-N
+    int              priority{0};     // nice value of the workers
+    // when set, every task is handed to it and no thread is created.
+    std::function<void(std::function<void()>)> executor;
+};
+
+/**
+ *  @brief Configures the thread pool shared by all the animations.
+ *
+ *  Asynchronous render requests and the path rasterization tasks all
+ *  run on a single pool, so rlottie never uses more than the configured
+ *  number of threads. Instead of the pool, an application can provide
+ *  its own executor which then runs all of the rlottie tasks; threads
+ *  tells rlottie how many of them may run in parallel.
+ *
+ *  @param[in] config  Size, affinity, name and priority of the workers.
+ *
+ *  @return true on success, false if the pool is already running.
+ *
+ *  @note The pool is started by the first render, so it has to be
+ *        configured before that. CPU affinity, thread names and priority
+ *        are only applied on Linux. Without thread support in the build
+ *        every task runs on the calling thread.
+ *
+ *  @internal
+ */
+RLOTTIE_API bool configureThreadPool(const ThreadPoolConfig &config);
+
 struct Color {
     Color() = default;
     Color(float r, float g , float b):_r(r), _g(g), _b(b){}
@@ -96,6 +307,21 @@ private:
     float _y{0};
 };
 
+struct Rect {
+    Rect() = default;
+    Rect(size_t x, size_t y, size_t w, size_t h):_x(x), _y(y), _w(w), _h(h){}
+    size_t x() const {return _x;}
+    size_t y() const {return _y;}
+    size_t w() const {return _w;}
+    size_t h() const {return _h;}
+    bool   empty() const {return !_w || !_h;}
+private:
+    size_t _x{0};
+    size_t _y{0};
+    size_t _w{0};
+    size_t _h{0};
+};
+
 struct FrameInfo {
     explicit FrameInfo(uint32_t frame): _frameNo(frame){}
     uint32_t curFrame() const {return _frameNo;}
@@ -116,6 +342,14 @@ enum class Property {
     TrOpacity      /*!< Transform Opacity property of Layer and Group object , value type is float [ 0 .. 100] */
 };
 
+/**
+ *  @brief How image layers are sampled when they are scaled or rotated.
+ */
+enum class ImageQuality {
+    Fast,   /*!< Nearest neighbour sampling, the default */
+    Smooth  /*!< Bilinear filtering, looks better when images are scaled down */
+};
+
 struct Color_Type{};
 struct Point_Type{};
 struct Size_Type{};
@@ -268,6 +502,12 @@ using LayerInfoList = std::vector<std::tuple<std::string, int , int>>;
 
 using ColorFilter = std::function<void(float &r , float &g, float &b)>;
 
+/**
+ *  @brief Returns the Surface in which the frame @p frameNo has to be drawn.
+ *  @see Animation::renderRange
+ */
+using SurfaceProvider = std::function<Surface(size_t frameNo)>;
+
 class RLOTTIE_API Animation {
 public:
 
@@ -325,6 +565,42 @@ public:
     static std::unique_ptr<Animation>
     loadFromData(std::string jsonData, std::string resourcePath, ColorFilter filter);
 
+    /**
+     *  @brief Constructs an animation object from a compiled model file.
+     *
+     *  Loads a file written by saveCompiled() without parsing any JSON.
+     *  The file has to be produced by the same version of the library.
+     *
+     *  @param[in] path Compiled model file path.
+     *  @param[in] cachePolicy whether to cache or not the model data.
+     *
+     *  @return Animation object that can render the contents of the
+     *          compiled model, or null if the file is not a valid
+     *          compiled model.
+     *
+     *  @see saveCompiled()
+     *
+     *  @internal
+     */
+    static std::unique_ptr<Animation>
+    loadCompiled(const std::string &path, bool cachePolicy=true);
+
+    /**
+     *  @brief Writes the parsed model of the animation to a file.
+     *
+     *  The file stores the fully built model including decoded image
+     *  assets, so it can be loaded later with loadCompiled() without
+     *  parsing the JSON resource again. Values set with setValue() are
+     *  not part of the model and are not saved.
+     *
+     *  @param[in] path Compiled model file path.
+     *
+     *  @return true if the file was written.
+     *
+     *  @internal
+     */
+    bool saveCompiled(const std::string &path) const;
+
     /**
      *  @brief Returns default framerate of the Lottie resource.
      *
@@ -421,6 +697,110 @@ public:
      */
     void              renderSync(size_t frameNo, Surface surface, bool keepAspectRatio=true);
 
+    /**
+     *  @brief Renders the content to surface synchronously, repainting only
+     *         the area that changed since the frame the surface buffer got
+     *         in its last renderIncremental() call.
+     *         Saves most of the pixel work of animations in which only a
+     *         small part moves from one frame to the next.
+     *
+     *  @param[in] frameNo Content corresponds to the @p frameNo needs to be drawn
+     *  @param[in] surface Surface in which content will be drawn
+     *  @param[in] keepAspectRatio whether to keep the aspect ratio while scaling the content.
+     *
+     *  @return the area of the surface that was repainted, empty if the
+     *          buffer already holds the frame.
+     *
+     *  @note The buffer must not be modified in between the calls. Up to
+     *        4 buffers used in rotation (a swap chain) are tracked, a buffer
+     *        that is not known or a change of the surface geometry
+     *        repaints the whole surface.
+     *
+     *  @internal
+     */
+    Rect              renderIncremental(size_t frameNo, Surface surface, bool keepAspectRatio=true);
+
+    /**
+     *  @brief Renders the content at the given time to surface Asynchronously.
+     *         Unlike render() the time is not rounded to a frame, the
+     *         animated properties are interpolated in between the frames.
+     *         That gives a smooth playback on displays whose refresh rate
+     *         is higher than the frame rate of the resource.
+     *
+     *  @param[in] seconds time in the animation, clamped to [0 ... duration()]
+     *  @param[in] surface Surface in which content will be drawn
+     *  @param[in] keepAspectRatio whether to keep the aspect ratio while scaling the content.
+     *
+     *  @return future that will hold the result when rendering finished.
+     *
+     *  for Synchronus rendering @see renderAtTimeSync
+     *
+     *  @internal
+     */
+    std::future<Surface> renderAtTime(double seconds, Surface surface, bool keepAspectRatio=true);
+
+    /**
+     *  @brief Renders the content at the given time to surface synchronously.
+     *
+     *  @param[in] seconds time in the animation, clamped to [0 ... duration()]
+     *  @param[in] surface Surface in which content will be drawn
+     *  @param[in] keepAspectRatio whether to keep the aspect ratio while scaling the content.
+     *
+     *  @see renderAtTime
+     *  @internal
+     */
+    void              renderAtTimeSync(double seconds, Surface surface, bool keepAspectRatio=true);
+
+    /**
+     *  @brief Splits the rendering of a single frame into horizontal bands
+     *         which are drawn in parallel by the render threads.
+     *         Helps the latency of big (full screen) animations, small ones
+     *         are better rendered on a single thread.
+     *
+     *  @param[in] bands number of bands a frame is split into.
+     *             0 uses one band per hardware thread, 1 (default) renders
+     *             the frame on a single thread.
+     *
+     *  @note bands are at least 32 pixels high, so a small surface may use
+     *        less bands than requested.
+     *
+     *  @internal
+     */
+    void setRenderBands(size_t bands);
+
+    /**
+     *  @brief Sets the sampling quality of transformed image layers.
+     *
+     *  @param[in] quality  image sampling quality.
+     *
+     *  @note Default image quality is ImageQuality::Fast.
+     *
+     *  @internal
+     */
+    void setImageQuality(ImageQuality quality);
+
+    /**
+     *  @brief Renders all the frames from @p first to @p last (inclusive)
+     *         synchronously.
+     *         The rasterization of the next frame runs while the current
+     *         frame is drawn, which gives a much better throughput than
+     *         calling renderSync() for each frame. Useful for offline export
+     *         or to fill a sprite cache.
+     *
+     *  @param[in] first    first frame to render.
+     *  @param[in] last     last frame to render.
+     *  @param[in] provider returns the Surface for a given frame number.
+     *  @param[in] keepAspectRatio whether to keep the aspect ratio while scaling the content.
+     *
+     *  @note The provider is asked for the surface of the next frame before the
+     *        current frame is drawn, so all the surfaces have to stay valid
+     *        until the call returns.
+     *
+     *  @internal
+     */
+    void renderRange(size_t first, size_t last, const SurfaceProvider &provider,
+                     bool keepAspectRatio=true);
+
     /**
      *  @brief Returns root layer of the composition updated with
      *         content of the Lottie resource at frame number @p frameNo.
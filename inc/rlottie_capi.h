@@ -231,6 +231,49 @@ RLOTTIE_API size_t lottie_animation_get_frame_at_pos(const Lottie_Animation *ani
  */
 RLOTTIE_API void lottie_animation_render(Lottie_Animation *animation, size_t frame_num, uint32_t *buffer, size_t width, size_t height, size_t bytes_per_line);
 
+/**
+ *  @brief Request to render the content at the time @p seconds to buffer @p buffer.
+ *
+ *  The time is not rounded to a frame, properties are interpolated in between
+ *  the frames for a smooth playback on high refresh rate displays.
+ *
+ *  @param[in] animation Animation object.
+ *  @param[in] seconds time in the animation, clamped to [ 0.0 .. duration ].
+ *  @param[in] buffer surface buffer use for rendering.
+ *  @param[in] width width of the surface
+ *  @param[in] height height of the surface
+ *  @param[in] bytes_per_line stride of the surface in bytes.
+ *
+ *
+ *  @ingroup Lottie_Animation
+ *  @internal
+ */
+RLOTTIE_API void lottie_animation_render_at_time(Lottie_Animation *animation, double seconds, uint32_t *buffer, size_t width, size_t height, size_t bytes_per_line);
+
+/**
+ *  @brief Request to render the content of the frame @p frame_num to buffer @p buffer,
+ *  repainting only the area that changed since the last incremental render
+ *  into the same buffer.
+ *
+ *  @param[in] animation Animation object.
+ *  @param[in] frame_num the frame number needs to be rendered.
+ *  @param[in] buffer surface buffer use for rendering.
+ *  @param[in] width width of the surface
+ *  @param[in] height height of the surface
+ *  @param[in] bytes_per_line stride of the surface in bytes.
+ *  @param[out] x x position of the repainted area, can be NULL.
+ *  @param[out] y y position of the repainted area, can be NULL.
+ *  @param[out] w width of the repainted area, 0 if nothing changed. can be NULL.
+ *  @param[out] h height of the repainted area, 0 if nothing changed. can be NULL.
+ *
+ *  @note the buffer must not be modified in between the calls, see
+ *  rlottie::Animation::renderIncremental().
+ *
+ *  @ingroup Lottie_Animation
+ *  @internal
+ */
+RLOTTIE_API void lottie_animation_render_incremental(Lottie_Animation *animation, size_t frame_num, uint32_t *buffer, size_t width, size_t height, size_t bytes_per_line, size_t *x, size_t *y, size_t *w, size_t *h);
+
 /**
  *  @brief Request to render the content of the frame @p frame_num to buffer @p buffer asynchronously.
  *
@@ -321,6 +364,37 @@ RLOTTIE_API const LOTMarkerList* lottie_animation_get_markerlist(Lottie_Animatio
  */
 RLOTTIE_API void lottie_configure_model_cache_size(size_t cacheSize);
 
+/**
+ *  @brief Configures rlottie rendered frame cache policy.
+ *
+ *  Keeps recently rendered frames so that several animations showing the
+ *  same content at the same size reuse the pixels instead of rendering
+ *  the frame again. Setting it to 0 will disable the cache as well as
+ *  flush all the previously cached frames.
+ *
+ *  @param[in] bytes  Maximum number of pixel bytes the cache may hold.
+ *
+ *  @note the cache is disabled by default.
+ *
+ *  @internal
+ */
+RLOTTIE_API void lottie_configure_frame_cache_size(size_t bytes);
+
+/**
+ *  @brief Configures the number of threads rlottie renders with.
+ *
+ *  All the asynchronous rendering and rasterization tasks share one
+ *  thread pool of this size. It has to be configured before the first
+ *  frame is rendered.
+ *
+ *  @param[in] threads  Number of worker threads, 0 for one per core.
+ *
+ *  @return 1 on success, 0 if the pool is already running.
+ *
+ *  @internal
+ */
+RLOTTIE_API int lottie_configure_thread_pool(size_t threads);
+
 #ifdef __cplusplus
 }
 #endif
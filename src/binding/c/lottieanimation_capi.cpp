@@ -168,6 +168,42 @@ lottie_animation_render(Lottie_Animation_S *animation,
     animation->mAnimation->renderSync(frame_number, surface);
 }
 
+RLOTTIE_API void
+lottie_animation_render_at_time(Lottie_Animation_S *animation,
+                                double seconds,
+                                uint32_t *buffer,
+                                size_t width,
+                                size_t height,
+                                size_t bytes_per_line)
+{
+    if (!animation) return;
+
+    rlottie::Surface surface(buffer, width, height, bytes_per_line);
+    animation->mAnimation->renderAtTimeSync(seconds, surface);
+}
+
+RLOTTIE_API void
+lottie_animation_render_incremental(Lottie_Animation_S *animation,
+                                    size_t frame_number,
+                                    uint32_t *buffer,
+                                    size_t width,
+                                    size_t height,
+                                    size_t bytes_per_line,
+                                    size_t *x, size_t *y,
+                                    size_t *w, size_t *h)
+{
+    rlottie::Rect area;
+    if (animation) {
+        rlottie::Surface surface(buffer, width, height, bytes_per_line);
+        area = animation->mAnimation->renderIncremental(frame_number, surface);
+    }
+
+    if (x) *x = area.x();
+    if (y) *y = area.y();
+    if (w) *w = area.w();
+    if (h) *h = area.h();
+}
+
 RLOTTIE_API void
 lottie_animation_render_async(Lottie_Animation_S *animation,
                               size_t frame_number,
@@ -312,4 +348,18 @@ lottie_configure_model_cache_size(size_t cacheSize)
    rlottie::configureModelCacheSize(cacheSize);
 }
 
+RLOTTIE_API void
+lottie_configure_frame_cache_size(size_t bytes)
+{
+   rlottie::configureFrameCacheSize(bytes);
+}
+
+RLOTTIE_API int
+lottie_configure_thread_pool(size_t threads)
+{
+   rlottie::ThreadPoolConfig config;
+   config.threads = unsigned(threads);
+   return rlottie::configureThreadPool(config) ? 1 : 0;
+}
+
 }
@@ -23,7 +23,11 @@
 #include "lottieitem.h"
 #include "lottiemodel.h"
 #include "rlottie.h"
+#include "vexecutor.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <fstream>
 
 using namespace rlottie;
@@ -34,12 +38,79 @@ RLOTTIE_API void rlottie::configureModelCacheSize(size_t cacheSize)
     internal::model::configureModelCacheSize(cacheSize);
 }
 
+RLOTTIE_API void rlottie::configureModelCacheMemory(size_t bytes)
+{
+    internal::model::configureModelCacheMemory(bytes);
+}
+
+RLOTTIE_API void rlottie::trimModelCache(size_t bytes)
+{
+    internal::model::trimModelCache(bytes);
+}
+
+RLOTTIE_API ModelCacheStats rlottie::modelCacheStats()
+{
+    auto            stats = internal::model::modelCacheStats();
+    ModelCacheStats result;
+    result.enabled = stats.enabled;
+    result.entries = stats.entries;
+    result.bytes = stats.bytes;
+    result.hits = stats.hits;
+    result.misses = stats.misses;
+    result.evictions = stats.evictions;
+    return result;
+}
+
+RLOTTIE_API void rlottie::configureFrameCacheSize(size_t bytes)
+{
+    internal::model::configureFrameCacheSize(bytes);
+}
+
+RLOTTIE_API void rlottie::configureImageCacheSize(size_t bytes)
+{
+    internal::model::configureImageCacheSize(bytes);
+}
+
+RLOTTIE_API void rlottie::configureRleCacheSize(size_t bytes)
+{
+    VRasterizer::configureCacheSize(bytes);
+}
+
+RLOTTIE_API void rlottie::configureSurfaceCacheSize(size_t bytes)
+{
+    renderer::configureSurfaceCacheSize(bytes);
+}
+
+RLOTTIE_API void rlottie::trimSurfaceCache(size_t bytes)
+{
+    renderer::trimSurfaceCache(bytes);
+}
+
+RLOTTIE_API SurfaceCacheStats rlottie::surfaceCacheStats()
+{
+    return renderer::surfaceCacheStats();
+}
+
+RLOTTIE_API bool rlottie::configureThreadPool(const ThreadPoolConfig &config)
+{
+    VExecutor::Config conf;
+    conf.mThreads = config.threads;
+    conf.mAffinity = config.cpuAffinity;
+    conf.mName = config.threadName;
+    conf.mPriority = config.priority;
+    conf.mHost = config.executor;
+    return VExecutor::instance().configure(std::move(conf));
+}
+
+// gives every set of property overrides its own frame cache identity.
+static std::atomic<size_t> OverrideCounter{0};
+
 struct RenderTask {
     RenderTask() { receiver = sender.get_future(); }
     std::promise<Surface> sender;
     std::future<Surface>  receiver;
     AnimationImpl *       playerImpl{nullptr};
-    size_t                frameNo{0};
+    double                frameNo{0};
     Surface               surface;
     bool                  keepAspectRatio{true};
 };
@@ -48,15 +119,29 @@ using SharedRenderTask = std::shared_ptr<RenderTask>;
 class AnimationImpl {
 public:
     void    init(std::shared_ptr<model::Composition> composition);
-    bool    update(size_t frameNo, const VSize &size, bool keepAspectRatio);
+    bool    update(double frameNo, const VSize &size, bool keepAspectRatio);
     VSize   size() const { return mModel->size(); }
     double  duration() const { return mModel->duration(); }
     double  frameRate() const { return mModel->frameRate(); }
     size_t  totalFrame() const { return mModel->totalFrame(); }
     size_t  frameAtPos(double pos) const { return mModel->frameAtPos(pos); }
-    Surface render(size_t frameNo, const Surface &surface,
+    double  frameAtTime(double seconds) const
+    {
+        // the time of a whole frame renders exactly that frame, even if
+        // the division leaves a rounding error.
+        double pos = mModel->framePosAtTime(seconds);
+        double whole = std::round(pos);
+        return std::abs(pos - whole) < 1e-4 ? whole : pos;
+    }
+    Surface render(double frameNo, const Surface &surface,
                    bool keepAspectRatio);
-    std::future<Surface> renderAsync(size_t frameNo, Surface &&surface,
+    Rect    renderIncremental(double frameNo, const Surface &surface,
+                              bool keepAspectRatio);
+    void    setRenderBands(size_t bands);
+    void    setImageQuality(ImageQuality quality);
+    void    renderRange(size_t first, size_t last,
+                        const SurfaceProvider &provider, bool keepAspectRatio);
+    std::future<Surface> renderAsync(double frameNo, Surface &&surface,
                                      bool keepAspectRatio);
     const LOTLayerNode * renderTree(size_t frameNo, const VSize &size);
 
@@ -70,19 +155,41 @@ public:
     const MarkerList &markers() const { return mModel->markers(); }
     void              setValue(const std::string &keypath, LOTVariant &&value);
     void              removeFilter(const std::string &keypath, Property prop);
+    bool              saveCompiled(const std::string &path) const;
 
 private:
+    float mapFrame(double frameNo) const;
+    bool  frameKey(double frameNo, const Surface &surface,
+                   bool keepAspectRatio, model::FrameCacheKey &key) const;
+
     mutable LayerInfoList                  mLayerList;
     model::Composition *                   mModel;
     SharedRenderTask                       mTask;
     std::atomic<bool>                      mRenderInProgress;
     std::unique_ptr<renderer::Composition> mRenderer{nullptr};
+    std::vector<std::pair<std::string, LOTVariant>> mValues;
+    size_t                                           mRenderBands{1};
+    ImageQuality                                     mImageQuality{ImageQuality::Fast};
+    size_t                                           mOverrides{0};
 };
 
 void AnimationImpl::setValue(const std::string &keypath, LOTVariant &&value)
 {
     if (keypath.empty()) return;
     mRenderer->setValue(keypath, value);
+
+    // keep the value around to replay it on a new render tree. only the
+    // last value of a keypath and property matters, it replaces the old one
+    // at the end of the list so the replay keeps the order of the overrides.
+    auto same = [&](const std::pair<std::string, LOTVariant> &e) {
+        return e.first == keypath && e.second.property() == value.property();
+    };
+    mValues.erase(std::remove_if(mValues.begin(), mValues.end(), same),
+                  mValues.end());
+    mValues.emplace_back(keypath, std::move(value));
+
+    // frames rendered with the old overrides must not be reused.
+    mOverrides = ++OverrideCounter;
 }
 
 const LOTLayerNode *AnimationImpl::renderTree(size_t frameNo, const VSize &size)
@@ -93,8 +200,7 @@ const LOTLayerNode *AnimationImpl::renderTree(size_t frameNo, const VSize &size)
     return mRenderer->renderTree();
 }
 
-bool AnimationImpl::update(size_t frameNo, const VSize &size,
-                           bool keepAspectRatio)
+float AnimationImpl::mapFrame(double frameNo) const
 {
     frameNo += mModel->startFrame();
 
@@ -102,10 +208,16 @@ bool AnimationImpl::update(size_t frameNo, const VSize &size,
 
     if (frameNo < mModel->startFrame()) frameNo = mModel->startFrame();
 
-    return mRenderer->update(int(frameNo), size, keepAspectRatio);
+    return float(frameNo);
 }
 
-Surface AnimationImpl::render(size_t frameNo, const Surface &surface,
+bool AnimationImpl::update(double frameNo, const VSize &size,
+                           bool keepAspectRatio)
+{
+    return mRenderer->update(mapFrame(frameNo), size, keepAspectRatio);
+}
+
+Surface AnimationImpl::render(double frameNo, const Surface &surface,
                               bool keepAspectRatio)
 {
     bool renderInProgress = mRenderInProgress.load();
@@ -115,138 +227,244 @@ Surface AnimationImpl::render(size_t frameNo, const Surface &surface,
     }
 
     mRenderInProgress.store(true);
+
+    // the cache only holds the draw region, the rest of the surface may
+    // belong to someone else.
+    auto region = reinterpret_cast<uint8_t *>(surface.buffer()) +
+                  surface.drawRegionPosY() * surface.bytesPerLine() +
+                  surface.drawRegionPosX() * sizeof(uint32_t);
+
+    model::FrameCacheKey key;
+    bool cacheable = frameKey(frameNo, surface, keepAspectRatio, key);
+    if (cacheable) {
+        if (auto frame = model::findFrame(key)) {
+            size_t width = surface.drawRegionWidth();
+            for (size_t y = 0; y < surface.drawRegionHeight(); y++) {
+                memcpy(region + y * surface.bytesPerLine(),
+                       frame->data() + y * width, width * sizeof(uint32_t));
+            }
+            mRenderInProgress.store(false);
+            return surface;
+        }
+    }
+
     update(
         frameNo,
         VSize(int(surface.drawRegionWidth()), int(surface.drawRegionHeight())),
         keepAspectRatio);
-    mRenderer->render(surface);
+    mRenderer->render(surface, mRenderBands);
+
+    if (cacheable) {
+        model::addFrame(key, reinterpret_cast<const uint32_t *>(region),
+                        surface.drawRegionWidth(), surface.drawRegionHeight(),
+                        surface.bytesPerLine());
+    }
     mRenderInProgress.store(false);
 
     return surface;
 }
 
-void AnimationImpl::init(std::shared_ptr<model::Composition> composition)
+/*
+ * Repaints only the part of the surface that differs from the frame the
+ * buffer got in its last incremental render. The frame cache is bypassed as
+ * copying a whole frame costs more than painting a small damaged area.
+ */
+Rect AnimationImpl::renderIncremental(double frameNo, const Surface &surface,
+                                      bool keepAspectRatio)
 {
-    mModel = composition.get();
-    mRenderer = std::make_unique<renderer::Composition>(composition);
-    mRenderInProgress = false;
+    bool renderInProgress = mRenderInProgress.load();
+    if (renderInProgress) {
+        vCritical << "Already Rendering Scheduled for this Animation";
+        return {};
+    }
+
+    mRenderInProgress.store(true);
+
+    update(
+        frameNo,
+        VSize(int(surface.drawRegionWidth()), int(surface.drawRegionHeight())),
+        keepAspectRatio);
+    mRenderer->preprocess(surface);
+    VRect area = mRenderer->renderDamage(surface, mRenderBands);
+
+    mRenderInProgress.store(false);
+
+    if (area.empty()) return {};
+
+    return Rect(size_t(area.x()), size_t(area.y()), size_t(area.width()),
+                size_t(area.height()));
 }
 
-#ifdef LOTTIE_THREAD_SUPPORT
+bool AnimationImpl::frameKey(double frameNo, const Surface &surface,
+                             bool keepAspectRatio,
+                             model::FrameCacheKey &key) const
+{
+    // only shared compositions have a key that identifies their content.
+    if (mModel->mKey.empty() || !surface.buffer()) return false;
 
-#include <thread>
-#include "vtaskqueue.h"
+    key.mKey = mModel->mKey;
+    key.mOverrides = mOverrides;
+    key.mFrameNo = mapFrame(frameNo);
+    key.mWidth = surface.width();
+    key.mHeight = surface.height();
+    key.mDrawRegion = VRect(
+        int(surface.drawRegionPosX()), int(surface.drawRegionPosY()),
+        int(surface.drawRegionWidth()), int(surface.drawRegionHeight()));
+    key.mKeepAspectRatio = keepAspectRatio;
+    key.mImageQuality = size_t(mImageQuality);
+    return true;
+}
 
 /*
- * Implement a task stealing schduler to perform render task
- * As each player draws into its own buffer we can delegate this
- * task to a slave thread. The scheduler creates a threadpool depending
- * on the number of cores available in the system and does a simple fair
- * scheduling by assigning the task in a round-robin fashion. Each thread
- * in the threadpool has its own queue. once it finishes all the task on its
- * own queue it goes through rest of the queue and looks for task if it founds
- * one it steals the task from it and executes. if it couldn't find one then it
- * just waits for new task on its own queue.
+ * Renders the frames through two render trees. While one tree paints
+ * frame N the other one is updated to frame N + 1 and its raster tasks
+ * are already running on the thread pool.
  */
-class RenderTaskScheduler {
-    const unsigned           _count{std::thread::hardware_concurrency()};
-    std::vector<std::thread> _threads;
-    std::vector<TaskQueue<SharedRenderTask>> _q{_count};
-    std::atomic<unsigned>                    _index{0};
+void AnimationImpl::renderRange(size_t first, size_t last,
+                                const SurfaceProvider &provider,
+                                bool                   keepAspectRatio)
+{
+    if (last >= totalFrame()) last = totalFrame() ? totalFrame() - 1 : 0;
 
-    void run(unsigned i)
-    {
-        while (true) {
-            bool             success = false;
-            SharedRenderTask task;
-            for (unsigned n = 0; n != _count * 2; ++n) {
-                if (_q[(i + n) % _count].try_pop(task)) {
-                    success = true;
-                    break;
-                }
-            }
-            if (!success && !_q[i].pop(task)) break;
+    if (first > last || !provider) return;
 
-            auto result = task->playerImpl->render(task->frameNo, task->surface,
-                                                   task->keepAspectRatio);
-            task->sender.set_value(result);
-        }
+    bool renderInProgress = mRenderInProgress.load();
+    if (renderInProgress) {
+        vCritical << "Already Rendering Scheduled for this Animation";
+        return;
     }
 
-    RenderTaskScheduler()
-    {
-        for (unsigned n = 0; n != _count; ++n) {
-            _threads.emplace_back([&, n] { run(n); });
+    mRenderInProgress.store(true);
+
+    // the second tree only lives for this call, so an animation that
+    // is not rendering a range doesn't hold on to its memory.
+    renderer::Composition pipeRenderer(mRenderer->model());
+    for (auto &e : mValues) pipeRenderer.setValue(e.first, e.second);
+    pipeRenderer.setSmoothImage(mImageQuality == ImageQuality::Smooth);
+
+    auto prepare = [&](renderer::Composition *renderer, size_t frameNo,
+                       const Surface &surface) {
+        renderer->update(mapFrame(frameNo),
+                         VSize(int(surface.drawRegionWidth()),
+                               int(surface.drawRegionHeight())),
+                         keepAspectRatio);
+        renderer->preprocess(surface);
+    };
+
+    renderer::Composition *current = mRenderer.get();
+    renderer::Composition *next = &pipeRenderer;
+
+    Surface surface = provider(first);
+    prepare(current, first, surface);
+    for (size_t frameNo = first; frameNo <= last; frameNo++) {
+        Surface nextSurface;
+        if (frameNo != last) {
+            nextSurface = provider(frameNo + 1);
+            prepare(next, frameNo + 1, nextSurface);
         }
+        current->paint(surface, mRenderBands);
 
-        IsRunning = true;
+        std::swap(current, next);
+        surface = nextSurface;
     }
 
-public:
-    static bool IsRunning;
+    mRenderInProgress.store(false);
+}
 
-    static RenderTaskScheduler &instance()
-    {
-        static RenderTaskScheduler singleton;
-        return singleton;
-    }
+bool AnimationImpl::saveCompiled(const std::string &path) const
+{
+    return model::saveCompiled(*mModel, path);
+}
 
-    ~RenderTaskScheduler() { stop(); }
+void AnimationImpl::init(std::shared_ptr<model::Composition> composition)
+{
+    mModel = composition.get();
+    mRenderer = std::make_unique<renderer::Composition>(composition);
+    mRenderInProgress = false;
+}
 
-    void stop()
-    {
-        if (IsRunning) {
-            IsRunning = false;
+#ifdef LOTTIE_THREAD_SUPPORT
 
-            for (auto &e : _q) e.done();
-            for (auto &e : _threads) e.join();
-        }
+/*
+ * Work shared by the caller of parallelFor() and the helper jobs it
+ * dispatched. Indices are claimed through an atomic counter, so a helper
+ * that starts late just finds nothing left to do and the caller only
+ * waits for the indices that are already being processed.
+ */
+class ParallelJob {
+public:
+    ParallelJob(size_t count, const std::function<void(size_t)> &job)
+        : mJob(job), mCount(count)
+    {
     }
 
-    std::future<Surface> process(SharedRenderTask task)
+    void work()
     {
-        auto receiver = std::move(task->receiver);
-        auto i = _index++;
-
-        for (unsigned n = 0; n != _count; ++n) {
-            if (_q[(i + n) % _count].try_push(std::move(task))) return receiver;
-        }
-
-        if (_count > 0) {
-            _q[i % _count].push(std::move(task));
+        size_t i;
+        while ((i = mNext++) < mCount) {
+            mJob(i);
+            bool finished;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                finished = (++mFinished == mCount);
+            }
+            if (finished) mDone.notify_one();
         }
+    }
 
-        return receiver;
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (mFinished != mCount) mDone.wait(lock);
     }
+
+private:
+    std::function<void(size_t)> mJob;
+    size_t                      mCount;
+    size_t                      mFinished{0};
+    std::atomic<size_t>         mNext{0};
+    std::mutex                  mMutex;
+    std::condition_variable     mDone;
 };
 
-#else
-class RenderTaskScheduler {
-public:
-    static bool IsRunning;
+void renderer::parallelFor(size_t count, const std::function<void(size_t)> &job)
+{
+    if (count == 0) return;
 
-    static RenderTaskScheduler &instance()
-    {
-        static RenderTaskScheduler singleton;
-        return singleton;
+    auto     parallelJob = std::make_shared<ParallelJob>(count, job);
+    auto &   executor = VExecutor::instance();
+    unsigned helpers = std::min(unsigned(count - 1), executor.concurrency());
+
+    for (unsigned n = 0; n != helpers; ++n) {
+        executor.dispatch([parallelJob]() { parallelJob->work(); });
     }
 
-    void stop() {}
+    parallelJob->work();
+    parallelJob->wait();
+}
 
-    std::future<Surface> process(SharedRenderTask task)
-    {
-        auto result = task->playerImpl->render(task->frameNo, task->surface,
-                                               task->keepAspectRatio);
-        task->sender.set_value(result);
-        return std::move(task->receiver);
-    }
-};
+#else
+
+void renderer::parallelFor(size_t count, const std::function<void(size_t)> &job)
+{
+    for (size_t i = 0; i < count; i++) job(i);
+}
 
 #endif
 
-bool RenderTaskScheduler::IsRunning{false};
+void AnimationImpl::setRenderBands(size_t bands)
+{
+    if (bands == 0) bands = VExecutor::instance().concurrency();
+    mRenderBands = bands;
+}
 
-std::future<Surface> AnimationImpl::renderAsync(size_t    frameNo,
+void AnimationImpl::setImageQuality(ImageQuality quality)
+{
+    mImageQuality = quality;
+    mRenderer->setSmoothImage(quality == ImageQuality::Smooth);
+}
+
+std::future<Surface> AnimationImpl::renderAsync(double    frameNo,
                                                 Surface &&surface,
                                                 bool      keepAspectRatio)
 {
@@ -261,7 +479,14 @@ std::future<Surface> AnimationImpl::renderAsync(size_t    frameNo,
     mTask->surface = std::move(surface);
     mTask->keepAspectRatio = keepAspectRatio;
 
-    return RenderTaskScheduler::instance().process(mTask);
+    auto task = mTask;
+    auto receiver = std::move(task->receiver);
+    VExecutor::instance().dispatch([task]() {
+        auto result = task->playerImpl->render(task->frameNo, task->surface,
+                                               task->keepAspectRatio);
+        task->sender.set_value(result);
+    });
+    return receiver;
 }
 
 /**
@@ -325,6 +550,28 @@ std::unique_ptr<Animation> Animation::loadFromFile(const std::string &path,
     return nullptr;
 }
 
+std::unique_ptr<Animation> Animation::loadCompiled(const std::string &path,
+                                                   bool cachePolicy)
+{
+    if (path.empty()) {
+        vWarning << "File path is empty";
+        return nullptr;
+    }
+
+    auto composition = model::loadCompiled(path, cachePolicy);
+    if (composition) {
+        auto animation = std::unique_ptr<Animation>(new Animation);
+        animation->d->init(std::move(composition));
+        return animation;
+    }
+    return nullptr;
+}
+
+bool Animation::saveCompiled(const std::string &path) const
+{
+    return d->saveCompiled(path);
+}
+
 void Animation::size(size_t &width, size_t &height) const
 {
     VSize sz = d->size();
@@ -371,6 +618,42 @@ void Animation::renderSync(size_t frameNo, Surface surface,
     d->render(frameNo, surface, keepAspectRatio);
 }
 
+Rect Animation::renderIncremental(size_t frameNo, Surface surface,
+                                  bool keepAspectRatio)
+{
+    return d->renderIncremental(frameNo, surface, keepAspectRatio);
+}
+
+std::future<Surface> Animation::renderAtTime(double seconds, Surface surface,
+                                             bool keepAspectRatio)
+{
+    return d->renderAsync(d->frameAtTime(seconds), std::move(surface),
+                          keepAspectRatio);
+}
+
+void Animation::renderAtTimeSync(double seconds, Surface surface,
+                                 bool keepAspectRatio)
+{
+    d->render(d->frameAtTime(seconds), surface, keepAspectRatio);
+}
+
+void Animation::setRenderBands(size_t bands)
+{
+    d->setRenderBands(bands);
+}
+
+void Animation::setImageQuality(ImageQuality quality)
+{
+    d->setImageQuality(quality);
+}
+
+void Animation::renderRange(size_t first, size_t last,
+                            const SurfaceProvider &provider,
+                            bool                   keepAspectRatio)
+{
+    d->renderRange(first, last, provider, keepAspectRatio);
+}
+
 const LayerInfoList &Animation::layers() const
 {
     return d->layerInfoList();
@@ -457,27 +740,15 @@ void Surface::setDrawRegion(size_t x, size_t y, size_t width, size_t height)
     mDrawArea.h = height;
 }
 
-namespace {
-void lottieShutdownRenderTaskScheduler()
-{
-    if (RenderTaskScheduler::IsRunning) {
-        RenderTaskScheduler::instance().stop();
-    }
-}
-}  // namespace
-
 // private apis exposed to c interface
 void lottie_init_impl()
 {
     // do nothing for now.
 }
 
-extern void lottieShutdownRasterTaskScheduler();
-
 void lottie_shutdown_impl()
 {
-    lottieShutdownRenderTaskScheduler();
-    lottieShutdownRasterTaskScheduler();
+    VExecutor::instance().stop();
 }
 
 #ifdef LOTTIE_LOGGING_SUPPORT
@@ -268,33 +268,33 @@ public:
     {
         return mBitset.test(static_cast<uint32_t>(prop));
     }
-    model::Color color(rlottie::Property prop, int frame) const
+    model::Color color(rlottie::Property prop, float frame) const
     {
-        rlottie::FrameInfo info(frame);
+        rlottie::FrameInfo info(static_cast<uint32_t>(frame));
         rlottie::Color     col = data(prop).color()(info);
         return model::Color(col.r(), col.g(), col.b());
     }
-    VPointF point(rlottie::Property prop, int frame) const
+    VPointF point(rlottie::Property prop, float frame) const
     {
-        rlottie::FrameInfo info(frame);
+        rlottie::FrameInfo info(static_cast<uint32_t>(frame));
         rlottie::Point     pt = data(prop).point()(info);
         return VPointF(pt.x(), pt.y());
     }
-    VSize scale(rlottie::Property prop, int frame) const
+    VSize scale(rlottie::Property prop, float frame) const
     {
-        rlottie::FrameInfo info(frame);
+        rlottie::FrameInfo info(static_cast<uint32_t>(frame));
         rlottie::Size      sz = data(prop).size()(info);
         return VSize(sz.w(), sz.h());
     }
-    float opacity(rlottie::Property prop, int frame) const
+    float opacity(rlottie::Property prop, float frame) const
     {
-        rlottie::FrameInfo info(frame);
+        rlottie::FrameInfo info(static_cast<uint32_t>(frame));
         float              val = data(prop).value()(info);
         return val / 100;
     }
-    float value(rlottie::Property prop, int frame) const
+    float value(rlottie::Property prop, float frame) const
     {
-        rlottie::FrameInfo info(frame);
+        rlottie::FrameInfo info(static_cast<uint32_t>(frame));
         return data(prop).value()(info);
     }
 
@@ -339,14 +339,14 @@ template <typename T>
 class Filter : public FilterBase<T> {
 public:
     Filter(T* model): FilterBase<T>(model){}
-    model::Color color(int frame) const
+    model::Color color(float frame) const
     {
         if (this->hasFilter(rlottie::Property::StrokeColor)) {
             return this->filter()->color(rlottie::Property::StrokeColor, frame);
         }
         return this->model()->color(frame);
     }
-    float opacity(int frame) const
+    float opacity(float frame) const
     {
         if (this->hasFilter(rlottie::Property::StrokeOpacity)) {
             return this->filter()->opacity(rlottie::Property::StrokeOpacity, frame);
@@ -354,7 +354,7 @@ public:
         return this->model()->opacity(frame);
     }
 
-    float strokeWidth(int frame) const
+    float strokeWidth(float frame) const
     {
         if (this->hasFilter(rlottie::Property::StrokeWidth)) {
             return this->filter()->value(rlottie::Property::StrokeWidth, frame);
@@ -366,7 +366,7 @@ public:
     CapStyle  capStyle() const { return this->model()->capStyle(); }
     JoinStyle joinStyle() const { return this->model()->joinStyle(); }
     bool      hasDashInfo() const { return this->model()->hasDashInfo(); }
-    void      getDashInfo(int frameNo, std::vector<float>& result) const
+    void      getDashInfo(float frameNo, std::vector<float>& result) const
     {
         return this->model()->getDashInfo(frameNo, result);
     }
@@ -379,7 +379,7 @@ class Filter<model::Fill>: public FilterBase<model::Fill>
 public:
     Filter(model::Fill* model) : FilterBase<model::Fill>(model) {}
 
-    model::Color color(int frame) const
+    model::Color color(float frame) const
     {
         if (this->hasFilter(rlottie::Property::FillColor)) {
             return this->filter()->color(rlottie::Property::FillColor, frame);
@@ -387,7 +387,7 @@ public:
         return this->model()->color(frame);
     }
 
-    float opacity(int frame) const
+    float opacity(float frame) const
     {
         if (this->hasFilter(rlottie::Property::FillOpacity)) {
             return this->filter()->opacity(rlottie::Property::FillOpacity, frame);
@@ -407,7 +407,7 @@ public:
     bool   hasModel() const { return this->model() ? true : false; }
 
     model::Transform* transform() const { return this->model() ? this->model()->mTransform : nullptr; }
-    VMatrix           matrix(int frame) const
+    VMatrix           matrix(float frame) const
     {
         VMatrix mS, mR, mT;
         if (this->hasFilter(rlottie::Property::TrScale)) {
@@ -22,8 +22,10 @@
 
 #include "lottieitem.h"
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <iterator>
+#include <mutex>
 #include "lottiekeypath.h"
 #include "vbitmap.h"
 #include "vpainter.h"
@@ -72,6 +74,291 @@ static bool strokeProp(rlottie::Property prop)
     }
 }
 
+template <typename T>
+static inline void hashCombine(size_t &seed, const T &v)
+{
+    seed ^= std::hash<T>{}(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+/*
+ * Keeps the offscreen surfaces of the matte and complex content passes for
+ * reuse by every animation and render thread. A surface is allocated with
+ * the size of its class, four classes per power of two, so it serves any
+ * later request of its class without reallocating and is at most 25%
+ * larger than the request. The idle surfaces are bounded by a byte budget,
+ * the least recently released ones go first, and the ones not reused for
+ * a few seconds are freed as well.
+ */
+class renderer::SurfaceCache {
+public:
+    static SurfaceCache &instance()
+    {
+        static SurfaceCache singleton;
+        return singleton;
+    }
+
+    VBitmap make_surface(
+        size_t width, size_t height,
+        VBitmap::Format format = VBitmap::Format::ARGB32_Premultiplied)
+    {
+        // 4 bytes per pixel is enough for every format.
+        size_t bytes = width * height * 4;
+        if (!bytes) return {width, height, format};
+
+        size_t  cls = sizeClass(bytes);
+        VBitmap surface;
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+
+            // the next class wastes at most 56%, still better than a new one.
+            for (size_t i = cls; i < cls + 2 && i < maxClasses; i++) {
+                auto &list = mFree[i];
+                if (list.empty()) continue;
+                surface = std::move(list.back().mSurface);
+                list.pop_back();
+                mStats.entries--;
+                mStats.bytes -= surface.capacity();
+                break;
+            }
+            if (surface.capacity())
+                mStats.hits++;
+            else
+                mStats.misses++;
+            mStats.inUse += surface.capacity() ? surface.capacity()
+                                               : classBytes(cls, bytes);
+        }
+
+        if (!surface.capacity()) surface.reserve(classBytes(cls, bytes));
+        surface.reset(width, height, format);
+        return surface;
+    }
+
+    void release_surface(VBitmap &surface)
+    {
+        size_t bytes = surface.capacity();
+        if (!bytes) return;
+
+        auto now = Clock::now();
+
+        std::lock_guard<std::mutex> guard(mMutex);
+        mStats.inUse -= bytes;
+
+        size_t cls = sizeClass(bytes);
+        if (cls >= maxClasses || bytes > mBudget) {
+            mStats.evictions++;
+            surface = VBitmap();
+        } else {
+            mFree[cls].push_back({std::move(surface), now});
+            mStats.entries++;
+            mStats.bytes += bytes;
+        }
+
+        if (now - mLastExpire > std::chrono::seconds(1)) {
+            expire(now - idleTime);
+            mLastExpire = now;
+        }
+        trim(mBudget);
+    }
+
+    void configureCacheSize(size_t bytes)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mBudget = bytes;
+
+        trim(mBudget);
+    }
+
+    void trimCache(size_t bytes)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+
+        trim(bytes);
+    }
+
+    rlottie::SurfaceCacheStats stats()
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        return mStats;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        VBitmap           mSurface;
+        Clock::time_point mReleased;
+    };
+
+    // classes start at 4 KB, surfaces above 1 GB are not kept.
+    static constexpr size_t minShift = 12;
+    static constexpr size_t maxClasses = (30 - minShift) * 4 + 1;
+    static constexpr std::chrono::seconds idleTime{3};
+
+    static size_t sizeClass(size_t bytes)
+    {
+        if (bytes <= (size_t(1) << minShift)) return 0;
+
+        size_t n = bytes - 1;
+        size_t k = minShift;
+        while (n >> (k + 1)) k++;
+        // quarter steps between 2^k and 2^(k+1).
+        size_t step = ((n - (size_t(1) << k)) >> (k - 2)) + 1;
+        return (k - minShift) * 4 + step;
+    }
+
+    // bytes allocated for a class, a request too big to be kept gets
+    // exactly what it asked for.
+    static size_t classBytes(size_t cls, size_t bytes)
+    {
+        if (cls >= maxClasses) return bytes;
+        if (!cls) return size_t(1) << minShift;
+
+        size_t k = minShift + (cls - 1) / 4;
+        size_t step = (cls - 1) % 4 + 1;
+        return (size_t(1) << k) + step * (size_t(1) << (k - 2));
+    }
+
+    void erase(std::vector<Entry> &list)
+    {
+        mStats.entries--;
+        mStats.bytes -= list.front().mSurface.capacity();
+        mStats.evictions++;
+        list.erase(list.begin());
+    }
+
+    // every list is in release order, the oldest surface is in front.
+    void expire(Clock::time_point before)
+    {
+        for (auto &list : mFree) {
+            while (!list.empty() && list.front().mReleased < before)
+                erase(list);
+        }
+    }
+
+    void trim(size_t bytes)
+    {
+        while (mStats.bytes > bytes) {
+            std::vector<Entry> *oldest = nullptr;
+            for (auto &list : mFree) {
+                if (list.empty()) continue;
+                if (!oldest ||
+                    list.front().mReleased < oldest->front().mReleased)
+                    oldest = &list;
+            }
+            erase(*oldest);
+        }
+    }
+
+    SurfaceCache() = default;
+
+    std::array<std::vector<Entry>, maxClasses> mFree;
+    std::mutex                                 mMutex;
+    rlottie::SurfaceCacheStats                 mStats;
+    size_t                                     mBudget{32 * 1024 * 1024};
+    Clock::time_point                          mLastExpire{Clock::now()};
+};
+
+constexpr std::chrono::seconds renderer::SurfaceCache::idleTime;
+
+void renderer::configureSurfaceCacheSize(size_t bytes)
+{
+    SurfaceCache::instance().configureCacheSize(bytes);
+}
+
+void renderer::trimSurfaceCache(size_t bytes)
+{
+    SurfaceCache::instance().trimCache(bytes);
+}
+
+rlottie::SurfaceCacheStats renderer::surfaceCacheStats()
+{
+    return SurfaceCache::instance().stats();
+}
+
+static bool sameMatrix(const VMatrix &a, const VMatrix &b)
+{
+    return a.m_11() == b.m_11() && a.m_12() == b.m_12() &&
+           a.m_13() == b.m_13() && a.m_21() == b.m_21() &&
+           a.m_22() == b.m_22() && a.m_23() == b.m_23() &&
+           a.m_tx() == b.m_tx() && a.m_ty() == b.m_ty() &&
+           a.m_33() == b.m_33();
+}
+
+/*
+ * the gradient and texture objects are updated in place, so the state
+ * keeps a copy of everything that decides the pixels a brush produces.
+ */
+bool renderer::Layer::BrushState::operator==(const VBrush &brush) const
+{
+    if (brush.type() != mType) return false;
+
+    switch (brush.type()) {
+    case VBrush::Type::Solid:
+        return brush.mColor == mColor;
+    case VBrush::Type::LinearGradient:
+    case VBrush::Type::RadialGradient: {
+        auto gradient = brush.mGradient;
+        if (gradient->mSpread != mSpread || gradient->mMode != mMode ||
+            gradient->mAlpha != mAlpha ||
+            !sameMatrix(gradient->mMatrix, mMatrix) ||
+            gradient->mStops.size() != mStops.size())
+            return false;
+        for (size_t i = 0; i < mStops.size(); i++) {
+            if (gradient->mStops[i].first != mStops[i].first ||
+                !(gradient->mStops[i].second == mStops[i].second))
+                return false;
+        }
+        if (brush.type() == VBrush::Type::LinearGradient) {
+            const auto &l = gradient->linear;
+            return l.x1 == mLinear.x1 && l.y1 == mLinear.y1 &&
+                   l.x2 == mLinear.x2 && l.y2 == mLinear.y2;
+        }
+        const auto &r = gradient->radial;
+        return r.cx == mRadial.cx && r.cy == mRadial.cy &&
+               r.fx == mRadial.fx && r.fy == mRadial.fy &&
+               r.cradius == mRadial.cradius && r.fradius == mRadial.fradius;
+    }
+    case VBrush::Type::Texture:
+        return brush.mTexture->mBitmap.data() == mBitmap &&
+               brush.mTexture->mAlpha == mTextureAlpha &&
+               sameMatrix(brush.mTexture->mMatrix, mMatrix);
+    default:
+        return true;
+    }
+}
+
+void renderer::Layer::BrushState::save(const VBrush &brush)
+{
+    mType = brush.type();
+    switch (brush.type()) {
+    case VBrush::Type::Solid:
+        mColor = brush.mColor;
+        break;
+    case VBrush::Type::LinearGradient:
+    case VBrush::Type::RadialGradient: {
+        auto gradient = brush.mGradient;
+        mSpread = gradient->mSpread;
+        mMode = gradient->mMode;
+        mAlpha = gradient->mAlpha;
+        // reuses the storage of the last frame.
+        mStops = gradient->mStops;
+        if (brush.type() == VBrush::Type::LinearGradient)
+            mLinear = gradient->linear;
+        else
+            mRadial = gradient->radial;
+        mMatrix = gradient->mMatrix;
+        break;
+    }
+    case VBrush::Type::Texture:
+        mBitmap = brush.mTexture->mBitmap.data();
+        mTextureAlpha = brush.mTexture->mAlpha;
+        mMatrix = brush.mTexture->mMatrix;
+        break;
+    default:
+        break;
+    }
+}
+
 static renderer::Layer *createLayerItem(model::Layer *layerData,
                                         VArenaAlloc * allocator)
 {
@@ -113,7 +400,7 @@ void renderer::Composition::setValue(const std::string &keypath,
     mRootLayer->resolveKeyPath(key, 0, value);
 }
 
-bool renderer::Composition::update(int frameNo, const VSize &size,
+bool renderer::Composition::update(float frameNo, const VSize &size,
                                    bool keepAspectRatio)
 {
     // check if cached frame is same as requested frame.
@@ -147,30 +434,176 @@ bool renderer::Composition::update(int frameNo, const VSize &size,
     return true;
 }
 
-bool renderer::Composition::render(const rlottie::Surface &surface)
+bool renderer::Composition::render(const rlottie::Surface &surface,
+                                   size_t                  bands)
+{
+    preprocess(surface);
+    return paint(surface, bands);
+}
+
+void renderer::Composition::preprocess(const rlottie::Surface &surface)
+{
+    /* schedule all preprocess task for this frame at once.
+     */
+    VRasterizer::Batch batch;
+    VRect clip(0, 0, int(surface.drawRegionWidth()),
+               int(surface.drawRegionHeight()));
+    if (std::max(clip.width(), clip.height()) > VRle::Span::maxCoord())
+        vWarning << "rle spans can't address the whole surface, build with "
+                    "LOTTIE_WIDE_SPAN to render it";
+    mRootLayer->preprocess(clip);
+}
+
+bool renderer::Composition::paint(const rlottie::Surface &surface,
+                                  size_t                  bands)
 {
     mSurface.reset(reinterpret_cast<uint8_t *>(surface.buffer()),
                    uint32_t(surface.width()), uint32_t(surface.height()),
                    uint32_t(surface.bytesPerLine()),
                    VBitmap::Format::ARGB32_Premultiplied);
 
-    /* schedule all preprocess task for this frame at once.
-     */
     VRect clip(0, 0, int(surface.drawRegionWidth()),
                int(surface.drawRegionHeight()));
-    mRootLayer->preprocess(clip);
+    VRect region(int(surface.drawRegionPosX()), int(surface.drawRegionPosY()),
+                 int(surface.drawRegionWidth()),
+                 int(surface.drawRegionHeight()));
+
+    // a band has to be tall enough to pay for its own setup cost.
+    const size_t minBandHeight = 32;
+    bands = std::min(bands, surface.height() / minBandHeight);
+
+    if (bands <= 1) {
+        VPainter painter(&mSurface);
+        // set sub surface area for drawing.
+        painter.setDrawRegion(region);
+        painter.setSmoothImage(mSmoothImage);
+        mRootLayer->render(&painter, {}, {}, SurfaceCache::instance());
+        painter.end();
+        return true;
+    }
 
-    VPainter painter(&mSurface);
-    // set sub surface area for drawing.
-    painter.setDrawRegion(
-        VRect(int(surface.drawRegionPosX()), int(surface.drawRegionPosY()),
-              int(surface.drawRegionWidth()), int(surface.drawRegionHeight())));
-    mRootLayer->render(&painter, {}, {}, mSurfaceCache);
-    painter.end();
+    /*
+     * split the surface into horizontal bands and render each band
+     * on its own thread. wait for all the raster tasks first so that the
+     * band painters only read the shared render tree.
+     */
+    mRootLayer->syncPreprocess(clip);
+
+    paintArea(surface,
+              VRect(0, 0, int(surface.width()), int(surface.height())), bands);
     return true;
 }
 
-void renderer::Mask::update(int frameNo, const VMatrix &parentMatrix,
+/*
+ * paints the given area of the surface, the area is split into horizontal
+ * bands when more than one band is requested. the render tree has to be
+ * synced before.
+ */
+void renderer::Composition::paintArea(const rlottie::Surface &surface,
+                                      const VRect &area, size_t bands)
+{
+    VRect region(int(surface.drawRegionPosX()), int(surface.drawRegionPosY()),
+                 int(surface.drawRegionWidth()),
+                 int(surface.drawRegionHeight()));
+
+    // a band has to be tall enough to pay for its own setup cost.
+    const size_t minBandHeight = 32;
+    bands = std::min(bands, size_t(area.height()) / minBandHeight);
+    bands = std::max(bands, size_t(1));
+
+    auto paintBand = [&](size_t i) {
+        int top = area.y() + int(i * area.height() / bands);
+        int bottom = area.y() + int((i + 1) * area.height() / bands);
+
+        // painter only clears the pixels of its own band.
+        VBitmap band(mSurface.data() + top * mSurface.stride() +
+                         area.x() * 4,
+                     size_t(area.width()), size_t(bottom - top),
+                     mSurface.stride(), VBitmap::Format::ARGB32_Premultiplied);
+        VPainter painter(&band);
+        painter.setDrawRegion(region.translated(-area.x(), -top));
+        painter.setClipRect(VRect(area.x() - region.x(), top - region.y(),
+                                  area.width(), bottom - top));
+        painter.setSmoothImage(mSmoothImage);
+        if (!painter.clipBoundingRect().empty())
+            mRootLayer->render(&painter, {}, {},
+                               SurfaceCache::instance());
+        painter.end();
+    };
+
+    if (bands == 1)
+        paintBand(0);
+    else
+        parallelFor(bands, paintBand);
+}
+
+VRect renderer::Composition::renderDamage(const rlottie::Surface &surface,
+                                          size_t                  bands)
+{
+    mSurface.reset(reinterpret_cast<uint8_t *>(surface.buffer()),
+                   uint32_t(surface.width()), uint32_t(surface.height()),
+                   uint32_t(surface.bytesPerLine()),
+                   VBitmap::Format::ARGB32_Premultiplied);
+
+    VRect clip(0, 0, int(surface.drawRegionWidth()),
+               int(surface.drawRegionHeight()));
+    VRect region(int(surface.drawRegionPosX()), int(surface.drawRegionPosY()),
+                 int(surface.drawRegionWidth()),
+                 int(surface.drawRegionHeight()));
+    VRect full(0, 0, int(surface.width()), int(surface.height()));
+
+    // the rle and mask of every layer have to be final before comparing them.
+    mRootLayer->syncPreprocess(clip);
+
+    VRect damage;
+    mRootLayer->collectDamage(damage, clip, false, true);
+    damage = damage.translated(region.x(), region.y()) & region & full;
+
+    /*
+     * a buffer of a swap chain holds an older frame, it has to be repainted
+     * with the damage of all the frames rendered after it. unknown buffers
+     * and a changed surface geometry or image quality need a full repaint.
+     */
+    std::array<size_t, 8> geometry{
+        {surface.width(), surface.height(), surface.bytesPerLine(),
+         surface.drawRegionPosX(), surface.drawRegionPosY(),
+         surface.drawRegionWidth(), surface.drawRegionHeight(),
+         size_t(mSmoothImage)}};
+    if (geometry != mDamageGeometry) {
+        mDamageHistory.clear();
+        mDamageGeometry = geometry;
+    }
+
+    auto it = std::find_if(mDamageHistory.rbegin(), mDamageHistory.rend(),
+                           [&surface](const DamageFrame &frame) {
+                               return frame.mBuffer == surface.buffer();
+                           });
+    VRect area = full;
+    if (it != mDamageHistory.rend()) {
+        area = damage;
+        for (auto i = it.base(); i != mDamageHistory.end(); ++i)
+            area |= i->mDamage;
+        /*
+         * gradients and blending step through a span from its first pixel,
+         * a span clipped on the left would not round the same way as in a
+         * full render. repaint whole rows of the draw region instead.
+         */
+        if (!area.empty())
+            area = VRect(region.x(), area.y(), region.width(), area.height()) &
+                   full;
+    }
+
+    const size_t maxHistory = 4;
+    if (mDamageHistory.size() == maxHistory)
+        mDamageHistory.erase(mDamageHistory.begin());
+    mDamageHistory.push_back({surface.buffer(), damage});
+
+    if (!area.empty()) paintArea(surface, area, bands);
+
+    return area;
+}
+
+void renderer::Mask::update(float frameNo, const VMatrix &parentMatrix,
                             float /*parentAlpha*/, const DirtyFlag &flag)
 {
     bool dirtyPath = false;
@@ -211,6 +644,8 @@ void renderer::Mask::preprocess(const VRect &clip)
 {
     if (mRasterRequest)
         mRasterizer.rasterize(mFinalPath, FillRule::Winding, clip);
+
+    mRasterRequest = false;
 }
 
 void renderer::Layer::render(VPainter *painter, const VRle &inheritMask,
@@ -257,6 +692,48 @@ void renderer::Layer::render(VPainter *painter, const VRle &inheritMask,
     }
 }
 
+static void appendSpans(size_t count, const VRle::Span *spans, void *userData)
+{
+    static_cast<VRle *>(userData)->addSpan(spans, count);
+}
+
+/*
+ * the alpha channel render() would produce inside clip, folded into the
+ * span coverage. only solid colors have the same alpha at every pixel of
+ * a span.
+ */
+bool renderer::Layer::alphaRle(const VRect &clip, const VRle &inheritMask,
+                               VRle &result)
+{
+    static vthread_local VRle clipped;
+
+    result.reset();
+    if (skipRendering()) return true;
+
+    for (auto &i : renderList()) {
+        switch (i->mBrush.type()) {
+        case VBrush::Type::NoBrush:
+            continue;
+        case VBrush::Type::Solid:
+            break;
+        default:
+            return false;
+        }
+        uint8_t alpha = i->mBrush.mColor.alpha();
+        if (!alpha) continue;
+
+        clipped.reset();
+        i->rle().intersect(clip, appendSpans, &clipped);
+        if (alpha != 255) clipped *= alpha;
+        result += clipped;
+    }
+
+    if (result.empty()) return true;
+    if (mLayerMask) result &= mLayerMask->maskRle(clip);
+    if (!inheritMask.empty()) result &= inheritMask;
+    return true;
+}
+
 void renderer::LayerMask::preprocess(const VRect &clip)
 {
     for (auto &i : mMasks) {
@@ -264,6 +741,16 @@ void renderer::LayerMask::preprocess(const VRect &clip)
     }
 }
 
+size_t renderer::LayerMask::damageContext() const
+{
+    size_t seed = mMasks.size();
+    for (const auto &i : mMasks) {
+        hashCombine(seed, i.mRasterizer.generation());
+        hashCombine(seed, i.mCombinedAlpha);
+    }
+    return seed;
+}
+
 renderer::LayerMask::LayerMask(model::Layer *layerData)
 {
     if (!layerData->mExtra) return;
@@ -276,7 +763,7 @@ renderer::LayerMask::LayerMask(model::Layer *layerData)
     }
 }
 
-void renderer::LayerMask::update(int frameNo, const VMatrix &parentMatrix,
+void renderer::LayerMask::update(float frameNo, const VMatrix &parentMatrix,
                                  float parentAlpha, const DirtyFlag &flag)
 {
     if (flag.testFlag(DirtyFlagBit::None) && isStatic()) return;
@@ -387,7 +874,7 @@ bool renderer::CompLayer::resolveKeyPath(LOTKeyPath &keyPath, uint32_t depth,
     return false;
 }
 
-void renderer::Layer::update(int frameNumber, const VMatrix &parentMatrix,
+void renderer::Layer::update(float frameNumber, const VMatrix &parentMatrix,
                              float parentAlpha)
 {
     mFrameNo = frameNumber;
@@ -433,7 +920,7 @@ void renderer::Layer::update(int frameNumber, const VMatrix &parentMatrix,
     mDirtyFlag = DirtyFlagBit::None;
 }
 
-VMatrix renderer::Layer::matrix(int frameNo) const
+VMatrix renderer::Layer::matrix(float frameNo) const
 {
     return mParentLayer
                ? (mLayerData->matrix(frameNo) * mParentLayer->matrix(frameNo))
@@ -457,6 +944,111 @@ void renderer::Layer::preprocess(const VRect &clip)
     preprocessStage(clip);
 }
 
+size_t renderer::Layer::damageContext() const
+{
+    size_t seed = std::hash<float>{}(combinedAlpha());
+    if (mLayerMask) hashCombine(seed, mLayerMask->damageContext());
+    return seed;
+}
+
+/*
+ * a drawable damages the area it covered in the last frame and the area it
+ * covers now when its rle or brush has changed. everything the layer painted
+ * is damaged when the drawable list or anything applied on top of the
+ * drawables (mask, alpha) has changed.
+ */
+void renderer::Layer::collectDamage(VRect &damage, const VRect &, bool dirty,
+                                    bool drawn)
+{
+    size_t context = damageContext();
+    dirty |= (context != mDamageContext);
+    mDamageContext = context;
+
+    auto list = (drawn && !skipRendering()) ? renderList() : DrawableList();
+
+    if (dirty || list.size() != mDamageRecords.size()) {
+        for (const auto &record : mDamageRecords) damage |= record.mRect;
+        mDamageRecords.resize(list.size());
+        dirty = true;
+    }
+
+    for (size_t i = 0; i < list.size(); i++) {
+        auto & record = mDamageRecords[i];
+        auto   drawable = list[i];
+        VRect  rect = drawable->rle().boundingRect();
+        size_t generation = drawable->mRasterizer.generation();
+
+        if (dirty || record.mDrawable != drawable ||
+            record.mGeneration != generation ||
+            !(record.mBrush == drawable->mBrush)) {
+            damage |= record.mRect;
+            damage |= rect;
+            record.mBrush.save(drawable->mBrush);
+        }
+        record.mDrawable = drawable;
+        record.mRect = rect;
+        record.mGeneration = generation;
+    }
+}
+
+/*
+ * a composited area is blended as a whole, even its transparent pixels
+ * round the destination, so it is damaged whenever it moves or its
+ * blending parameters change.
+ */
+static void damageArea(VRect &damage, VRect &last, const VRect &rect,
+                       bool dirty)
+{
+    if (dirty || last != rect) {
+        damage |= last;
+        damage |= rect;
+    }
+    last = rect;
+}
+
+void renderer::Layer::collectMatteDamage(VRect &damage, const VRect &rect,
+                                         bool dirty)
+{
+    damageArea(damage, mMatteRect, rect, dirty);
+}
+
+void renderer::Layer::syncPreprocess(const VRect &clip)
+{
+    if (skipRendering()) return;
+
+    // build the lazily computed data (mask, rle bounding box, matrix type)
+    // up front.
+    if (mLayerMask) mLayerMask->maskRle(clip).boundingRect();
+
+    for (auto &i : renderList()) {
+        i->rle().boundingRect();
+        switch (i->mBrush.type()) {
+        case VBrush::Type::LinearGradient:
+        case VBrush::Type::RadialGradient:
+            i->mBrush.mGradient->mMatrix.type();
+            break;
+        case VBrush::Type::Texture:
+            i->mBrush.mTexture->mMatrix.type();
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/*
+ * the union of the coverage of the drawables, masks and mattes only take
+ * pixels away from it.
+ */
+VRect renderer::Layer::paintBounds()
+{
+    VRect bounds;
+    if (skipRendering()) return bounds;
+
+    for (auto &i : renderList()) bounds |= i->rle().boundingRect();
+    return bounds;
+}
+
 renderer::CompLayer::CompLayer(model::Layer *layerModel, VArenaAlloc *allocator)
     : renderer::Layer(layerModel)
 {
@@ -491,6 +1083,56 @@ renderer::CompLayer::CompLayer(model::Layer *layerModel, VArenaAlloc *allocator)
     if (mLayers.size() > 1) setComplexContent(true);
 }
 
+/*
+ * a track matte pass only changes the pixels the layer paints, and unless
+ * the matte is inverted only where the matte source paints as well.
+ */
+static VRect matteArea(renderer::Layer *layer, renderer::Layer *src)
+{
+    VRect area = layer->paintBounds();
+    switch (layer->matteType()) {
+    case model::MatteType::Alpha:
+    case model::MatteType::Luma:
+        return area & src->paintBounds();
+    default:
+        return area;
+    }
+}
+
+/*
+ * clipping every drawable by the matte gives the same pixels as clipping
+ * the composited layer only when no two drawables overlap.
+ */
+static bool disjointContent(renderer::Layer *layer)
+{
+    static constexpr size_t maxDrawables = 32;
+
+    auto list = layer->renderList();
+    if (list.empty() || list.size() > maxDrawables) return false;
+
+    for (size_t i = 0; i < list.size(); i++) {
+        VRect rect = list[i]->rle().boundingRect();
+        for (size_t j = i + 1; j < list.size(); j++)
+            if (rect.intersects(list[j]->rle().boundingRect())) return false;
+    }
+    return true;
+}
+
+/*
+ * begins painting into an offscreen bitmap that backs the clip area
+ * of the parent painter, the offscreen painter keeps the same coordinate
+ * space and image quality as the parent.
+ */
+static void beginOffscreen(VPainter *painter, VBitmap *bitmap,
+                           const VRect &area, const VPainter *parent)
+{
+    painter->begin(bitmap);
+    painter->setDrawRegion(
+        VRect(-area.x(), -area.y(), area.right(), area.bottom()));
+    painter->setClipRect(area);
+    painter->setSmoothImage(parent->smoothImage());
+}
+
 void renderer::CompLayer::render(VPainter *painter, const VRle &inheritMask,
                                  const VRle &matteRle, SurfaceCache &cache)
 {
@@ -500,13 +1142,14 @@ void renderer::CompLayer::render(VPainter *painter, const VRle &inheritMask,
         renderHelper(painter, inheritMask, matteRle, cache);
     } else {
         if (complexContent()) {
-            VSize    size = painter->clipBoundingRect().size();
+            VRect    area = painter->clipBoundingRect();
             VPainter srcPainter;
-            VBitmap srcBitmap = cache.make_surface(size.width(), size.height());
-            srcPainter.begin(&srcBitmap);
+            VBitmap  srcBitmap =
+                cache.make_surface(area.width(), area.height());
+            beginOffscreen(&srcPainter, &srcBitmap, area, painter);
             renderHelper(&srcPainter, inheritMask, matteRle, cache);
             srcPainter.end();
-            painter->drawBitmap(VPoint(), srcBitmap,
+            painter->drawBitmap(VPoint(area.x(), area.y()), srcBitmap,
                                 uint8_t(combinedAlpha() * 255.0f));
             cache.release_surface(srcBitmap);
         } else {
@@ -560,19 +1203,35 @@ void renderer::CompLayer::renderMatteLayer(VPainter *painter, const VRle &mask,
                                            renderer::Layer *src,
                                            SurfaceCache &   cache)
 {
-    VSize size = painter->clipBoundingRect().size();
-    // Decide if we can use fast matte.
+    // the offscreen buffers only cover the area the pass can change.
+    VRect area = painter->clipBoundingRect() & matteArea(layer, src);
+    if (area.empty()) return;
+
+    // an alpha matte of solid shapes is just a coverage, the layer can be
+    // clipped by it in the rle domain and painted without offscreen buffers.
+    auto type = layer->matteType();
+    if ((type == model::MatteType::Alpha ||
+         type == model::MatteType::AlphaInv) &&
+        matteRle.empty() && disjointContent(layer)) {
+        static vthread_local VRle coverage;
+        if (src->alphaRle(area, mask, coverage)) {
+            if (coverage.empty() && type == model::MatteType::Alpha) return;
+            layer->render(painter, mask, coverage, cache);
+            return;
+        }
+    }
+
     // 1. draw src layer to matte buffer
     VPainter srcPainter;
-    VBitmap  srcBitmap = cache.make_surface(size.width(), size.height());
-    srcPainter.begin(&srcBitmap);
+    VBitmap  srcBitmap = cache.make_surface(area.width(), area.height());
+    beginOffscreen(&srcPainter, &srcBitmap, area, painter);
     src->render(&srcPainter, mask, matteRle, cache);
     srcPainter.end();
 
     // 2. draw layer to layer buffer
     VPainter layerPainter;
-    VBitmap  layerBitmap = cache.make_surface(size.width(), size.height());
-    layerPainter.begin(&layerBitmap);
+    VBitmap  layerBitmap = cache.make_surface(area.width(), area.height());
+    beginOffscreen(&layerPainter, &layerBitmap, area, painter);
     layer->render(&layerPainter, mask, matteRle, cache);
 
     // 2.1update composition mode
@@ -597,26 +1256,70 @@ void renderer::CompLayer::renderMatteLayer(VPainter *painter, const VRle &mask,
         srcBitmap.updateLuma();
     }
 
-    auto clip = layerPainter.clipBoundingRect();
-
-    // if the layer has only one renderer then use it as the clip rect
-    // when blending 2 buffer and copy back to final buffer to avoid
-    // unnecessary pixel processing.
-    if (layer->renderList().size() == 1)
-    {
-        clip = layer->renderList()[0]->rle().boundingRect();
-    }
+    // offscreen buffers start at the top left corner of the area.
+    auto source = area.translated(-area.x(), -area.y());
 
     // 2.3 draw src buffer as mask
-    layerPainter.drawBitmap(clip, srcBitmap, clip);
+    layerPainter.drawBitmap(area, srcBitmap, source);
     layerPainter.end();
     // 3. draw the result buffer into painter
-    painter->drawBitmap(clip, layerBitmap, clip);
+    painter->drawBitmap(area, layerBitmap, source);
 
     cache.release_surface(srcBitmap);
     cache.release_surface(layerBitmap);
 }
 
+size_t renderer::CompLayer::damageContext() const
+{
+    size_t seed = renderer::Layer::damageContext();
+    if (mClipper) hashCombine(seed, mClipper->mRasterizer.generation());
+    hashCombine(seed, complexContent());
+    return seed;
+}
+
+/*
+ * matte and alpha compositing work pixel by pixel, so the damage of a
+ * composition is the union of the damage of its layers and of the areas
+ * it blends.
+ */
+void renderer::CompLayer::collectDamage(VRect &damage, const VRect &clip,
+                                        bool dirty, bool drawn)
+{
+    size_t context = damageContext();
+    dirty |= (context != mDamageContext);
+    mDamageContext = context;
+
+    drawn &= !skipRendering();
+
+    // same rule as render(), the offscreen buffer covers the whole clip.
+    VRect offscreen;
+    if (drawn && complexContent() && !vCompare(combinedAlpha(), 1.0))
+        offscreen = clip;
+    damageArea(damage, mOffscreenRect, offscreen, dirty);
+
+    renderer::Layer *matte = nullptr;
+    for (const auto &layer : mLayers) {
+        if (layer->hasMatte()) {
+            matte = layer;
+        } else {
+            if (matte) {
+                bool pair = drawn && layer->visible() && matte->visible();
+                matte->collectDamage(damage, clip, dirty, pair);
+                layer->collectDamage(damage, clip, dirty, pair);
+
+                // same rule as renderMatteLayer()
+                VRect blended;
+                if (pair) blended = clip & matteArea(matte, layer);
+                matte->collectMatteDamage(damage, blended, dirty);
+            } else {
+                layer->collectDamage(damage, clip, dirty,
+                                     drawn && layer->visible());
+            }
+            matte = nullptr;
+        }
+    }
+}
+
 void renderer::Clipper::update(const VMatrix &matrix)
 {
     mPath.reset();
@@ -636,9 +1339,7 @@ VRle renderer::Clipper::rle(const VRle &mask)
 {
     if (mask.empty()) return mRasterizer.rle();
 
-    mMaskedRle.clone(mask);
-    mMaskedRle &= mRasterizer.rle();
-    return mMaskedRle;
+    return mask & mRasterizer.rle();
 }
 
 void renderer::CompLayer::updateContent()
@@ -646,7 +1347,7 @@ void renderer::CompLayer::updateContent()
     if (mClipper && flag().testFlag(DirtyFlagBit::Matrix)) {
         mClipper->update(combinedMatrix());
     }
-    int   mappedFrame = mLayerData->timeRemap(frameNo());
+    float mappedFrame = mLayerData->timeRemap(frameNo());
     float alpha = combinedAlpha();
     if (complexContent()) alpha = 1;
     for (const auto &layer : mLayers) {
@@ -679,6 +1380,61 @@ void renderer::CompLayer::preprocessStage(const VRect &clip)
     }
 }
 
+void renderer::CompLayer::syncPreprocess(const VRect &clip)
+{
+    if (skipRendering()) return;
+
+    renderer::Layer::syncPreprocess(clip);
+
+    if (mClipper) mClipper->rle({}).boundingRect();
+
+    renderer::Layer *matte = nullptr;
+    for (const auto &layer : mLayers) {
+        if (layer->hasMatte()) {
+            matte = layer;
+        } else {
+            if (layer->visible()) {
+                if (matte) {
+                    if (matte->visible()) {
+                        layer->syncPreprocess(clip);
+                        matte->syncPreprocess(clip);
+                    }
+                } else {
+                    layer->syncPreprocess(clip);
+                }
+            }
+            matte = nullptr;
+        }
+    }
+}
+
+VRect renderer::CompLayer::paintBounds()
+{
+    VRect bounds;
+    if (skipRendering()) return bounds;
+
+    // same rule as renderHelper(), a matte source only paints through the
+    // layer it is the matte of.
+    renderer::Layer *matte = nullptr;
+    for (const auto &layer : mLayers) {
+        if (layer->hasMatte()) {
+            matte = layer;
+        } else {
+            if (layer->visible()) {
+                if (matte) {
+                    if (matte->visible()) bounds |= matteArea(matte, layer);
+                } else {
+                    bounds |= layer->paintBounds();
+                }
+            }
+            matte = nullptr;
+        }
+    }
+
+    if (mClipper) bounds = bounds & mClipper->rle({}).boundingRect();
+    return bounds;
+}
+
 renderer::SolidLayer::SolidLayer(model::Layer *layerData)
     : renderer::Layer(layerData)
 {
@@ -722,7 +1478,6 @@ renderer::ImageLayer::ImageLayer(model::Layer *layerData)
 
     if (!mLayerData->asset()) return;
 
-    mTexture.mBitmap = mLayerData->asset()->bitmap();
     VBrush brush(&mTexture);
     mRenderNode.setBrush(brush);
 }
@@ -731,6 +1486,13 @@ void renderer::ImageLayer::updateContent()
 {
     if (!mLayerData->asset()) return;
 
+    // the image is decoded when the layer becomes visible the first time.
+    if (!mImageLoaded) {
+        mImageLoaded = true;
+        mTexture.mBitmap = mLayerData->asset()->bitmap();
+        mRenderNode.mFlag |= VDrawable::DirtyState::Brush;
+    }
+
     if (flag() & DirtyFlagBit::Matrix) {
         mPath.reset();
         mPath.addRect(VRectF(0, 0, mLayerData->asset()->mWidth,
@@ -836,6 +1598,7 @@ renderer::ShapeLayer::ShapeLayer(model::Layer *layerData,
 
 void renderer::ShapeLayer::updateContent()
 {
+    mDrawableListDirty = true;
     mRoot->update(frameNo(), combinedMatrix(), combinedAlpha(), flag());
 
     if (mLayerData->hasPathOperator()) {
@@ -847,6 +1610,7 @@ void renderer::ShapeLayer::preprocessStage(const VRect &clip)
 {
     mDrawableList.clear();
     mRoot->renderList(mDrawableList);
+    mDrawableListDirty = false;
 
     for (auto &drawable : mDrawableList) drawable->preprocess(clip);
 }
@@ -855,8 +1619,9 @@ renderer::DrawableList renderer::ShapeLayer::renderList()
 {
     if (skipRendering()) return {};
 
-    mDrawableList.clear();
-    mRoot->renderList(mDrawableList);
+    // the band painters read the list concurrently, so it is built once in
+    // preprocessStage() / buildLayerNode() and never here.
+    assert(!mDrawableListDirty);
 
     if (mDrawableList.empty()) return {};
 
@@ -941,7 +1706,7 @@ void renderer::Group::addChildren(model::Group *data, VArenaAlloc *allocator)
     }
 }
 
-void renderer::Group::update(int frameNo, const VMatrix &parentMatrix,
+void renderer::Group::update(float frameNo, const VMatrix &parentMatrix,
                              float parentAlpha, const DirtyFlag &flag)
 {
     DirtyFlag newFlag = flag;
@@ -1052,11 +1817,13 @@ void renderer::Group::processTrimItems(std::vector<renderer::Shape *> &list)
 }
 
 /*
- * renderer::Shape uses 2 path objects for path object reuse.
+ * renderer::Shape uses 3 path objects for path object reuse.
  * mLocalPath -  keeps track of the local path of the item before
  * applying path operation and transformation.
  * mTemp - keeps a referece to the mLocalPath and can be updated by the
  *          path operation objects(trim, merge path),
+ * mTrimPath - holds the result of a trim, so the trimmed path reuses its
+ *          storage from frame to frame,
  * We update the DirtyPath flag if the path needs to be updated again
  * beacuse of local path or matrix or some path operation has changed which
  * affects the final path.
@@ -1068,7 +1835,7 @@ void renderer::Group::processTrimItems(std::vector<renderer::Shape *> &list)
  * carefull about the refcount so that we don't generate deep copy while
  * modifying the path objects.
  */
-void renderer::Shape::update(int              frameNo, const VMatrix &, float,
+void renderer::Shape::update(float              frameNo, const VMatrix &, float,
                              const DirtyFlag &flag)
 {
     mDirtyPath = false;
@@ -1103,7 +1870,7 @@ renderer::Rect::Rect(model::Rect *data)
 {
 }
 
-void renderer::Rect::updatePath(VPath &path, int frameNo)
+void renderer::Rect::updatePath(VPath &path, float frameNo)
 {
     VPointF pos = mData->mPos.value(frameNo);
     VPointF size = mData->mSize.value(frameNo);
@@ -1120,7 +1887,7 @@ renderer::Ellipse::Ellipse(model::Ellipse *data)
 {
 }
 
-void renderer::Ellipse::updatePath(VPath &path, int frameNo)
+void renderer::Ellipse::updatePath(VPath &path, float frameNo)
 {
     VPointF pos = mData->mPos.value(frameNo);
     VPointF size = mData->mSize.value(frameNo);
@@ -1136,7 +1903,7 @@ renderer::Path::Path(model::Path *data)
 {
 }
 
-void renderer::Path::updatePath(VPath &path, int frameNo)
+void renderer::Path::updatePath(VPath &path, float frameNo)
 {
     mData->mShape.value(frameNo, path);
 }
@@ -1146,7 +1913,7 @@ renderer::Polystar::Polystar(model::Polystar *data)
 {
 }
 
-void renderer::Polystar::updatePath(VPath &path, int frameNo)
+void renderer::Polystar::updatePath(VPath &path, float frameNo)
 {
     VPointF pos = mData->mPos.value(frameNo);
     float   points = mData->mPointCount.value(frameNo);
@@ -1178,7 +1945,7 @@ void renderer::Polystar::updatePath(VPath &path, int frameNo)
  */
 renderer::Paint::Paint(bool staticContent) : mStaticContent(staticContent) {}
 
-void renderer::Paint::update(int frameNo, const VMatrix &parentMatrix,
+void renderer::Paint::update(float frameNo, const VMatrix &parentMatrix,
                              float parentAlpha, const DirtyFlag & /*flag*/)
 {
     mRenderNodeUpdate = true;
@@ -1196,6 +1963,9 @@ void renderer::Paint::updateRenderNode()
     }
 
     if (dirty) {
+        // a drawable that was not rendered still shares the last path,
+        // let go of it so the path is rebuilt in place.
+        mDrawable.mPath = VPath();
         mPath.reset();
         for (const auto &i : mPathItems) {
             i->finalPath(mPath);
@@ -1238,7 +2008,7 @@ renderer::Fill::Fill(model::Fill *data)
     mDrawable.setName(mModel.name());
 }
 
-bool renderer::Fill::updateContent(int frameNo, const VMatrix &, float alpha)
+bool renderer::Fill::updateContent(float frameNo, const VMatrix &, float alpha)
 {
     auto combinedAlpha = alpha * mModel.opacity(frameNo);
     auto color = mModel.color(frameNo).toColor(combinedAlpha);
@@ -1256,7 +2026,7 @@ renderer::GradientFill::GradientFill(model::GradientFill *data)
     mDrawable.setName(mData->name());
 }
 
-bool renderer::GradientFill::updateContent(int frameNo, const VMatrix &matrix,
+bool renderer::GradientFill::updateContent(float frameNo, const VMatrix &matrix,
                                            float alpha)
 {
     float combinedAlpha = alpha * mData->opacity(frameNo);
@@ -1283,7 +2053,7 @@ renderer::Stroke::Stroke(model::Stroke *data)
 
 static vthread_local std::vector<float> Dash_Vector;
 
-bool renderer::Stroke::updateContent(int frameNo, const VMatrix &matrix,
+bool renderer::Stroke::updateContent(float frameNo, const VMatrix &matrix,
                                      float alpha)
 {
     auto combinedAlpha = alpha * mModel.opacity(frameNo);
@@ -1319,7 +2089,7 @@ renderer::GradientStroke::GradientStroke(model::GradientStroke *data)
     }
 }
 
-bool renderer::GradientStroke::updateContent(int frameNo, const VMatrix &matrix,
+bool renderer::GradientStroke::updateContent(float frameNo, const VMatrix &matrix,
                                              float alpha)
 {
     float combinedAlpha = alpha * mData->opacity(frameNo);
@@ -1344,7 +2114,7 @@ bool renderer::GradientStroke::updateContent(int frameNo, const VMatrix &matrix,
     return !vIsZero(combinedAlpha);
 }
 
-void renderer::Trim::update(int frameNo, const VMatrix & /*parentMatrix*/,
+void renderer::Trim::update(float frameNo, const VMatrix & /*parentMatrix*/,
                             float /*parentAlpha*/, const DirtyFlag & /*flag*/)
 {
     mDirty = false;
@@ -1383,7 +2153,7 @@ void renderer::Trim::update()
     if (mData->type() == model::Trim::TrimType::Simultaneously) {
         for (auto &i : mPathItems) {
             mPathMesure.setRange(mCache.mSegment.start, mCache.mSegment.end);
-            i->updatePath(mPathMesure.trim(i->localPath()));
+            i->trimPath(mPathMesure);
         }
     } else {  // model::Trim::TrimType::Individually
         float totalLength = 0.0;
@@ -1418,7 +2188,7 @@ void renderer::Trim::update()
                     float local_end = curLen + len < end ? len : end - curLen;
                     local_end /= len;
                     mPathMesure.setRange(local_start, local_end);
-                    i->updatePath(mPathMesure.trim(i->localPath()));
+                    i->trimPath(mPathMesure);
                     curLen += len;
                 }
             }
@@ -1448,7 +2218,7 @@ renderer::Repeater::Repeater(model::Repeater *data, VArenaAlloc *allocator)
     }
 }
 
-void renderer::Repeater::update(int frameNo, const VMatrix &parentMatrix,
+void renderer::Repeater::update(float frameNo, const VMatrix &parentMatrix,
                                 float parentAlpha, const DirtyFlag &flag)
 {
     DirtyFlag newFlag = flag;
@@ -23,6 +23,8 @@
 #ifndef LOTTIEITEM_H
 #define LOTTIEITEM_H
 
+#include <array>
+#include <functional>
 #include <memory>
 #include <sstream>
 
@@ -88,28 +90,22 @@ enum class DirtyFlagBit : uint8_t {
 };
 typedef vFlag<DirtyFlagBit> DirtyFlag;
 
-class SurfaceCache {
-public:
-    SurfaceCache() { mCache.reserve(10); }
-
-    VBitmap make_surface(
-        size_t width, size_t height,
-        VBitmap::Format format = VBitmap::Format::ARGB32_Premultiplied)
-    {
-        if (mCache.empty()) return {width, height, format};
+/*
+ * Runs job(0) ... job(count - 1) on the render thread pool and returns
+ * once all of them are finished. The calling thread takes part in the
+ * work so it is safe to call it from a render task.
+ */
+void parallelFor(size_t count, const std::function<void(size_t)> &job);
 
-        auto surface = mCache.back();
-        surface.reset(width, height, format);
+// offscreen surfaces of the matte and complex content passes, shared by
+// all the animations. see configureSurfaceCacheSize().
+class SurfaceCache;
 
-        mCache.pop_back();
-        return surface;
-    }
+void configureSurfaceCacheSize(size_t bytes);
 
-    void release_surface(VBitmap &surface) { mCache.push_back(surface); }
+void trimSurfaceCache(size_t bytes);
 
-private:
-    std::vector<VBitmap> mCache;
-};
+rlottie::SurfaceCacheStats surfaceCacheStats();
 
 class Drawable final : public VDrawable {
 public:
@@ -143,7 +139,6 @@ public:
 public:
     VSize       mSize;
     VPath       mPath;
-    VRle        mMaskedRle;
     VRasterizer mRasterizer;
     bool        mRasterRequest{false};
 };
@@ -151,7 +146,7 @@ public:
 class Mask {
 public:
     explicit Mask(model::Mask *data) : mData(data) {}
-    void update(int frameNo, const VMatrix &parentMatrix, float parentAlpha,
+    void update(float frameNo, const VMatrix &parentMatrix, float parentAlpha,
                 const DirtyFlag &flag);
     model::Mask::Mode maskMode() const { return mData->mMode; }
     VRle              rle();
@@ -172,11 +167,12 @@ public:
 class LayerMask {
 public:
     explicit LayerMask(model::Layer *layerData);
-    void update(int frameNo, const VMatrix &parentMatrix, float parentAlpha,
+    void update(float frameNo, const VMatrix &parentMatrix, float parentAlpha,
                 const DirtyFlag &flag);
     bool isStatic() const { return mStatic; }
     VRle maskRle(const VRect &clipRect);
     void preprocess(const VRect &clip);
+    size_t damageContext() const;
 
 public:
     std::vector<Mask> mMasks;
@@ -190,23 +186,47 @@ class Layer;
 class Composition {
 public:
     explicit Composition(std::shared_ptr<model::Composition> composition);
-    bool  update(int frameNo, const VSize &size, bool keepAspectRatio);
+    bool  update(float frameNo, const VSize &size, bool keepAspectRatio);
     VSize size() const { return mViewSize; }
     void  buildRenderTree();
     const LOTLayerNode *renderTree() const;
-    bool                render(const rlottie::Surface &surface);
+    bool                render(const rlottie::Surface &surface,
+                               size_t                  bands = 1);
+    // render() split in two steps so that the rasterization of one frame
+    // can overlap with the painting of another.
+    void                preprocess(const rlottie::Surface &surface);
+    bool                paint(const rlottie::Surface &surface,
+                              size_t                  bands = 1);
+    // renders only the part of the surface that changed since the last
+    // renderDamage() into the same buffer, returns the repainted area.
+    VRect               renderDamage(const rlottie::Surface &surface,
+                                     size_t                  bands = 1);
+    const std::shared_ptr<model::Composition> &model() const { return mModel; }
     void                setValue(const std::string &keypath, LOTVariant &value);
+    // bilinear filtering of transformed image layers.
+    void                setSmoothImage(bool smooth) { mSmoothImage = smooth; }
 
 private:
-    SurfaceCache                        mSurfaceCache;
+    void paintArea(const rlottie::Surface &surface, const VRect &area,
+                   size_t bands);
+
+    struct DamageFrame {
+        const uint32_t *mBuffer;
+        VRect           mDamage;  // change since the previous frame
+    };
+
+    // recent renderDamage() frames, to repaint buffers of a swap chain.
+    std::vector<DamageFrame>            mDamageHistory;
+    std::array<size_t, 8>               mDamageGeometry{};
     VBitmap                             mSurface;
     VMatrix                             mScaleMatrix;
     VSize                               mViewSize;
     std::shared_ptr<model::Composition> mModel;
     Layer *                             mRootLayer{nullptr};
     VArenaAlloc                         mAllocator{2048};
-    int                                 mCurFrameNo;
+    float                               mCurFrameNo;
     bool                                mKeepAspectRatio{true};
+    bool                                mSmoothImage{false};
 };
 
 class Layer {
@@ -219,13 +239,23 @@ public:
     void         setParentLayer(Layer *parent) { mParentLayer = parent; }
     void         setComplexContent(bool value) { mComplexContent = value; }
     bool         complexContent() const { return mComplexContent; }
-    virtual void update(int frameNo, const VMatrix &parentMatrix,
+    virtual void update(float frameNo, const VMatrix &parentMatrix,
                         float parentAlpha);
-    VMatrix      matrix(int frameNo) const;
+    VMatrix      matrix(float frameNo) const;
     void         preprocess(const VRect &clip);
+    virtual void syncPreprocess(const VRect &clip);
     virtual DrawableList renderList() { return {}; }
+    // area the layer paints into in the current frame.
+    virtual VRect        paintBounds();
     virtual void         render(VPainter *painter, const VRle &mask,
                                 const VRle &matteRle, SurfaceCache &cache);
+    // alpha the layer paints inside clip, false if an rle can't express it.
+    virtual bool alphaRle(const VRect &clip, const VRle &mask, VRle &result);
+    // adds the area whose pixels changed since the last call to damage.
+    virtual void collectDamage(VRect &damage, const VRect &clip, bool dirty,
+                               bool drawn);
+    void         collectMatteDamage(VRect &damage, const VRect &rect,
+                                    bool dirty);
     bool                 hasMatte()
     {
         if (mLayerData->mMatteType == model::MatteType::None) return false;
@@ -246,23 +276,53 @@ protected:
     virtual void   preprocessStage(const VRect &clip) = 0;
     virtual void   updateContent() = 0;
     inline VMatrix combinedMatrix() const { return mCombinedMatrix; }
-    inline int     frameNo() const { return mFrameNo; }
+    inline float   frameNo() const { return mFrameNo; }
     inline float   combinedAlpha() const { return mCombinedAlpha; }
     inline bool    isStatic() const { return mLayerData->isStatic(); }
-    float opacity(int frameNo) const { return mLayerData->opacity(frameNo); }
+    float opacity(float frameNo) const { return mLayerData->opacity(frameNo); }
     inline DirtyFlag flag() const { return mDirtyFlag; }
     bool             skipRendering() const
     {
         return (!visible() || vIsZero(combinedAlpha()));
     }
+    virtual size_t damageContext() const;
 
 protected:
+    // the brush of a drawable in the last frame collectDamage() has seen.
+    struct BrushState {
+        bool operator==(const VBrush &brush) const;
+        void save(const VBrush &brush);
+
+        VBrush::Type      mType{VBrush::Type::NoBrush};
+        VColor            mColor;
+        VGradient::Spread mSpread{VGradient::Spread::Pad};
+        VGradient::Mode   mMode{VGradient::Mode::Absolute};
+        float             mAlpha{0};
+        VGradientStops    mStops;
+        VGradient::Linear mLinear;
+        VGradient::Radial mRadial;
+        VMatrix           mMatrix;
+        const uint8_t *   mBitmap{nullptr};
+        int               mTextureAlpha{0};
+    };
+
+    // what a drawable painted in the last frame collectDamage() has seen.
+    struct DamageRecord {
+        const VDrawable *mDrawable{nullptr};
+        VRect            mRect;
+        size_t           mGeneration{0};
+        BrushState       mBrush;
+    };
+
+    std::vector<DamageRecord>  mDamageRecords;
+    size_t                     mDamageContext{0};
+    VRect                      mMatteRect;  // area blended by the matte
     std::unique_ptr<LayerMask> mLayerMask;
     model::Layer *             mLayerData{nullptr};
     Layer *                    mParentLayer{nullptr};
     VMatrix                    mCombinedMatrix;
     float                      mCombinedAlpha{0.0};
-    int                        mFrameNo{-1};
+    float                      mFrameNo{-1};
     DirtyFlag                  mDirtyFlag{DirtyFlagBit::All};
     bool                       mComplexContent{false};
     std::unique_ptr<CApiData>  mCApiData;
@@ -274,13 +334,19 @@ public:
 
     void render(VPainter *painter, const VRle &mask, const VRle &matteRle,
                 SurfaceCache &cache) final;
-    void buildLayerNode() final;
+    void collectDamage(VRect &damage, const VRect &clip, bool dirty,
+                       bool drawn) final;
+    void  syncPreprocess(const VRect &clip) final;
+    VRect paintBounds() final;
+    bool  alphaRle(const VRect &, const VRle &, VRle &) final { return false; }
+    void  buildLayerNode() final;
     bool resolveKeyPath(LOTKeyPath &keyPath, uint32_t depth,
                         LOTVariant &value) override;
 
 protected:
-    void preprocessStage(const VRect &clip) final;
-    void updateContent() final;
+    void   preprocessStage(const VRect &clip) final;
+    void   updateContent() final;
+    size_t damageContext() const final;
 
 private:
     void renderHelper(VPainter *painter, const VRle &mask, const VRle &matteRle,
@@ -292,6 +358,7 @@ private:
 private:
     std::vector<Layer *>     mLayers;
     std::unique_ptr<Clipper> mClipper;
+    VRect                    mOffscreenRect;  // area blended with the alpha
 };
 
 class SolidLayer final : public Layer {
@@ -315,6 +382,8 @@ class Group;
 class ShapeLayer final : public Layer {
 public:
     explicit ShapeLayer(model::Layer *layerData, VArenaAlloc *allocator);
+    // the list is built by preprocess() or buildLayerNode(), it can only be
+    // read after one of them ran for the current frame.
     DrawableList renderList() final;
     void         buildLayerNode() final;
     bool         resolveKeyPath(LOTKeyPath &keyPath, uint32_t depth,
@@ -325,6 +394,7 @@ protected:
     void                     updateContent() final;
     std::vector<VDrawable *> mDrawableList;
     Group *                  mRoot{nullptr};
+    bool                     mDrawableListDirty{true};
 };
 
 class NullLayer final : public Layer {
@@ -351,6 +421,7 @@ private:
     VTexture   mTexture;
     VPath      mPath;
     VDrawable *mDrawableList{nullptr};  // to work with the Span api
+    bool       mImageLoaded{false};
 };
 
 class Object {
@@ -358,7 +429,7 @@ public:
     enum class Type : uint8_t { Unknown, Group, Shape, Paint, Trim };
     virtual ~Object() = default;
     Object &     operator=(Object &&) noexcept = delete;
-    virtual void update(int frameNo, const VMatrix &parentMatrix,
+    virtual void update(float frameNo, const VMatrix &parentMatrix,
                         float parentAlpha, const DirtyFlag &flag) = 0;
     virtual void renderList(std::vector<VDrawable *> &) {}
     virtual bool resolveKeyPath(LOTKeyPath &, uint32_t, LOTVariant &)
@@ -374,7 +445,7 @@ public:
     Group() = default;
     explicit Group(model::Group *data, VArenaAlloc *allocator);
     void addChildren(model::Group *data, VArenaAlloc *allocator);
-    void update(int frameNo, const VMatrix &parentMatrix, float parentAlpha,
+    void update(float frameNo, const VMatrix &parentMatrix, float parentAlpha,
                 const DirtyFlag &flag) override;
     void applyTrim();
     void processTrimItems(std::vector<Shape *> &list);
@@ -401,7 +472,7 @@ private:
 class Shape : public Object {
 public:
     Shape(bool staticPath) : mStaticPath(staticPath) {}
-    void update(int frameNo, const VMatrix &parentMatrix, float parentAlpha,
+    void update(float frameNo, const VMatrix &parentMatrix, float parentAlpha,
                 const DirtyFlag &flag) final;
     Object::Type type() const final { return Object::Type::Shape; }
     bool         dirty() const { return mDirtyPath; }
@@ -412,18 +483,23 @@ public:
         mTemp = path;
         mDirtyPath = true;
     }
+    void         trimPath(VPathMesure &mesure)
+    {
+        mesure.trim(mTemp, mTrimPath);
+        updatePath(mTrimPath);
+    }
     bool   staticPath() const { return mStaticPath; }
     void   setParent(Group *parent) { mParent = parent; }
     Group *parent() const { return mParent; }
 
 protected:
-    virtual void updatePath(VPath &path, int frameNo) = 0;
-    virtual bool hasChanged(int prevFrame, int curFrame) = 0;
+    virtual void updatePath(VPath &path, float frameNo) = 0;
+    virtual bool hasChanged(float prevFrame, float curFrame) = 0;
 
 private:
-    bool hasChanged(int frameNo)
+    bool hasChanged(float frameNo)
     {
-        int prevFrame = mFrameNo;
+        float prevFrame = mFrameNo;
         mFrameNo = frameNo;
         if (prevFrame == -1) return true;
         if (mStaticPath || (prevFrame == frameNo)) return false;
@@ -432,7 +508,8 @@ private:
     Group *mParent{nullptr};
     VPath  mLocalPath;
     VPath  mTemp;
-    int    mFrameNo{-1};
+    VPath  mTrimPath;
+    float  mFrameNo{-1};
     bool   mDirtyPath{true};
     bool   mStaticPath;
 };
@@ -442,10 +519,10 @@ public:
     explicit Rect(model::Rect *data);
 
 protected:
-    void         updatePath(VPath &path, int frameNo) final;
+    void         updatePath(VPath &path, float frameNo) final;
     model::Rect *mData{nullptr};
 
-    bool hasChanged(int prevFrame, int curFrame) final
+    bool hasChanged(float prevFrame, float curFrame) final
     {
         return (mData->mPos.changed(prevFrame, curFrame) ||
                 mData->mSize.changed(prevFrame, curFrame) ||
@@ -458,9 +535,9 @@ public:
     explicit Ellipse(model::Ellipse *data);
 
 private:
-    void            updatePath(VPath &path, int frameNo) final;
+    void            updatePath(VPath &path, float frameNo) final;
     model::Ellipse *mData{nullptr};
-    bool            hasChanged(int prevFrame, int curFrame) final
+    bool            hasChanged(float prevFrame, float curFrame) final
     {
         return (mData->mPos.changed(prevFrame, curFrame) ||
                 mData->mSize.changed(prevFrame, curFrame));
@@ -472,9 +549,9 @@ public:
     explicit Path(model::Path *data);
 
 private:
-    void         updatePath(VPath &path, int frameNo) final;
+    void         updatePath(VPath &path, float frameNo) final;
     model::Path *mData{nullptr};
-    bool         hasChanged(int prevFrame, int curFrame) final
+    bool         hasChanged(float prevFrame, float curFrame) final
     {
         return mData->mShape.changed(prevFrame, curFrame);
     }
@@ -485,10 +562,10 @@ public:
     explicit Polystar(model::Polystar *data);
 
 private:
-    void             updatePath(VPath &path, int frameNo) final;
+    void             updatePath(VPath &path, float frameNo) final;
     model::Polystar *mData{nullptr};
 
-    bool hasChanged(int prevFrame, int curFrame) final
+    bool hasChanged(float prevFrame, float curFrame) final
     {
         return (mData->mPos.changed(prevFrame, curFrame) ||
                 mData->mPointCount.changed(prevFrame, curFrame) ||
@@ -504,13 +581,13 @@ class Paint : public Object {
 public:
     Paint(bool staticContent);
     void addPathItems(std::vector<Shape *> &list, size_t startOffset);
-    void update(int frameNo, const VMatrix &parentMatrix, float parentAlpha,
+    void update(float frameNo, const VMatrix &parentMatrix, float parentAlpha,
                 const DirtyFlag &flag) override;
     void renderList(std::vector<VDrawable *> &list) final;
     Object::Type type() const final { return Object::Type::Paint; }
 
 protected:
-    virtual bool updateContent(int frameNo, const VMatrix &matrix,
+    virtual bool updateContent(float frameNo, const VMatrix &matrix,
                                float alpha) = 0;
 
 private:
@@ -531,7 +608,7 @@ public:
     explicit Fill(model::Fill *data);
 
 protected:
-    bool updateContent(int frameNo, const VMatrix &matrix, float alpha) final;
+    bool updateContent(float frameNo, const VMatrix &matrix, float alpha) final;
     bool resolveKeyPath(LOTKeyPath &keyPath, uint32_t depth,
                         LOTVariant &value) final;
 
@@ -544,7 +621,7 @@ public:
     explicit GradientFill(model::GradientFill *data);
 
 protected:
-    bool updateContent(int frameNo, const VMatrix &matrix, float alpha) final;
+    bool updateContent(float frameNo, const VMatrix &matrix, float alpha) final;
 
 private:
     model::GradientFill *      mData{nullptr};
@@ -556,7 +633,7 @@ public:
     explicit Stroke(model::Stroke *data);
 
 protected:
-    bool updateContent(int frameNo, const VMatrix &matrix, float alpha) final;
+    bool updateContent(float frameNo, const VMatrix &matrix, float alpha) final;
     bool resolveKeyPath(LOTKeyPath &keyPath, uint32_t depth,
                         LOTVariant &value) final;
 
@@ -569,7 +646,7 @@ public:
     explicit GradientStroke(model::GradientStroke *data);
 
 protected:
-    bool updateContent(int frameNo, const VMatrix &matrix, float alpha) final;
+    bool updateContent(float frameNo, const VMatrix &matrix, float alpha) final;
 
 private:
     model::GradientStroke *    mData{nullptr};
@@ -579,7 +656,7 @@ private:
 class Trim final : public Object {
 public:
     explicit Trim(model::Trim *data) : mData(data) {}
-    void update(int frameNo, const VMatrix &parentMatrix, float parentAlpha,
+    void update(float frameNo, const VMatrix &parentMatrix, float parentAlpha,
                 const DirtyFlag &flag) final;
     Object::Type type() const final { return Object::Type::Trim; }
     void         update();
@@ -594,7 +671,7 @@ private:
         return false;
     }
     struct Cache {
-        int                  mFrameNo{-1};
+        float                mFrameNo{-1};
         model::Trim::Segment mSegment{};
     };
     Cache                mCache;
@@ -607,7 +684,7 @@ private:
 class Repeater final : public Group {
 public:
     explicit Repeater(model::Repeater *data, VArenaAlloc *allocator);
-    void update(int frameNo, const VMatrix &parentMatrix, float parentAlpha,
+    void update(float frameNo, const VMatrix &parentMatrix, float parentAlpha,
                 const DirtyFlag &flag) final;
     void renderList(std::vector<VDrawable *> &list) final;
 
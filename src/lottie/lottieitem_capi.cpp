@@ -70,6 +70,10 @@ void renderer::ShapeLayer::buildLayerNode()
 {
     renderer::Layer::buildLayerNode();
 
+    mDrawableList.clear();
+    if (!skipRendering()) mRoot->renderList(mDrawableList);
+    mDrawableListDirty = false;
+
     auto renderlist = renderList();
 
     cnodes().clear();
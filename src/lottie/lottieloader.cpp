@@ -22,17 +22,27 @@
 
 #include <cstring>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 
 #include "lottiemodel.h"
+#include "vimageloader.h"
 
 using namespace rlottie::internal;
 
 #ifdef LOTTIE_CACHE_SUPPORT
 
+#include <limits>
+#include <list>
 #include <mutex>
 #include <unordered_map>
 
+/*
+ * Keeps the parsed compositions in least recently used order. The cache
+ * is bounded both by the number of compositions and by the bytes they
+ * hold, so one big composition with embedded images doesn't cost the
+ * same as a small sticker.
+ */
 class ModelCache {
 public:
     static ModelCache &instance()
@@ -44,23 +54,36 @@ public:
     {
         std::lock_guard<std::mutex> guard(mMutex);
 
-        if (!mcacheSize) return nullptr;
+        if (!mcacheSize || !mBudget) return nullptr;
 
         auto search = mHash.find(key);
-
-        return (search != mHash.end()) ? search->second : nullptr;
+        if (search == mHash.end()) {
+            mStats.misses++;
+            return nullptr;
+        }
+
+        mStats.hits++;
+        // move it to the front of the lru list.
+        mList.splice(mList.begin(), mList, search->second);
+        return search->second->mModel;
     }
     void add(const std::string &key, std::shared_ptr<model::Composition> value)
     {
+        size_t cost = value->memorySize();
+
         std::lock_guard<std::mutex> guard(mMutex);
 
-        if (!mcacheSize) return;
+        if (!mcacheSize || cost > mBudget) return;
 
-        //@TODO just remove the 1st element
-        // not the best of LRU logic
-        if (mcacheSize == mHash.size()) mHash.erase(mHash.cbegin());
+        auto search = mHash.find(key);
+        if (search != mHash.end()) erase(search->second);
+
+        mList.push_front({key, std::move(value), cost});
+        mHash[key] = mList.begin();
+        mStats.entries++;
+        mStats.bytes += cost;
 
-        mHash[key] = std::move(value);
+        trim(mcacheSize, mBudget);
     }
 
     void configureCacheSize(size_t cacheSize)
@@ -68,15 +91,291 @@ public:
         std::lock_guard<std::mutex> guard(mMutex);
         mcacheSize = cacheSize;
 
-        if (!mcacheSize) mHash.clear();
+        trim(mcacheSize, mBudget);
+    }
+
+    void configureCacheMemory(size_t bytes)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mBudget = bytes;
+
+        trim(mcacheSize, mBudget);
+    }
+
+    void trim(size_t bytes)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+
+        trim(mcacheSize, bytes);
+    }
+
+    model::ModelCacheStats stats()
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        auto                        stats = mStats;
+        stats.enabled = true;
+        return stats;
     }
 
 private:
+    struct Entry {
+        std::string                         mKey;
+        std::shared_ptr<model::Composition> mModel;
+        size_t                              mSize;
+    };
+
     ModelCache() = default;
 
-    std::unordered_map<std::string, std::shared_ptr<model::Composition>> mHash;
-    std::mutex                                                           mMutex;
+    void erase(std::list<Entry>::iterator it)
+    {
+        mStats.entries--;
+        mStats.bytes -= it->mSize;
+        mHash.erase(it->mKey);
+        mList.erase(it);
+    }
+
+    // drop the least recently used entries until both limits are met.
+    void trim(size_t count, size_t bytes)
+    {
+        while (!mList.empty() &&
+               (mStats.entries > count || mStats.bytes > bytes)) {
+            erase(std::prev(mList.end()));
+            mStats.evictions++;
+        }
+    }
+
+    std::list<Entry>                                             mList;
+    std::unordered_map<std::string, std::list<Entry>::iterator> mHash;
+    std::mutex                                                   mMutex;
+    model::ModelCacheStats                                       mStats;
     size_t mcacheSize{10};
+    size_t mBudget{std::numeric_limits<size_t>::max()};
+};
+
+struct FrameCacheKeyHash {
+    size_t operator()(const model::FrameCacheKey &k) const
+    {
+        size_t h = std::hash<std::string>()(k.mKey);
+        auto   combine = [&h](size_t v) {
+            h ^= v + 0x9e3779b9 + (h << 6) + (h >> 2);
+        };
+        combine(k.mOverrides);
+        combine(std::hash<float>()(k.mFrameNo));
+        combine(k.mWidth);
+        combine(k.mHeight);
+        combine(size_t(k.mDrawRegion.x()));
+        combine(size_t(k.mDrawRegion.y()));
+        combine(size_t(k.mDrawRegion.width()));
+        combine(size_t(k.mDrawRegion.height()));
+        combine(size_t(k.mKeepAspectRatio));
+        combine(k.mImageQuality);
+        return h;
+    }
+};
+
+struct FrameCacheKeyEqual {
+    bool operator()(const model::FrameCacheKey &a,
+                    const model::FrameCacheKey &b) const
+    {
+        return a.mFrameNo == b.mFrameNo && a.mOverrides == b.mOverrides &&
+               a.mWidth == b.mWidth && a.mHeight == b.mHeight &&
+               a.mDrawRegion == b.mDrawRegion &&
+               a.mKeepAspectRatio == b.mKeepAspectRatio &&
+               a.mImageQuality == b.mImageQuality && a.mKey == b.mKey;
+    }
+};
+
+/*
+ * Keeps the most recently rendered frames around so that many players
+ * showing the same animation at the same size don't render the same
+ * frame again. The cache is bounded by the pixel bytes it holds and
+ * evicts the least recently used frame first.
+ */
+class FrameCache {
+public:
+    static FrameCache &instance()
+    {
+        static FrameCache singleton;
+        return singleton;
+    }
+    std::shared_ptr<const model::FrameBuffer> find(
+        const model::FrameCacheKey &key)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+
+        if (!mBudget) return nullptr;
+
+        auto search = mHash.find(key);
+        if (search == mHash.end()) return nullptr;
+
+        // move it to the front of the lru list.
+        mList.splice(mList.begin(), mList, search->second);
+        return search->second->second;
+    }
+    void add(const model::FrameCacheKey &key, const uint32_t *buffer,
+             size_t width, size_t height, size_t bytesPerLine)
+    {
+        size_t cost = width * height * sizeof(uint32_t);
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+            if (cost > mBudget) return;
+        }
+
+        // copy the pixels outside the lock.
+        auto frame = std::make_shared<model::FrameBuffer>(width * height);
+        auto src = reinterpret_cast<const uint8_t *>(buffer);
+        for (size_t y = 0; y < height; y++) {
+            memcpy(frame->data() + y * width, src + y * bytesPerLine,
+                   width * sizeof(uint32_t));
+        }
+
+        std::lock_guard<std::mutex> guard(mMutex);
+
+        if (cost > mBudget) return;
+
+        auto search = mHash.find(key);
+        if (search != mHash.end()) {
+            mUsed -= search->second->second->size() * sizeof(uint32_t);
+            mList.erase(search->second);
+            mHash.erase(search);
+        }
+
+        mList.emplace_front(key, std::move(frame));
+        mHash[key] = mList.begin();
+        mUsed += cost;
+
+        trim();
+    }
+
+    void configureCacheSize(size_t bytes)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mBudget = bytes;
+
+        trim();
+    }
+
+private:
+    FrameCache() = default;
+
+    void trim()
+    {
+        while (mUsed > mBudget) {
+            auto &last = mList.back();
+            mUsed -= last.second->size() * sizeof(uint32_t);
+            mHash.erase(last.first);
+            mList.pop_back();
+        }
+    }
+
+    using Entry = std::pair<model::FrameCacheKey,
+                            std::shared_ptr<const model::FrameBuffer>>;
+
+    std::list<Entry> mList;
+    std::unordered_map<model::FrameCacheKey, std::list<Entry>::iterator,
+                       FrameCacheKeyHash, FrameCacheKeyEqual>
+                mHash;
+    std::mutex  mMutex;
+    size_t      mBudget{0};
+    size_t      mUsed{0};
+};
+
+/*
+ * Keeps the decoded image assets, keyed by the file path or by the encoded
+ * data of embedded images. The same image used by several compositions is
+ * decoded once. The cache is bounded by the pixel bytes it holds and evicts
+ * the least recently used image first, the compositions that still render
+ * an evicted image keep their own reference to it.
+ */
+class ImageCache {
+public:
+    static ImageCache &instance()
+    {
+        static ImageCache singleton;
+        return singleton;
+    }
+    VBitmap load(const std::string &source, bool embedded)
+    {
+        // the kind is part of the key so a path never matches image data.
+        std::string key = (embedded ? 'd' : 'f') + source;
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+
+            auto search = mHash.find(key);
+            if (search != mHash.end()) {
+                touch(search->second);
+                return search->second.mBitmap;
+            }
+        }
+
+        // decode outside the lock, racing threads may decode the same image.
+        VBitmap bitmap = decode(source, embedded);
+        if (!bitmap.valid()) return bitmap;
+
+        size_t cost = bitmap.stride() * bitmap.height() + key.size();
+
+        std::lock_guard<std::mutex> guard(mMutex);
+
+        if (cost > mBudget) return bitmap;
+
+        auto result = mHash.emplace(std::move(key), Entry{bitmap, cost, {}});
+        if (!result.second) return result.first->second.mBitmap;
+
+        mList.push_front(&result.first->first);
+        result.first->second.mPos = mList.begin();
+        mUsed += cost;
+
+        trim();
+        return bitmap;
+    }
+
+    void configureCacheSize(size_t bytes)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mBudget = bytes;
+
+        trim();
+    }
+
+private:
+    // the lru list points to the keys of the hash, so the encoded data of
+    // an embedded image is stored only once.
+    struct Entry {
+        VBitmap                                  mBitmap;
+        size_t                                   mSize;
+        std::list<const std::string *>::iterator mPos;
+    };
+
+    ImageCache() = default;
+
+    void touch(Entry &entry)
+    {
+        mList.splice(mList.begin(), mList, entry.mPos);
+    }
+
+    void trim()
+    {
+        while (mUsed > mBudget) {
+            auto search = mHash.find(*mList.back());
+            mUsed -= search->second.mSize;
+            mList.pop_back();
+            mHash.erase(search);
+        }
+    }
+
+    static VBitmap decode(const std::string &source, bool embedded)
+    {
+        if (embedded)
+            return VImageLoader::instance().load(source.c_str(),
+                                                 source.length());
+        return VImageLoader::instance().load(source.c_str());
+    }
+
+    std::list<const std::string *>         mList;
+    std::unordered_map<std::string, Entry> mHash;
+    std::mutex                             mMutex;
+    size_t                                 mBudget{64 * 1024 * 1024};
+    size_t                                 mUsed{0};
 };
 
 #else
@@ -94,6 +393,44 @@ public:
     }
     void add(const std::string &, std::shared_ptr<model::Composition>) {}
     void configureCacheSize(size_t) {}
+    void configureCacheMemory(size_t) {}
+    void trim(size_t) {}
+    model::ModelCacheStats stats() { return {}; }
+};
+
+class FrameCache {
+public:
+    static FrameCache &instance()
+    {
+        static FrameCache singleton;
+        return singleton;
+    }
+    std::shared_ptr<const model::FrameBuffer> find(const model::FrameCacheKey &)
+    {
+        return nullptr;
+    }
+    void add(const model::FrameCacheKey &, const uint32_t *, size_t, size_t,
+             size_t)
+    {
+    }
+    void configureCacheSize(size_t) {}
+};
+
+class ImageCache {
+public:
+    static ImageCache &instance()
+    {
+        static ImageCache singleton;
+        return singleton;
+    }
+    VBitmap load(const std::string &source, bool embedded)
+    {
+        if (embedded)
+            return VImageLoader::instance().load(source.c_str(),
+                                                 source.length());
+        return VImageLoader::instance().load(source.c_str());
+    }
+    void configureCacheSize(size_t) {}
 };
 
 #endif
@@ -108,11 +445,146 @@ static std::string dirname(const std::string &path)
     return std::string(path, 0, len);
 }
 
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Maps a file with a private copy-on-write mapping, so the in-situ parser
+ * can write into it without copying the file into a string first. The
+ * mapping is followed by at least one zero byte, so the content is always
+ * null terminated.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            size_t size = size_t(st.st_size);
+            size_t page = size_t(sysconf(_SC_PAGESIZE));
+            // reserve zeroed pages with room for the terminator, then
+            // place the file on top of them.
+            size_t length = (size / page + 1) * page;
+            void * area = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (area != MAP_FAILED) {
+                if (mmap(area, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED) {
+                    mData = static_cast<char *>(area);
+                    mSize = size;
+                    mLength = length;
+                } else {
+                    munmap(area, length);
+                }
+            }
+        }
+        close(fd);
+    }
+    ~MappedFile()
+    {
+        if (mData) munmap(mData, mLength);
+    }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    char * data() const { return mData; }
+    size_t size() const { return mSize; }
+
+private:
+    char * mData{nullptr};
+    size_t mSize{0};
+    size_t mLength{0};
+};
+
+#else
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &) {}
+    char * data() const { return nullptr; }
+    size_t size() const { return 0; }
+};
+
+#endif
+
+static std::shared_ptr<model::Composition> parseFile(const std::string &path)
+{
+    MappedFile file(path);
+    if (file.data()) return model::parse(file.data(), dirname(path));
+
+    // not a regular file or it can't be mapped, read it instead.
+    std::ifstream f;
+    f.open(path);
+
+    if (!f.is_open()) {
+        vCritical << "failed to open file = " << path.c_str();
+        return {};
+    }
+
+    std::string content;
+
+    std::getline(f, content, '\0');
+    f.close();
+
+    if (content.empty()) return {};
+
+    return model::parse(const_cast<char *>(content.c_str()), dirname(path));
+}
+
 void model::configureModelCacheSize(size_t cacheSize)
 {
     ModelCache::instance().configureCacheSize(cacheSize);
 }
 
+void model::configureModelCacheMemory(size_t bytes)
+{
+    ModelCache::instance().configureCacheMemory(bytes);
+}
+
+void model::trimModelCache(size_t bytes)
+{
+    ModelCache::instance().trim(bytes);
+}
+
+model::ModelCacheStats model::modelCacheStats()
+{
+    return ModelCache::instance().stats();
+}
+
+void model::configureFrameCacheSize(size_t bytes)
+{
+    FrameCache::instance().configureCacheSize(bytes);
+}
+
+void model::configureImageCacheSize(size_t bytes)
+{
+    ImageCache::instance().configureCacheSize(bytes);
+}
+
+VBitmap model::loadImage(const std::string &source, bool embedded)
+{
+    return ImageCache::instance().load(source, embedded);
+}
+
+std::shared_ptr<const model::FrameBuffer> model::findFrame(
+    const model::FrameCacheKey &key)
+{
+    return FrameCache::instance().find(key);
+}
+
+void model::addFrame(const model::FrameCacheKey &key, const uint32_t *buffer,
+                     size_t width, size_t height, size_t bytesPerLine)
+{
+    FrameCache::instance().add(key, buffer, width, height, bytesPerLine);
+}
+
 std::shared_ptr<model::Composition> model::loadFromFile(const std::string &path,
                                                         bool cachePolicy)
 {
@@ -121,27 +593,61 @@ std::shared_ptr<model::Composition> model::loadFromFile(const std::string &path,
         if (obj) return obj;
     }
 
-    std::ifstream f;
-    f.open(path);
+    auto obj = parseFile(path);
 
-    if (!f.is_open()) {
-        vCritical << "failed to open file = " << path.c_str();
-        return {};
-    } else {
-        std::string content;
+    if (obj && cachePolicy) {
+        obj->mKey = path;
+        ModelCache::instance().add(path, obj);
+    }
 
-        std::getline(f, content, '\0');
-        f.close();
+    return obj;
+}
 
-        if (content.empty()) return {};
+std::shared_ptr<model::Composition> model::loadCompiled(const std::string &path,
+                                                        bool cachePolicy)
+{
+    if (cachePolicy) {
+        auto obj = ModelCache::instance().find(path);
+        if (obj) return obj;
+    }
 
-        auto obj = internal::model::parse(const_cast<char *>(content.c_str()),
-                                          dirname(path));
+    std::shared_ptr<model::Composition> obj;
 
-        if (obj && cachePolicy) ModelCache::instance().add(path, obj);
+    MappedFile file(path);
+    if (file.data()) {
+        obj = model::deserialize(file.data(), file.size());
+    } else {
+        std::ifstream f(path, std::ios::binary);
+        if (!f.is_open()) {
+            vCritical << "failed to open file = " << path.c_str();
+            return {};
+        }
+        std::string content((std::istreambuf_iterator<char>(f)),
+                            std::istreambuf_iterator<char>());
+        obj = model::deserialize(content.data(), content.size());
+    }
 
-        return obj;
+    if (obj && cachePolicy) {
+        obj->mKey = path;
+        ModelCache::instance().add(path, obj);
     }
+
+    return obj;
+}
+
+bool model::saveCompiled(const model::Composition &comp,
+                         const std::string &       path)
+{
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (!f.is_open()) {
+        vCritical << "failed to open file = " << path.c_str();
+        return false;
+    }
+
+    auto data = model::serialize(comp);
+    f.write(data.data(), std::streamsize(data.size()));
+
+    return bool(f);
 }
 
 std::shared_ptr<model::Composition> model::loadFromData(
@@ -156,7 +662,10 @@ std::shared_ptr<model::Composition> model::loadFromData(
     auto obj = internal::model::parse(const_cast<char *>(jsonData.c_str()),
                                       std::move(resourcePath));
 
-    if (obj && cachePolicy) ModelCache::instance().add(key, obj);
+    if (obj && cachePolicy) {
+        obj->mKey = key;
+        ModelCache::instance().add(key, obj);
+    }
 
     return obj;
 }
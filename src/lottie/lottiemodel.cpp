@@ -24,7 +24,6 @@
 #include <cassert>
 #include <iterator>
 #include <stack>
-#include "vimageloader.h"
 #include "vline.h"
 
 using namespace rlottie::internal;
@@ -158,7 +157,19 @@ void model::Composition::updateStats()
     visitor.visit(mRootLayer);
 }
 
-VMatrix model::Repeater::Transform::matrix(int frameNo, float multiplier) const
+size_t model::Composition::memorySize() const
+{
+    size_t size = sizeof(Composition) + mArenaAlloc.heapSize();
+    for (const auto &asset : mAssets) {
+        // decoded images are accounted in the image cache.
+        const auto &bitmap = asset.second->mBitmap;
+        if (bitmap.valid()) size += bitmap.stride() * bitmap.height();
+        size += asset.second->mImageData.capacity();
+    }
+    return size;
+}
+
+VMatrix model::Repeater::Transform::matrix(float frameNo, float multiplier) const
 {
     VPointF scale = mScale.value(frameNo) / 100.f;
     scale.setX(std::pow(scale.x(), multiplier));
@@ -173,7 +184,7 @@ VMatrix model::Repeater::Transform::matrix(int frameNo, float multiplier) const
     return m;
 }
 
-VMatrix model::Transform::Data::matrix(int frameNo, bool autoOrient) const
+VMatrix model::Transform::Data::matrix(float frameNo, bool autoOrient) const
 {
     VMatrix m;
     VPointF position;
@@ -201,7 +212,7 @@ VMatrix model::Transform::Data::matrix(int frameNo, bool autoOrient) const
     return m;
 }
 
-void model::Dash::getDashInfo(int frameNo, std::vector<float> &result) const
+void model::Dash::getDashInfo(float frameNo, std::vector<float> &result) const
 {
     result.clear();
 
@@ -244,7 +255,7 @@ void model::Dash::getDashInfo(int frameNo, std::vector<float> &result) const
  *     ...
  * ]
  */
-void model::Gradient::populate(VGradientStops &stops, int frameNo)
+void model::Gradient::populate(VGradientStops &stops, float frameNo)
 {
     model::Gradient::Data gradData = mGradient.value(frameNo);
     auto                  size = gradData.mGradient.size();
@@ -253,6 +264,9 @@ void model::Gradient::populate(VGradientStops &stops, int frameNo)
     if (colorPoints == -1) {  // for legacy bodymovin (ref: lottie-android)
         colorPoints = int(size / 4);
     }
+    // don't trust a color point count the data doesn't have.
+    if (colorPoints < 0 || size_t(colorPoints) * 4 > size)
+        colorPoints = int(size / 4);
     auto   opacityArraySize = size - colorPoints * 4;
     float *opacityPtr = ptr + (colorPoints * 4);
     stops.clear();
@@ -271,7 +285,7 @@ void model::Gradient::populate(VGradientStops &stops, int frameNo)
 
 float model::Gradient::getOpacityAtPosition(float *opacities, size_t opacityArraySize, float position)
 {
-    for (size_t i = 2; i < opacityArraySize; i += 2)
+    for (size_t i = 2; i + 1 < opacityArraySize; i += 2)
     {
         float lastPosition = opacities[i - 2];
         float thisPosition = opacities[i];
@@ -284,7 +298,7 @@ float model::Gradient::getOpacityAtPosition(float *opacities, size_t opacityArra
     return 0.0f;
 }
 
-void model::Gradient::update(std::unique_ptr<VGradient> &grad, int frameNo)
+void model::Gradient::update(std::unique_ptr<VGradient> &grad, float frameNo)
 {
     bool init = false;
     if (!grad) {
@@ -337,15 +351,22 @@ void model::Gradient::update(std::unique_ptr<VGradient> &grad, int frameNo)
     }
 }
 
+VBitmap model::Asset::bitmap() const
+{
+    if (mBitmap.valid()) return mBitmap;
+    if (!mImageData.empty()) return loadImage(mImageData, true);
+    if (!mImagePath.empty()) return loadImage(mImagePath, false);
+    return {};
+}
+
 void model::Asset::loadImageData(std::string data)
 {
-    if (!data.empty())
-        mBitmap = VImageLoader::instance().load(data.c_str(), data.length());
+    mImageData = std::move(data);
 }
 
 void model::Asset::loadImagePath(std::string path)
 {
-    if (!path.empty()) mBitmap = VImageLoader::instance().load(path.c_str());
+    mImagePath = std::move(path);
 }
 
 std::vector<LayerInfo> model::Composition::layerInfoList() const
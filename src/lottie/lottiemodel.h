@@ -219,14 +219,14 @@ template <typename T, typename Tag>
 class KeyFrames {
 public:
     struct Frame {
-        float progress(int frameNo) const
+        float progress(float frameNo) const
         {
             return interpolator_ ? interpolator_->value((frameNo - start_) /
                                                         (end_ - start_))
                                  : 0;
         }
-        T     value(int frameNo) const { return value_.at(progress(frameNo)); }
-        float angle(int frameNo) const
+        T     value(float frameNo) const { return value_.at(progress(frameNo)); }
+        float angle(float frameNo) const
         {
             return value_.angle(progress(frameNo));
         }
@@ -237,7 +237,7 @@ public:
         Value<T, Tag>  value_;
     };
 
-    T value(int frameNo) const
+    T value(float frameNo) const
     {
         if (frames_.front().start_ >= frameNo)
             return frames_.front().value_.start_;
@@ -250,7 +250,7 @@ public:
         return {};
     }
 
-    float angle(int frameNo) const
+    float angle(float frameNo) const
     {
         if ((frames_.front().start_ >= frameNo) ||
             (frames_.back().end_ <= frameNo))
@@ -263,7 +263,7 @@ public:
         return 0;
     }
 
-    bool changed(int prevFrame, int curFrame) const
+    bool changed(float prevFrame, float curFrame) const
     {
         auto first = frames_.front().start_;
         auto last = frames_.back().end_;
@@ -326,14 +326,14 @@ public:
 
     bool isStatic() const { return isValue_; }
 
-    T value(int frameNo) const
+    T value(float frameNo) const
     {
         return isStatic() ? value() : animation().value(frameNo);
     }
 
     // special function only for type T=PathData
     template <typename forT = PathData>
-    auto value(int frameNo, VPath &path) const ->
+    auto value(float frameNo, VPath &path) const ->
         typename std::enable_if_t<std::is_same<T, forT>::value, void>
     {
         if (isStatic()) {
@@ -354,12 +354,12 @@ public:
         }
     }
 
-    float angle(int frameNo) const
+    float angle(float frameNo) const
     {
         return isStatic() ? 0 : animation().angle(frameNo);
     }
 
-    bool changed(int prevFrame, int curFrame) const
+    bool changed(float prevFrame, float curFrame) const
     {
         return isStatic() ? false : animation().changed(prevFrame, curFrame);
     }
@@ -409,13 +409,13 @@ struct Dash {
             if (!elm.isStatic()) return false;
         return true;
     }
-    void getDashInfo(int frameNo, std::vector<float> &result) const;
+    void getDashInfo(float frameNo, std::vector<float> &result) const;
 };
 
 class Mask {
 public:
     enum class Mode { None, Add, Substarct, Intersect, Difference };
-    float opacity(int frameNo) const
+    float opacity(float frameNo) const
     {
         return mOpacity.value(frameNo) / 100.0f;
     }
@@ -505,7 +505,8 @@ struct Asset {
     enum class Type : unsigned char { Precomp, Image, Char };
     bool                  isStatic() const { return mStatic; }
     void                  setStatic(bool value) { mStatic = value; }
-    VBitmap               bitmap() const { return mBitmap; }
+    // decodes the image on first use, see loadImage().
+    VBitmap               bitmap() const;
     void                  loadImageData(std::string data);
     void                  loadImagePath(std::string Path);
     Type                  mAssetType{Type::Precomp};
@@ -513,9 +514,11 @@ struct Asset {
     std::string           mRefId;  // ref id
     std::vector<Object *> mLayers;
     // image asset data
-    int     mWidth{0};
-    int     mHeight{0};
-    VBitmap mBitmap;
+    int         mWidth{0};
+    int         mHeight{0};
+    std::string mImageData;  // encoded embedded image
+    std::string mImagePath;
+    VBitmap     mBitmap;  // already decoded image of a compiled model
 };
 
 class Layer;
@@ -539,6 +542,14 @@ public:
     {
         return long(frameAtPos(timeInSec / duration()));
     }
+    // frame position at the given time without rounding to a whole frame.
+    double framePosAtTime(double timeInSec) const
+    {
+        double pos = timeInSec / duration();
+        if (pos < 0) pos = 0;
+        if (pos > 1) pos = 1;
+        return pos * frameDuration();
+    }
     size_t totalFrame() const { return mEndFrame - mStartFrame; }
     long   frameDuration() const { return mEndFrame - mStartFrame - 1; }
     float  frameRate() const { return mFrameRate; }
@@ -547,6 +558,8 @@ public:
     VSize  size() const { return mSize; }
     void   processRepeaterObjects();
     void   updateStats();
+    // approximate heap bytes held by the model (arena and image assets).
+    size_t memorySize() const;
 
 public:
     struct Stats {
@@ -559,6 +572,7 @@ public:
 
 public:
     std::string                              mVersion;
+    std::string                              mKey;  // cache key, if any
     VSize                                    mSize;
     long                                     mStartFrame{0};
     long                                     mEndFrame{0};
@@ -584,8 +598,8 @@ public:
             bool            mSeparate{false};
             bool            m3DData{false};
         };
-        VMatrix matrix(int frameNo, bool autoOrient = false) const;
-        float   opacity(int frameNo) const
+        VMatrix matrix(float frameNo, bool autoOrient = false) const;
+        float   opacity(float frameNo) const
         {
             return mOpacity.value(frameNo) / 100.0f;
         }
@@ -612,12 +626,18 @@ public:
             impl.mData = data;
         }
     }
-    VMatrix matrix(int frameNo, bool autoOrient = false) const
+    void set(const VMatrix &matrix, float opacity)
+    {
+        setStatic(true);
+        new (&impl.mStaticData) StaticData(VMatrix(matrix), opacity);
+    }
+    const Data *data() const { return isStatic() ? nullptr : impl.mData; }
+    VMatrix matrix(float frameNo, bool autoOrient = false) const
     {
         if (isStatic()) return impl.mStaticData.mMatrix;
         return impl.mData->matrix(frameNo, autoOrient);
     }
-    float opacity(int frameNo) const
+    float opacity(float frameNo) const
     {
         if (isStatic()) return impl.mStaticData.mOpacity;
         return impl.mData->opacity(frameNo);
@@ -692,15 +712,15 @@ public:
         return mExtra ? mExtra->mSolidColor : Color();
     }
     bool    autoOrient() const noexcept { return mAutoOrient; }
-    int     timeRemap(int frameNo) const;
+    float   timeRemap(float frameNo) const;
     VSize   layerSize() const { return mLayerSize; }
     bool    precompLayer() const { return mLayerType == Type::Precomp; }
-    VMatrix matrix(int frameNo) const
+    VMatrix matrix(float frameNo) const
     {
         return mTransform ? mTransform->matrix(frameNo, autoOrient())
                           : VMatrix{};
     }
-    float opacity(int frameNo) const
+    float opacity(float frameNo) const
     {
         return mTransform ? mTransform->opacity(frameNo) : 1.0f;
     }
@@ -748,41 +768,53 @@ public:
  * will be convert to frame number 30 if the frame rate is 60. or will result to
  * frame number 15 if the frame rate is 30.
  */
-inline int Layer::timeRemap(int frameNo) const
+inline float Layer::timeRemap(float frameNo) const
 {
+    auto wholeFrame = [this](float frameNo) {
+        /*
+         * only consider startFrame() when there is no timeRemap.
+         * when a layer has timeremap bodymovin updates the startFrame()
+         * of all child layer so we don't have to take care of it.
+         */
+        if (!mExtra || mExtra->mTimeRemap.isStatic())
+            frameNo = frameNo - startFrame();
+        else
+            frameNo = float(mExtra->mCompRef->frameAtTime(
+                mExtra->mTimeRemap.value(frameNo)));
+        /* Apply time streatch if it has any.
+         * Time streatch is just a factor by which the animation will speedup
+         * or slow down with respect to the overal animation. Time streach
+         * factor is already applied to the layers inFrame and outFrame.
+         * @TODO need to find out if timestreatch also affects the in and out
+         * frame of the child layers or not. */
+        return float(int(frameNo / mTimeStreatch));
+    };
+
     /*
-     * only consider startFrame() when there is no timeRemap.
-     * when a layer has timeremap bodymovin updates the startFrame()
-     * of all child layer so we don't have to take care of it.
+     * a position in between two frames (renderAtTime()) is interpolated
+     * between the mapped frames on either side, so the mapping never moves
+     * backwards at a whole frame.
      */
-    if (!mExtra || mExtra->mTimeRemap.isStatic())
-        frameNo = frameNo - startFrame();
-    else
-        frameNo =
-            mExtra->mCompRef->frameAtTime(mExtra->mTimeRemap.value(frameNo));
-    /* Apply time streatch if it has any.
-     * Time streatch is just a factor by which the animation will speedup or
-     * slow down with respect to the overal animation. Time streach factor is
-     * already applied to the layers inFrame and outFrame.
-     * @TODO need to find out if timestreatch also affects the in and out frame
-     * of the child layers or not. */
-    return int(frameNo / mTimeStreatch);
+    float whole = std::floor(frameNo);
+    float from = wholeFrame(whole);
+    if (frameNo == whole) return from;
+    return from + (wholeFrame(whole + 1) - from) * (frameNo - whole);
 }
 
 class Stroke : public Object {
 public:
     Stroke() : Object(Object::Type::Stroke) {}
-    Color color(int frameNo) const { return mColor.value(frameNo); }
-    float opacity(int frameNo) const
+    Color color(float frameNo) const { return mColor.value(frameNo); }
+    float opacity(float frameNo) const
     {
         return mOpacity.value(frameNo) / 100.0f;
     }
-    float     strokeWidth(int frameNo) const { return mWidth.value(frameNo); }
+    float     strokeWidth(float frameNo) const { return mWidth.value(frameNo); }
     CapStyle  capStyle() const { return mCapStyle; }
     JoinStyle joinStyle() const { return mJoinStyle; }
     float     miterLimit() const { return mMiterLimit; }
     bool      hasDashInfo() const { return !mDash.empty(); }
-    void      getDashInfo(int frameNo, std::vector<float> &result) const
+    void      getDashInfo(float frameNo, std::vector<float> &result) const
     {
         return mDash.getDashInfo(frameNo, result);
     }
@@ -813,14 +845,14 @@ public:
         std::vector<float> mGradient;
     };
     explicit Gradient(Object::Type type) : Object(type) {}
-    inline float opacity(int frameNo) const
+    inline float opacity(float frameNo) const
     {
         return mOpacity.value(frameNo) / 100.0f;
     }
-    void update(std::unique_ptr<VGradient> &grad, int frameNo);
+    void update(std::unique_ptr<VGradient> &grad, float frameNo);
 
 private:
-    void populate(VGradientStops &stops, int frameNo);
+    void populate(VGradientStops &stops, float frameNo);
     float getOpacityAtPosition(float *opacities, size_t opacityArraySize, float position);
 
 public:
@@ -838,12 +870,12 @@ public:
 class GradientStroke : public Gradient {
 public:
     GradientStroke() : Gradient(Object::Type::GStroke) {}
-    float     width(int frameNo) const { return mWidth.value(frameNo); }
+    float     width(float frameNo) const { return mWidth.value(frameNo); }
     CapStyle  capStyle() const { return mCapStyle; }
     JoinStyle joinStyle() const { return mJoinStyle; }
     float     miterLimit() const { return mMiterLimit; }
     bool      hasDashInfo() const { return !mDash.empty(); }
-    void      getDashInfo(int frameNo, std::vector<float> &result) const
+    void      getDashInfo(float frameNo, std::vector<float> &result) const
     {
         return mDash.getDashInfo(frameNo, result);
     }
@@ -868,8 +900,8 @@ public:
 class Fill : public Object {
 public:
     Fill() : Object(Object::Type::Fill) {}
-    Color color(int frameNo) const { return mColor.value(frameNo); }
-    float opacity(int frameNo) const
+    Color color(float frameNo) const { return mColor.value(frameNo); }
+    float opacity(float frameNo) const
     {
         return mOpacity.value(frameNo) / 100.0f;
     }
@@ -905,7 +937,7 @@ public:
 class RoundedCorner : public Object {
 public:
     RoundedCorner() : Object(Object::Type::RoundedCorner) {}
-    float radius(int frameNo) const { return mRadius.value(frameNo);}
+    float radius(float frameNo) const { return mRadius.value(frameNo);}
 public:
     Property<float>   mRadius{0};
 };
@@ -913,13 +945,13 @@ public:
 class Rect : public Shape {
 public:
     Rect() : Shape(Object::Type::Rect) {}
-    float roundness(int frameNo)
+    float roundness(float frameNo)
     {
         return mRoundedCorner ? mRoundedCorner->radius(frameNo) :
                                 mRound.value(frameNo);
     }
 
-    bool roundnessChanged(int prevFrame, int curFrame)
+    bool roundnessChanged(float prevFrame, float curFrame)
     {
         return mRoundedCorner ? mRoundedCorner->mRadius.changed(prevFrame, curFrame) :
                         mRound.changed(prevFrame, curFrame);
@@ -959,12 +991,12 @@ public:
 class Repeater : public Object {
 public:
     struct Transform {
-        VMatrix matrix(int frameNo, float multiplier) const;
-        float   startOpacity(int frameNo) const
+        VMatrix matrix(float frameNo, float multiplier) const;
+        float   startOpacity(float frameNo) const
         {
             return mStartOpacity.value(frameNo) / 100;
         }
-        float endOpacity(int frameNo) const
+        float endOpacity(float frameNo) const
         {
             return mEndOpacity.value(frameNo) / 100;
         }
@@ -985,8 +1017,8 @@ public:
     Group *content() const { return mContent ? mContent : nullptr; }
     void   setContent(Group *content) { mContent = content; }
     int    maxCopies() const { return int(mMaxCopies); }
-    float  copies(int frameNo) const { return mCopies.value(frameNo); }
-    float  offset(int frameNo) const { return mOffset.value(frameNo); }
+    float  copies(float frameNo) const { return mCopies.value(frameNo); }
+    float  offset(float frameNo) const { return mOffset.value(frameNo); }
     bool   processed() const { return mProcessed; }
     void   markProcessed() { mProcessed = true; }
 
@@ -1014,7 +1046,7 @@ public:
      * if start < end vector trims the path without loop ( 1 segment).
      * if no offset then there is no loop.
      */
-    Segment segment(int frameNo) const
+    Segment segment(float frameNo) const
     {
         float start = mStart.value(frameNo) / 100.0f;
         float end = mEnd.value(frameNo) / 100.0f;
@@ -1125,6 +1157,57 @@ using ColorFilter = std::function<void(float &, float &, float &)>;
 
 void configureModelCacheSize(size_t cacheSize);
 
+void configureModelCacheMemory(size_t bytes);
+
+void trimModelCache(size_t bytes);
+
+// counters of the model cache, rlottie::ModelCacheStats mirrors them.
+struct ModelCacheStats {
+    bool   enabled{false};
+    size_t entries{0};
+    size_t bytes{0};
+    size_t hits{0};
+    size_t misses{0};
+    size_t evictions{0};
+};
+
+ModelCacheStats modelCacheStats();
+
+struct FrameCacheKey {
+    std::string mKey;           // composition key
+    size_t      mOverrides{0};  // property override set, 0 if none
+    float       mFrameNo{0};
+    size_t      mWidth{0};
+    size_t      mHeight{0};
+    VRect       mDrawRegion;
+    bool        mKeepAspectRatio{true};
+    size_t      mImageQuality{0};  // rlottie::ImageQuality
+};
+
+using FrameBuffer = std::vector<uint32_t>;
+
+std::shared_ptr<model::Composition> loadCompiled(const std::string &path,
+                                                 bool               cachePolicy);
+
+bool saveCompiled(const model::Composition &comp, const std::string &path);
+
+std::string serialize(const model::Composition &comp);
+
+std::shared_ptr<model::Composition> deserialize(const char *data, size_t size);
+
+void configureFrameCacheSize(size_t bytes);
+
+void configureImageCacheSize(size_t bytes);
+
+// decoded image of a file path or of encoded image data, shared by all the
+// compositions that use the same image.
+VBitmap loadImage(const std::string &source, bool embedded);
+
+std::shared_ptr<const FrameBuffer> findFrame(const FrameCacheKey &key);
+
+void addFrame(const FrameCacheKey &key, const uint32_t *buffer, size_t width,
+              size_t height, size_t bytesPerLine);
+
 std::shared_ptr<model::Composition> loadFromFile(const std::string &filePath,
                                                  bool cachePolicy);
 
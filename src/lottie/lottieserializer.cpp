@@ -0,0 +1,990 @@
+/*
+ * Copyright (c) 2020 Samsung Electronics Co., Ltd. All rights reserved.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+
+#include "lottiemodel.h"
+#include "vdebug.h"
+
+using namespace rlottie::internal;
+
+/*
+ * Binary form of a fully built model::Composition.
+ *
+ * The tree is written depth first. Objects and interpolators can be shared
+ * (precomp assets, interpolator cache) so every one of them gets an id the
+ * first time it is written, later references only store the id. Keyframe
+ * values are stored after Property::cache() and interpolators with their
+ * sample table, so loading doesn't need to recompute anything.
+ *
+ * The format stores host endian values and is meant to be produced by the
+ * same library version that reads it. The header carries a version and a
+ * layout signature, the reader rejects anything that doesn't match.
+ */
+
+static const char     CompiledMagic[8] = {'r', 'l', 'o', 't', 'b', 'i', 'n', 0};
+static const uint32_t CompiledVersion = 1;
+static const uint32_t CompiledEndian = 0x01020304;
+
+static uint32_t layoutSignature()
+{
+    return uint32_t(sizeof(VInterpolator) << 16 | sizeof(VPointF) << 8 |
+                    sizeof(model::Color));
+}
+
+static_assert(std::is_trivially_copyable<VInterpolator>::value,
+              "interpolator is stored as raw bytes");
+
+class ModelWriter {
+public:
+    std::string write(const model::Composition &comp)
+    {
+        mData.append(CompiledMagic, sizeof(CompiledMagic));
+        pod(CompiledVersion);
+        pod(CompiledEndian);
+        pod(layoutSignature());
+
+        string(comp.mVersion);
+        pod(comp.mSize);
+        pod(comp.mStartFrame);
+        pod(comp.mEndFrame);
+        pod(comp.mFrameRate);
+        pod(comp.mBlendMode);
+        pod(comp.isStatic());
+
+        count(comp.mAssets.size());
+        for (const auto &e : comp.mAssets) {
+            string(e.first);
+            asset(*e.second);
+        }
+
+        count(comp.mMarkers.size());
+        for (const auto &e : comp.mMarkers) {
+            string(std::get<0>(e));
+            pod(std::get<1>(e));
+            pod(std::get<2>(e));
+        }
+
+        object(comp.mRootLayer);
+
+        return std::move(mData);
+    }
+
+private:
+    template <typename T>
+    void pod(const T &v)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "not a pod");
+        mData.append(reinterpret_cast<const char *>(&v), sizeof(T));
+    }
+    void count(size_t n) { pod(uint32_t(n)); }
+    void string(const std::string &s)
+    {
+        count(s.size());
+        mData.append(s);
+    }
+
+    void value(float v) { pod(v); }
+    void value(const VPointF &v) { pod(v); }
+    void value(const model::Color &v) { pod(v); }
+    void value(const model::PathData &v)
+    {
+        count(v.mPoints.size());
+        for (const auto &pt : v.mPoints) pod(pt);
+        pod(v.mClosed);
+    }
+    void value(const model::Gradient::Data &v)
+    {
+        count(v.mGradient.size());
+        for (const auto &e : v.mGradient) pod(e);
+    }
+
+    template <typename T, typename Tag>
+    void keyValue(const model::Value<T, Tag> &v)
+    {
+        value(v.start_);
+        value(v.end_);
+    }
+    template <typename T>
+    void keyValue(const model::Value<T, model::Position> &v)
+    {
+        value(v.start_);
+        value(v.end_);
+        value(v.inTangent_);
+        value(v.outTangent_);
+        pod(v.length_);
+        pod(v.hasTangent_);
+    }
+
+    template <typename T, typename Tag>
+    void property(const model::Property<T, Tag> &p)
+    {
+        pod(p.isStatic());
+        if (p.isStatic()) {
+            value(p.value());
+            return;
+        }
+        const auto &frames = p.animation().frames_;
+        count(frames.size());
+        for (const auto &f : frames) {
+            pod(f.start_);
+            pod(f.end_);
+            interpolator(f.interpolator_);
+            keyValue(f.value_);
+        }
+    }
+
+    void interpolator(const VInterpolator *obj)
+    {
+        if (!obj) return count(0);
+
+        auto search = mInterpolators.find(obj);
+        if (search != mInterpolators.end()) return count(search->second);
+
+        auto id = uint32_t(mInterpolators.size() + 1);
+        mInterpolators[obj] = id;
+        count(id);
+        pod(*obj);
+    }
+
+    void dash(const model::Dash &d)
+    {
+        count(d.mData.size());
+        for (const auto &e : d.mData) property(e);
+    }
+
+    void asset(const model::Asset &a)
+    {
+        pod(a.mAssetType);
+        pod(a.isStatic());
+        string(a.mRefId);
+        count(a.mLayers.size());
+        for (const auto &e : a.mLayers) object(e);
+        pod(a.mWidth);
+        pod(a.mHeight);
+
+        // compiled models carry the decoded pixels.
+        const auto bitmap = a.bitmap();
+        pod(bitmap.valid());
+        if (!bitmap.valid()) return;
+        pod(bitmap.format());
+        count(bitmap.width());
+        count(bitmap.height());
+        size_t rowBytes = bitmap.width() * bitmap.depth() / 8;
+        for (size_t y = 0; y < bitmap.height(); y++) {
+            mData.append(reinterpret_cast<const char *>(bitmap.data() +
+                                                        y * bitmap.stride()),
+                         rowBytes);
+        }
+    }
+
+    void mask(const model::Mask &m)
+    {
+        property(m.mShape);
+        property(m.mOpacity);
+        pod(m.mInv);
+        pod(m.mIsStatic);
+        pod(m.mMode);
+    }
+
+    void transform(const model::Transform &t)
+    {
+        if (t.isStatic()) {
+            auto m = t.matrix(0);
+            pod(m.m_11());
+            pod(m.m_12());
+            pod(m.m_13());
+            pod(m.m_21());
+            pod(m.m_22());
+            pod(m.m_23());
+            pod(m.m_tx());
+            pod(m.m_ty());
+            pod(m.m_33());
+            pod(t.opacity(0));
+            return;
+        }
+        auto data = t.data();
+        property(data->mRotation);
+        property(data->mScale);
+        property(data->mPosition);
+        property(data->mAnchor);
+        property(data->mOpacity);
+        pod(bool(data->mExtra));
+        if (!data->mExtra) return;
+        auto extra = data->mExtra.get();
+        property(extra->m3DRx);
+        property(extra->m3DRy);
+        property(extra->m3DRz);
+        property(extra->mSeparateX);
+        property(extra->mSeparateY);
+        pod(extra->mSeparate);
+        pod(extra->m3DData);
+    }
+
+    void group(const model::Group &g)
+    {
+        count(g.mChildren.size());
+        for (const auto &e : g.mChildren) object(e);
+        object(g.mTransform);
+    }
+
+    void layer(const model::Layer &l)
+    {
+        group(l);
+        pod(l.mMatteType);
+        pod(l.mLayerType);
+        pod(l.mBlendMode);
+        pod(l.mHasRoundedCorner);
+        pod(l.mHasPathOperator);
+        pod(l.mHasMask);
+        pod(l.mHasRepeater);
+        pod(l.mHasGradient);
+        pod(l.mAutoOrient);
+        pod(l.mLayerSize);
+        pod(l.mParentId);
+        pod(l.mId);
+        pod(l.mTimeStreatch);
+        pod(l.mInFrame);
+        pod(l.mOutFrame);
+        pod(l.mStartFrame);
+
+        pod(bool(l.mExtra));
+        if (!l.mExtra) return;
+        auto extra = l.mExtra.get();
+        pod(extra->mSolidColor);
+        string(extra->mPreCompRefId);
+        property(extra->mTimeRemap);
+        string(extra->mAsset ? extra->mAsset->mRefId : std::string());
+        count(extra->mMasks.size());
+        for (const auto &e : extra->mMasks) mask(*e);
+    }
+
+    void gradient(const model::Gradient &g)
+    {
+        pod(g.mGradientType);
+        property(g.mStartPoint);
+        property(g.mEndPoint);
+        property(g.mHighlightLength);
+        property(g.mHighlightAngle);
+        property(g.mOpacity);
+        property(g.mGradient);
+        pod(g.mColorPoints);
+        pod(g.mEnabled);
+    }
+
+    void object(const model::Object *obj)
+    {
+        if (!obj) return count(0);
+
+        auto search = mObjects.find(obj);
+        if (search != mObjects.end()) return count(search->second);
+
+        auto id = uint32_t(mObjects.size() + 1);
+        mObjects[obj] = id;
+        count(id);
+
+        pod(obj->type());
+        string(obj->name() ? obj->name() : "");
+        pod(obj->isStatic());
+        pod(obj->hidden());
+
+        switch (obj->type()) {
+        case model::Object::Type::Composition:
+            break;
+        case model::Object::Type::Layer:
+            layer(*static_cast<const model::Layer *>(obj));
+            break;
+        case model::Object::Type::Group:
+            group(*static_cast<const model::Group *>(obj));
+            break;
+        case model::Object::Type::Transform:
+            transform(*static_cast<const model::Transform *>(obj));
+            break;
+        case model::Object::Type::Fill: {
+            auto o = static_cast<const model::Fill *>(obj);
+            pod(o->mFillRule);
+            pod(o->mEnabled);
+            property(o->mColor);
+            property(o->mOpacity);
+            break;
+        }
+        case model::Object::Type::Stroke: {
+            auto o = static_cast<const model::Stroke *>(obj);
+            property(o->mColor);
+            property(o->mOpacity);
+            property(o->mWidth);
+            pod(o->mCapStyle);
+            pod(o->mJoinStyle);
+            pod(o->mMiterLimit);
+            dash(o->mDash);
+            pod(o->mEnabled);
+            break;
+        }
+        case model::Object::Type::GFill: {
+            auto o = static_cast<const model::GradientFill *>(obj);
+            gradient(*o);
+            pod(o->mFillRule);
+            break;
+        }
+        case model::Object::Type::GStroke: {
+            auto o = static_cast<const model::GradientStroke *>(obj);
+            gradient(*o);
+            property(o->mWidth);
+            pod(o->mCapStyle);
+            pod(o->mJoinStyle);
+            pod(o->mMiterLimit);
+            dash(o->mDash);
+            break;
+        }
+        case model::Object::Type::Rect: {
+            auto o = static_cast<const model::Rect *>(obj);
+            pod(o->mDirection);
+            object(o->mRoundedCorner);
+            property(o->mPos);
+            property(o->mSize);
+            property(o->mRound);
+            break;
+        }
+        case model::Object::Type::Ellipse: {
+            auto o = static_cast<const model::Ellipse *>(obj);
+            pod(o->mDirection);
+            property(o->mPos);
+            property(o->mSize);
+            break;
+        }
+        case model::Object::Type::Path: {
+            auto o = static_cast<const model::Path *>(obj);
+            pod(o->mDirection);
+            property(o->mShape);
+            break;
+        }
+        case model::Object::Type::Polystar: {
+            auto o = static_cast<const model::Polystar *>(obj);
+            pod(o->mDirection);
+            pod(o->mPolyType);
+            property(o->mPos);
+            property(o->mPointCount);
+            property(o->mInnerRadius);
+            property(o->mOuterRadius);
+            property(o->mInnerRoundness);
+            property(o->mOuterRoundness);
+            property(o->mRotation);
+            break;
+        }
+        case model::Object::Type::Trim: {
+            auto o = static_cast<const model::Trim *>(obj);
+            property(o->mStart);
+            property(o->mEnd);
+            property(o->mOffset);
+            pod(o->mTrimType);
+            break;
+        }
+        case model::Object::Type::Repeater: {
+            auto o = static_cast<const model::Repeater *>(obj);
+            object(o->mContent);
+            property(o->mTransform.mRotation);
+            property(o->mTransform.mScale);
+            property(o->mTransform.mPosition);
+            property(o->mTransform.mAnchor);
+            property(o->mTransform.mStartOpacity);
+            property(o->mTransform.mEndOpacity);
+            property(o->mCopies);
+            property(o->mOffset);
+            pod(o->mMaxCopies);
+            pod(o->mProcessed);
+            break;
+        }
+        case model::Object::Type::RoundedCorner: {
+            auto o = static_cast<const model::RoundedCorner *>(obj);
+            property(o->mRadius);
+            break;
+        }
+        }
+    }
+
+    std::string                                           mData;
+    std::unordered_map<const model::Object *, uint32_t>   mObjects;
+    std::unordered_map<const VInterpolator *, uint32_t>   mInterpolators;
+};
+
+class ModelReader {
+public:
+    ModelReader(const char *data, size_t size) : mPos(data), mEnd(data + size)
+    {
+    }
+
+    std::shared_ptr<model::Composition> read()
+    {
+        char magic[sizeof(CompiledMagic)];
+        bytes(magic, sizeof(magic));
+        if (mError || memcmp(magic, CompiledMagic, sizeof(magic)) ||
+            pod<uint32_t>() != CompiledVersion ||
+            pod<uint32_t>() != CompiledEndian ||
+            pod<uint32_t>() != layoutSignature()) {
+            vWarning << "Input data is not a compiled Lottie model!";
+            return {};
+        }
+
+        auto composition = std::make_shared<model::Composition>();
+        mComp = composition.get();
+
+        mComp->mVersion = string();
+        mComp->mSize = pod<VSize>();
+        mComp->mStartFrame = pod<long>();
+        mComp->mEndFrame = pod<long>();
+        mComp->mFrameRate = pod<float>();
+        mComp->mBlendMode = enumeration(model::BlendMode::Normal,
+                                        model::BlendMode::OverLay);
+        mComp->setStatic(flag());
+
+        for (size_t n = count(); n && !mError; n--) {
+            auto key = string();
+            mComp->mAssets[key] = asset();
+        }
+
+        for (size_t n = count(); n && !mError; n--) {
+            auto name = string();
+            auto start = pod<int>();
+            auto duration = pod<int>();
+            mComp->mMarkers.emplace_back(std::move(name), start, duration);
+        }
+
+        mComp->mRootLayer = ref<model::Layer>(model::Object::Type::Layer);
+
+        if (mError || !mComp->mRootLayer || mPos != mEnd) {
+            vWarning << "Compiled Lottie model is corrupted!";
+            return {};
+        }
+
+        mComp->updateStats();
+
+        return composition;
+    }
+
+private:
+    VArenaAlloc &allocator() { return mComp->mArenaAlloc; }
+
+    void bytes(void *dst, size_t size)
+    {
+        if (mError || size_t(mEnd - mPos) < size) {
+            mError = true;
+            memset(dst, 0, size);
+            return;
+        }
+        memcpy(dst, mPos, size);
+        mPos += size;
+    }
+    template <typename T>
+    T pod()
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "not a pod");
+        T v;
+        bytes(&v, sizeof(T));
+        return v;
+    }
+    bool flag() { return pod<uint8_t>() != 0; }
+    // the renderer switches over enums without a default case.
+    template <typename T>
+    T enumeration(T first, T last)
+    {
+        auto v = pod<T>();
+        if (v < first || v > last) {
+            mError = true;
+            return first;
+        }
+        return v;
+    }
+    // every counted element takes at least one byte, so a count can
+    // never be larger than the remaining data.
+    size_t count()
+    {
+        auto n = size_t(pod<uint32_t>());
+        if (n > size_t(mEnd - mPos)) {
+            mError = true;
+            return 0;
+        }
+        return n;
+    }
+    std::string string()
+    {
+        auto        n = count();
+        std::string s(mPos, n);
+        mPos += n;
+        return s;
+    }
+
+    void value(float &v) { v = pod<float>(); }
+    void value(VPointF &v) { v = pod<VPointF>(); }
+    void value(model::Color &v) { v = pod<model::Color>(); }
+    void value(model::PathData &v)
+    {
+        v.mPoints.resize(count());
+        for (auto &pt : v.mPoints) pt = pod<VPointF>();
+        v.mClosed = flag();
+    }
+    void value(model::Gradient::Data &v)
+    {
+        v.mGradient.resize(count());
+        for (auto &e : v.mGradient) e = pod<float>();
+    }
+
+    template <typename T, typename Tag>
+    void keyValue(model::Value<T, Tag> &v)
+    {
+        value(v.start_);
+        value(v.end_);
+    }
+    template <typename T>
+    void keyValue(model::Value<T, model::Position> &v)
+    {
+        value(v.start_);
+        value(v.end_);
+        value(v.inTangent_);
+        value(v.outTangent_);
+        v.length_ = pod<float>();
+        v.hasTangent_ = flag();
+    }
+
+    template <typename T, typename Tag>
+    void property(model::Property<T, Tag> &p)
+    {
+        if (flag()) {
+            value(p.value());
+            return;
+        }
+        auto &frames = p.animation().frames_;
+        frames.resize(count());
+        for (auto &f : frames) {
+            f.start_ = pod<float>();
+            f.end_ = pod<float>();
+            f.interpolator_ = interpolator();
+            keyValue(f.value_);
+        }
+        // the keyframe lookup expects at least one frame.
+        if (frames.empty()) mError = true;
+    }
+
+    VInterpolator *interpolator()
+    {
+        auto id = size_t(pod<uint32_t>());
+        if (!id) return nullptr;
+        if (id <= mInterpolators.size()) return mInterpolators[id - 1];
+        if (id != mInterpolators.size() + 1) {
+            mError = true;
+            return nullptr;
+        }
+        auto obj = allocator().make<VInterpolator>();
+        *obj = pod<VInterpolator>();
+        mInterpolators.push_back(obj);
+        return obj;
+    }
+
+    void dash(model::Dash &d)
+    {
+        d.mData.resize(count());
+        for (auto &e : d.mData) property(e);
+    }
+
+    model::Asset *asset()
+    {
+        auto a = allocator().make<model::Asset>();
+        a->mAssetType = enumeration(model::Asset::Type::Precomp,
+                                     model::Asset::Type::Char);
+        a->setStatic(flag());
+        a->mRefId = string();
+        a->mLayers.resize(count());
+        for (auto &e : a->mLayers) e = object();
+        checkLayers(a->mLayers);
+        a->mWidth = pod<int>();
+        a->mHeight = pod<int>();
+
+        if (!flag()) return a;
+        auto format = pod<VBitmap::Format>();
+        auto width = count();
+        auto height = count();
+        if (mError || format == VBitmap::Format::Invalid ||
+            format > VBitmap::Format::ARGB32_Premultiplied) {
+            mError = true;
+            return a;
+        }
+        // the pixels have to be in the data before the bitmap is allocated.
+        size_t pixelBytes = format == VBitmap::Format::Alpha8 ? 1 : 4;
+        size_t rowBytes = width * pixelBytes;
+        if (rowBytes / pixelBytes != width ||
+            (height && rowBytes > size_t(mEnd - mPos) / height)) {
+            mError = true;
+            return a;
+        }
+        a->mBitmap = VBitmap(width, height, format);
+        for (size_t y = 0; y < height && !mError; y++) {
+            bytes(a->mBitmap.data() + y * a->mBitmap.stride(), rowBytes);
+        }
+        return a;
+    }
+
+    model::Mask *mask()
+    {
+        auto m = allocator().make<model::Mask>();
+        property(m->mShape);
+        property(m->mOpacity);
+        m->mInv = flag();
+        m->mIsStatic = flag();
+        m->mMode = enumeration(model::Mask::Mode::None,
+                               model::Mask::Mode::Difference);
+        return m;
+    }
+
+    void transform(model::Transform &t, bool staticFlag)
+    {
+        if (staticFlag) {
+            float v[9];
+            for (auto &e : v) e = pod<float>();
+            auto opacity = pod<float>();
+            t.set(VMatrix(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8]),
+                  opacity);
+            return;
+        }
+        auto data = allocator().make<model::Transform::Data>();
+        property(data->mRotation);
+        property(data->mScale);
+        property(data->mPosition);
+        property(data->mAnchor);
+        property(data->mOpacity);
+        if (flag()) {
+            data->createExtraData();
+            auto extra = data->mExtra.get();
+            property(extra->m3DRx);
+            property(extra->m3DRy);
+            property(extra->m3DRz);
+            property(extra->mSeparateX);
+            property(extra->mSeparateY);
+            extra->mSeparate = flag();
+            extra->m3DData = flag();
+        }
+        t.set(data, false);
+    }
+
+    void group(model::Group &g)
+    {
+        g.mChildren.resize(count());
+        for (auto &e : g.mChildren) {
+            e = object();
+            if (!e) mError = true;
+        }
+        g.mTransform = ref<model::Transform>(model::Object::Type::Transform);
+    }
+
+    void layer(model::Layer &l)
+    {
+        group(l);
+        l.mMatteType = enumeration(model::MatteType::None,
+                                   model::MatteType::LumaInv);
+        l.mLayerType = enumeration(model::Layer::Type::Precomp,
+                                   model::Layer::Type::Text);
+        l.mBlendMode = enumeration(model::BlendMode::Normal,
+                                   model::BlendMode::OverLay);
+        l.mHasRoundedCorner = flag();
+        l.mHasPathOperator = flag();
+        l.mHasMask = flag();
+        l.mHasRepeater = flag();
+        l.mHasGradient = flag();
+        l.mAutoOrient = flag();
+        l.mLayerSize = pod<VSize>();
+        l.mParentId = pod<int>();
+        l.mId = pod<int>();
+        l.mTimeStreatch = pod<float>();
+        l.mInFrame = pod<int>();
+        l.mOutFrame = pod<int>();
+        l.mStartFrame = pod<int>();
+
+        if (l.mLayerType == model::Layer::Type::Precomp) checkLayers(l.mChildren);
+
+        if (!flag()) return;
+        auto extra = l.extra();
+        extra->mSolidColor = pod<model::Color>();
+        extra->mPreCompRefId = string();
+        property(extra->mTimeRemap);
+        extra->mCompRef = mComp;
+        auto refId = string();
+        if (!refId.empty()) {
+            auto search = mComp->mAssets.find(refId);
+            if (search != mComp->mAssets.end())
+                extra->mAsset = search->second;
+        }
+        extra->mMasks.resize(count());
+        for (auto &e : extra->mMasks) e = mask();
+    }
+
+    // the render tree casts the children of a precomp to layers and
+    // follows their parent ids, which must not form a cycle.
+    void checkLayers(const std::vector<model::Object *> &list)
+    {
+        std::unordered_map<int, model::Layer *> layers;
+        for (const auto &e : list) {
+            if (!e || e->type() != model::Object::Type::Layer) {
+                mError = true;
+                return;
+            }
+            // the renderer links a parent id to the last layer using it.
+            auto layer = static_cast<model::Layer *>(e);
+            layers[layer->id()] = layer;
+        }
+        for (const auto &e : list) {
+            auto layer = static_cast<model::Layer *>(e);
+            for (size_t depth = 0; layer->hasParent(); depth++) {
+                auto search = layers.find(layer->parentId());
+                if (search == layers.end()) break;
+                if (depth == list.size()) {
+                    mError = true;
+                    return;
+                }
+                layer = search->second;
+            }
+        }
+    }
+
+    void gradient(model::Gradient &g)
+    {
+        g.mGradientType = pod<int>();
+        property(g.mStartPoint);
+        property(g.mEndPoint);
+        property(g.mHighlightLength);
+        property(g.mHighlightAngle);
+        property(g.mOpacity);
+        property(g.mGradient);
+        g.mColorPoints = pod<int>();
+        g.mEnabled = flag();
+    }
+
+    template <typename T>
+    T *ref(model::Object::Type type)
+    {
+        auto obj = object();
+        if (obj && obj->type() != type) {
+            mError = true;
+            return nullptr;
+        }
+        return static_cast<T *>(obj);
+    }
+
+    // every object gets the next id when its body starts.
+    template <typename T>
+    T *make()
+    {
+        auto o = allocator().make<T>();
+        mObjects.push_back(o);
+        mComplete.push_back(false);
+        return o;
+    }
+
+    model::Object *object()
+    {
+        auto id = size_t(pod<uint32_t>());
+        if (mError || !id) return nullptr;
+        if (id <= mObjects.size()) {
+            // an object still being read would reference itself.
+            if (!mComplete[id - 1]) {
+                mError = true;
+                return nullptr;
+            }
+            return mObjects[id - 1];
+        }
+        if (id != mObjects.size() + 1) {
+            mError = true;
+            return nullptr;
+        }
+
+        auto type = pod<model::Object::Type>();
+        auto name = string();
+        auto staticFlag = flag();
+        auto hidden = flag();
+        if (mError) return nullptr;
+
+        model::Object *obj = nullptr;
+        switch (type) {
+        case model::Object::Type::Layer: {
+            auto o = make<model::Layer>();
+            layer(*o);
+            obj = o;
+            break;
+        }
+        case model::Object::Type::Group: {
+            auto o = make<model::Group>();
+            group(*o);
+            obj = o;
+            break;
+        }
+        case model::Object::Type::Transform: {
+            auto o = make<model::Transform>();
+            transform(*o, staticFlag);
+            obj = o;
+            break;
+        }
+        case model::Object::Type::Fill: {
+            auto o = make<model::Fill>();
+            o->mFillRule = enumeration(FillRule::EvenOdd, FillRule::Winding);
+            o->mEnabled = flag();
+            property(o->mColor);
+            property(o->mOpacity);
+            obj = o;
+            break;
+        }
+        case model::Object::Type::Stroke: {
+            auto o = make<model::Stroke>();
+            property(o->mColor);
+            property(o->mOpacity);
+            property(o->mWidth);
+            o->mCapStyle = enumeration(CapStyle::Flat, CapStyle::Round);
+            o->mJoinStyle = enumeration(JoinStyle::Miter, JoinStyle::Round);
+            o->mMiterLimit = pod<float>();
+            dash(o->mDash);
+            o->mEnabled = flag();
+            obj = o;
+            break;
+        }
+        case model::Object::Type::GFill: {
+            auto o = make<model::GradientFill>();
+            gradient(*o);
+            o->mFillRule = enumeration(FillRule::EvenOdd, FillRule::Winding);
+            obj = o;
+            break;
+        }
+        case model::Object::Type::GStroke: {
+            auto o = make<model::GradientStroke>();
+            gradient(*o);
+            property(o->mWidth);
+            o->mCapStyle = enumeration(CapStyle::Flat, CapStyle::Round);
+            o->mJoinStyle = enumeration(JoinStyle::Miter, JoinStyle::Round);
+            o->mMiterLimit = pod<float>();
+            dash(o->mDash);
+            obj = o;
+            break;
+        }
+        case model::Object::Type::Rect: {
+            auto o = make<model::Rect>();
+            o->mDirection = pod<int>();
+            o->mRoundedCorner = ref<model::RoundedCorner>(
+                model::Object::Type::RoundedCorner);
+            property(o->mPos);
+            property(o->mSize);
+            property(o->mRound);
+            obj = o;
+            break;
+        }
+        case model::Object::Type::Ellipse: {
+            auto o = make<model::Ellipse>();
+            o->mDirection = pod<int>();
+            property(o->mPos);
+            property(o->mSize);
+            obj = o;
+            break;
+        }
+        case model::Object::Type::Path: {
+            auto o = make<model::Path>();
+            o->mDirection = pod<int>();
+            property(o->mShape);
+            obj = o;
+            break;
+        }
+        case model::Object::Type::Polystar: {
+            auto o = make<model::Polystar>();
+            o->mDirection = pod<int>();
+            o->mPolyType = enumeration(model::Polystar::PolyType::Star,
+                                       model::Polystar::PolyType::Polygon);
+            property(o->mPos);
+            property(o->mPointCount);
+            property(o->mInnerRadius);
+            property(o->mOuterRadius);
+            property(o->mInnerRoundness);
+            property(o->mOuterRoundness);
+            property(o->mRotation);
+            obj = o;
+            break;
+        }
+        case model::Object::Type::Trim: {
+            auto o = make<model::Trim>();
+            property(o->mStart);
+            property(o->mEnd);
+            property(o->mOffset);
+            o->mTrimType = enumeration(model::Trim::TrimType::Simultaneously,
+                                       model::Trim::TrimType::Individually);
+            obj = o;
+            break;
+        }
+        case model::Object::Type::Repeater: {
+            auto o = make<model::Repeater>();
+            o->mContent = ref<model::Group>(model::Object::Type::Group);
+            property(o->mTransform.mRotation);
+            property(o->mTransform.mScale);
+            property(o->mTransform.mPosition);
+            property(o->mTransform.mAnchor);
+            property(o->mTransform.mStartOpacity);
+            property(o->mTransform.mEndOpacity);
+            property(o->mCopies);
+            property(o->mOffset);
+            o->mMaxCopies = pod<float>();
+            if (flag()) o->markProcessed();
+            // the renderer always expects the repeater content.
+            if (!o->mContent) mError = true;
+            obj = o;
+            break;
+        }
+        case model::Object::Type::RoundedCorner: {
+            auto o = make<model::RoundedCorner>();
+            property(o->mRadius);
+            obj = o;
+            break;
+        }
+        default:
+            mError = true;
+            return nullptr;
+        }
+        mComplete[id - 1] = true;
+
+        if (!name.empty()) obj->setName(name.c_str());
+        obj->setStatic(staticFlag);
+        obj->setHidden(hidden);
+        return obj;
+    }
+
+    const char *                   mPos;
+    const char *                   mEnd;
+    bool                           mError{false};
+    model::Composition *           mComp{nullptr};
+    std::vector<model::Object *>   mObjects;
+    std::vector<bool>              mComplete;
+    std::vector<VInterpolator *>   mInterpolators;
+};
+
+std::string model::serialize(const model::Composition &comp)
+{
+    return ModelWriter().write(comp);
+}
+
+std::shared_ptr<model::Composition> model::deserialize(const char *data,
+                                                       size_t      size)
+{
+    if (!data) return {};
+    return ModelReader(data, size).read();
+}
@@ -70,6 +70,7 @@
 #include <limits.h>
 #include <setjmp.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #define SW_FT_UINT_MAX UINT_MAX
 #define SW_FT_INT_MAX INT_MAX
@@ -104,6 +105,10 @@ typedef ptrdiff_t SW_FT_PtrDist;
 /* to do all of its work.                                                */
 #define SW_FT_RENDER_POOL_SIZE 16384L
 
+/* The render pool grows on the heap up to this size when the cells of a */
+/* single scan-line don't fit, e.g. for the edges of a poster size shape. */
+#define SW_FT_MAX_RENDER_POOL_SIZE (16L * 1024L * 1024L)
+
 typedef int (*SW_FT_Outline_MoveToFunc)(const SW_FT_Vector* to, void* user);
 
 #define SW_FT_Outline_MoveTo_Func SW_FT_Outline_MoveToFunc
@@ -329,6 +334,7 @@ typedef struct gray_TWorker_ {
 
     void* buffer;
     long  buffer_size;
+    void* heap_buffer;
 
     PCell* ycells;
     TPos   ycount;
@@ -873,11 +879,9 @@ static void gray_hline(RAS_ARG_ TCoord x, TCoord y, TPos area, TCoord acount)
     y += (TCoord)ras.min_ey;
     x += (TCoord)ras.min_ex;
 
-    /* SW_FT_Span.x is a 16-bit short, so limit our coordinates appropriately */
-    if (x >= 32767) x = 32767;
-
-    /* SW_FT_Span.y is an integer, so limit our coordinates appropriately */
-    if (y >= SW_FT_INT_MAX) y = SW_FT_INT_MAX;
+    /* SW_FT_Span coordinates may be 16-bit, limit them appropriately */
+    if (x >= SW_FT_SPAN_COORD_MAX) x = SW_FT_SPAN_COORD_MAX;
+    if (y >= SW_FT_SPAN_COORD_MAX) y = SW_FT_SPAN_COORD_MAX;
 
     if (coverage) {
         SW_FT_Span* span;
@@ -894,7 +898,7 @@ static void gray_hline(RAS_ARG_ TCoord x, TCoord y, TPos area, TCoord acount)
         span = ras.gray_spans + count - 1;
         if (count > 0 && span->y == y && (int)span->x + span->len == (int)x &&
             span->coverage == coverage) {
-            span->len = (unsigned short)(span->len + acount);
+            span->len = (SW_FT_Span_Length)(span->len + acount);
             return;
         }
 
@@ -924,9 +928,9 @@ static void gray_hline(RAS_ARG_ TCoord x, TCoord y, TPos area, TCoord acount)
             span++;
 
         /* add a gray span to the current list */
-        span->x = (short)x;
-        span->y = (short)y;
-        span->len = (unsigned short)acount;
+        span->x = (SW_FT_Span_Coord)x;
+        span->y = (SW_FT_Span_Coord)y;
+        span->len = (SW_FT_Span_Length)acount;
         span->coverage = (unsigned char)coverage;
 
         ras.num_gray_spans++;
@@ -1214,6 +1218,24 @@ static int gray_convert_glyph_inner(RAS_ARG)
     return error;
 }
 
+/* doubles the render pool, returns 0 when it can't grow anymore */
+static int gray_grow_pool(RAS_ARG)
+{
+    long  size = ras.buffer_size * 2;
+    void* buffer;
+
+    if (size > SW_FT_MAX_RENDER_POOL_SIZE) return 0;
+
+    buffer = malloc((size_t)size);
+    if (!buffer) return 0;
+
+    free(ras.heap_buffer);
+    ras.heap_buffer = buffer;
+    ras.buffer = buffer;
+    ras.buffer_size = size;
+    return 1;
+}
+
 static int gray_convert_glyph(RAS_ARG)
 {
     gray_TBand bands[40];
@@ -1310,10 +1332,11 @@ static int gray_convert_glyph(RAS_ARG)
             top = band->max;
             middle = bottom + ((top - bottom) >> 1);
 
-            /* This is too complex for a single scanline; there must */
-            /* be some problems.                                     */
+            /* A single scanline doesn't fit the render pool, retry the */
+            /* band with a larger pool.                                 */
             if (middle == bottom) {
-                return 1;
+                if (!gray_grow_pool(RAS_VAR)) return 1;
+                continue;
             }
 
             if (bottom - top >= ras.band_size) ras.band_shoot++;
@@ -1362,13 +1385,14 @@ static int gray_raster_render(gray_PRaster               raster,
     if (params->flags & SW_FT_RASTER_FLAG_CLIP)
         ras.clip_box = params->clip_box;
     else {
-        ras.clip_box.xMin = -32768L;
-        ras.clip_box.yMin = -32768L;
-        ras.clip_box.xMax = 32767L;
-        ras.clip_box.yMax = 32767L;
+        ras.clip_box.xMin = -SW_FT_SPAN_COORD_MAX - 1;
+        ras.clip_box.yMin = -SW_FT_SPAN_COORD_MAX - 1;
+        ras.clip_box.xMax = SW_FT_SPAN_COORD_MAX;
+        ras.clip_box.yMax = SW_FT_SPAN_COORD_MAX;
     }
 
     gray_init_cells(RAS_VAR_ buffer, buffer_size);
+    ras.heap_buffer = NULL;
 
     ras.outline = *outline;
     ras.num_cells = 0;
@@ -1380,6 +1404,7 @@ static int gray_raster_render(gray_PRaster               raster,
     ras.render_span_data = params->user;
 
     gray_convert_glyph(RAS_VAR);
+    free(ras.heap_buffer);
     params->bbox_cb(ras.bound_left, ras.bound_top,
                     ras.bound_right - ras.bound_left,
                     ras.bound_bottom - ras.bound_top + 1, params->user);
@@ -25,6 +25,7 @@
   /*                                                                       */
   /*************************************************************************/
 
+#include "config.h"
 #include "v_ft_types.h"
 
   /*************************************************************************/
@@ -102,7 +103,7 @@
 /*                                                                       */
 /*                  Bits 3 and~4 are reserved for internal purposes.     */
 /*                                                                       */
-/*    contours   :: An array of `n_contours' shorts, giving the end      */
+/*    contours   :: An array of `n_contours' ints, giving the end        */
 /*                  point of each contour within the outline.  For       */
 /*                  example, the first contour is defined by the points  */
 /*                  `0' to `contours[0]', the second one is defined by   */
@@ -114,12 +115,12 @@
 /*                                                                       */
 typedef struct  SW_FT_Outline_
 {
-  short       n_contours;      /* number of contours in glyph        */
-  short       n_points;        /* number of points in the glyph      */
+  int         n_contours;      /* number of contours in glyph        */
+  int         n_points;        /* number of points in the glyph      */
 
   SW_FT_Vector*  points;          /* the outline's points               */
   char*       tags;            /* the points flags                   */
-  short*      contours;        /* the contour end points             */
+  int*        contours;        /* the contour end points             */
   char*       contours_flag;   /* the contour open flags             */
 
   int         flags;           /* outline masks                      */
@@ -234,12 +235,25 @@ typedef struct  SW_FT_Outline_
   /*    The coverage value is always between 0 and 255.  If you want less  */
   /*    gray values, the callback function has to reduce them.             */
   /*                                                                       */
+  /*    The coordinates are 16 bit unless LOTTIE_WIDE_SPAN_SUPPORT is      */
+  /*    defined, the layout has to match VRle::Span.                       */
+  /*                                                                       */
+#ifdef LOTTIE_WIDE_SPAN_SUPPORT
+  typedef int             SW_FT_Span_Coord;
+  typedef int             SW_FT_Span_Length;
+#define SW_FT_SPAN_COORD_MAX  0x7FFFFFFFL
+#else
+  typedef short           SW_FT_Span_Coord;
+  typedef unsigned short  SW_FT_Span_Length;
+#define SW_FT_SPAN_COORD_MAX  32767L
+#endif
+
   typedef struct  SW_FT_Span_
   {
-    short           x;
-    short           y;
-    unsigned short  len;
-    unsigned char   coverage;
+    SW_FT_Span_Coord   x;
+    SW_FT_Span_Coord   y;
+    SW_FT_Span_Length  len;
+    unsigned char      coverage;
 
   } SW_FT_Span;
 
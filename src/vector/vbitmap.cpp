@@ -38,7 +38,16 @@ void VBitmap::Impl::reset(size_t width, size_t height, VBitmap::Format format)
     mDepth = depth(format);
     mStride = ((mWidth * mDepth + 31) >> 5)
                   << 2;  // bytes per scanline (must be multiple of 4)
-    mOwnData = std::make_unique<uint8_t[]>(mStride * mHeight);
+    // keep the storage when it is big enough, the content is not preserved.
+    reserve(size_t(mStride) * mHeight);
+}
+
+void VBitmap::Impl::reserve(size_t bytes)
+{
+    if (bytes <= mCapacity) return;
+
+    mOwnData = std::make_unique<uint8_t[]>(bytes);
+    mCapacity = bytes;
 }
 
 void VBitmap::Impl::reset(uint8_t *data, size_t width, size_t height,
@@ -51,6 +60,7 @@ void VBitmap::Impl::reset(uint8_t *data, size_t width, size_t height,
     mFormat = format;
     mDepth = depth(format);
     mOwnData = nullptr;
+    mCapacity = 0;
 }
 
 uint8_t VBitmap::Impl::depth(VBitmap::Format format)
@@ -109,7 +119,7 @@ VBitmap::VBitmap(size_t width, size_t height, VBitmap::Format format)
 {
     if (width <= 0 || height <= 0 || format == Format::Invalid) return;
 
-    mImpl = rc_ptr<Impl>(width, height, format);
+    mImpl = arc_ptr<Impl>(width, height, format);
 }
 
 VBitmap::VBitmap(uint8_t *data, size_t width, size_t height,
@@ -119,7 +129,7 @@ VBitmap::VBitmap(uint8_t *data, size_t width, size_t height,
         format == Format::Invalid)
         return;
 
-    mImpl = rc_ptr<Impl>(data, width, height, bytesPerLine, format);
+    mImpl = arc_ptr<Impl>(data, width, height, bytesPerLine, format);
 }
 
 void VBitmap::reset(uint8_t *data, size_t w, size_t h, size_t bytesPerLine,
@@ -128,7 +138,7 @@ void VBitmap::reset(uint8_t *data, size_t w, size_t h, size_t bytesPerLine,
     if (mImpl) {
         mImpl->reset(data, w, h, bytesPerLine, format);
     } else {
-        mImpl = rc_ptr<Impl>(data, w, h, bytesPerLine, format);
+        mImpl = arc_ptr<Impl>(data, w, h, bytesPerLine, format);
     }
 }
 
@@ -141,10 +151,16 @@ void VBitmap::reset(size_t w, size_t h, VBitmap::Format format)
         }
         mImpl->reset(w, h, format);
     } else {
-        mImpl = rc_ptr<Impl>(w, h, format);
+        mImpl = arc_ptr<Impl>(w, h, format);
     }
 }
 
+void VBitmap::reserve(size_t bytes)
+{
+    if (!mImpl) mImpl = arc_ptr<Impl>(0, 0, Format::Invalid);
+    mImpl->reserve(bytes);
+}
+
 size_t VBitmap::stride() const
 {
     return mImpl ? mImpl->stride() : 0;
@@ -160,6 +176,11 @@ size_t VBitmap::height() const
     return mImpl ? mImpl->height() : 0;
 }
 
+size_t VBitmap::capacity() const
+{
+    return mImpl ? mImpl->mCapacity : 0;
+}
+
 size_t VBitmap::depth() const
 {
     return mImpl ? mImpl->mDepth : 0;
@@ -44,10 +44,13 @@ public:
     void reset(uint8_t *data, size_t w, size_t h, size_t stride,
                VBitmap::Format format);
     void reset(size_t w, size_t h, VBitmap::Format format=Format::ARGB32_Premultiplied);
+    // makes sure a later reset() up to the given bytes doesn't reallocate.
+    void reserve(size_t bytes);
     size_t          stride() const;
     size_t          width() const;
     size_t          height() const;
     size_t          depth() const;
+    size_t          capacity() const;
     VBitmap::Format format() const;
     bool            valid() const;
     uint8_t *       data();
@@ -60,6 +63,7 @@ private:
     struct Impl {
         std::unique_ptr<uint8_t[]> mOwnData{nullptr};
         uint8_t *                  mRoData{nullptr};
+        size_t                     mCapacity{0};  // bytes of mOwnData
         uint32_t                   mWidth{0};
         uint32_t                   mHeight{0};
         uint32_t                   mStride{0};
@@ -84,12 +88,14 @@ private:
         VBitmap::Format format() const { return mFormat; }
         void reset(uint8_t *, size_t, size_t, size_t, VBitmap::Format);
         void reset(size_t, size_t, VBitmap::Format);
+        void reserve(size_t);
         static uint8_t depth(VBitmap::Format format);
         void fill(uint32_t);
         void updateLuma();
     };
 
-    rc_ptr<Impl> mImpl;
+    // decoded images are shared between threads through the image cache.
+    arc_ptr<Impl> mImpl;
 };
 
 V_END_NAMESPACE
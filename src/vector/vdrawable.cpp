@@ -56,7 +56,8 @@ void VDrawable::applyDashOp()
         auto obj = static_cast<StrokeWithDashInfo *>(mStrokeInfo);
         if (!obj->mDash.empty()) {
             VDasher dasher(obj->mDash.data(), obj->mDash.size());
-            mPath.clone(dasher.dashed(mPath));
+            dasher.dashed(mPath, obj->mDashedPath);
+            mPath = obj->mDashedPath;
         }
     }
 }
@@ -75,6 +75,7 @@ public:
 
     struct StrokeWithDashInfo : public StrokeInfo{
         std::vector<float> mDash;
+        VPath              mDashedPath;  // keeps its storage across frames
     };
 
 public:
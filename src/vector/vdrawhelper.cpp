@@ -30,6 +30,11 @@
 
 static RenderFuncTable RenderTable;
 
+void premultiplyImage(uint32_t *dest, const uint8_t *src, int count)
+{
+    RenderTable.premultiplyImage()(dest, src, count);
+}
+
 void VTextureData::setClip(const VRect &clip)
 {
     left = clip.left();
@@ -147,7 +152,7 @@ bool VGradientCache::generateGradientColorTable(const VGradientStops &stops,
 
     colorTable[pos++] = curColor;
 
-    while (fpos <= curr->first) {
+    while (fpos <= curr->first && pos < size) {
         colorTable[pos] = colorTable[pos - 1];
         pos++;
         fpos += incr;
@@ -180,7 +185,14 @@ bool VGradientCache::generateGradientColorTable(const VGradientStops &stops,
 
 void VRasterBuffer::clear()
 {
-    memset(mBuffer, 0, mHeight * mBytesPerLine);
+    size_t rowBytes = mWidth * mBytesPerPixel;
+    if (rowBytes == mBytesPerLine) {
+        memset(mBuffer, 0, mHeight * mBytesPerLine);
+        return;
+    }
+    // buffer is a part of a bigger bitmap, leave the rest of the rows alone.
+    for (size_t y = 0; y < mHeight; y++)
+        memset(mBuffer + y * mBytesPerLine, 0, rowBytes);
 }
 
 VBitmap::Format VRasterBuffer::prepare(const VBitmap *image)
@@ -209,8 +221,6 @@ void VSpanData::init(VRasterBuffer *image)
  *
  */
 
-#define FIXPT_BITS 8
-#define FIXPT_SIZE (1 << FIXPT_BITS)
 static inline void getLinearGradientValues(LinearGradientValues *v,
                                            const VSpanData *     data)
 {
@@ -242,41 +252,6 @@ static inline void getRadialGradientValues(RadialGradientValues *v,
     v->extended = !vIsZero(gradient.radial.fradius) || v->a <= 0;
 }
 
-static inline int gradientClamp(const VGradientData *grad, int ipos)
-{
-    int limit;
-
-    if (grad->mSpread == VGradient::Spread::Repeat) {
-        ipos = ipos % VGradient::colorTableSize;
-        ipos = ipos < 0 ? VGradient::colorTableSize + ipos : ipos;
-    } else if (grad->mSpread == VGradient::Spread::Reflect) {
-        limit = VGradient::colorTableSize * 2;
-        ipos = ipos % limit;
-        ipos = ipos < 0 ? limit + ipos : ipos;
-        ipos = ipos >= VGradient::colorTableSize ? limit - 1 - ipos : ipos;
-    } else {
-        if (ipos < 0)
-            ipos = 0;
-        else if (ipos >= VGradient::colorTableSize)
-            ipos = VGradient::colorTableSize - 1;
-    }
-    return ipos;
-}
-
-static uint32_t gradientPixelFixed(const VGradientData *grad, int fixed_pos)
-{
-    int ipos = (fixed_pos + (FIXPT_SIZE / 2)) >> FIXPT_BITS;
-
-    return grad->mColorTable[gradientClamp(grad, ipos)];
-}
-
-static inline uint32_t gradientPixel(const VGradientData *grad, float pos)
-{
-    int ipos = (int)(pos * (VGradient::colorTableSize - 1) + (float)(0.5));
-
-    return grad->mColorTable[gradientClamp(grad, ipos)];
-}
-
 void fetch_linear_gradient(uint32_t *buffer, const Operator *op,
                            const VSpanData *data, int y, int x, int length)
 {
@@ -311,13 +286,9 @@ void fetch_linear_gradient(uint32_t *buffer, const Operator *op,
             if (t + inc * length < float(INT_MAX >> (FIXPT_BITS + 1)) &&
                 t + inc * length > float(INT_MIN >> (FIXPT_BITS + 1))) {
                 // we can use fixed point math
-                int t_fixed = int(t * FIXPT_SIZE);
-                int inc_fixed = int(inc * FIXPT_SIZE);
-                while (buffer < end) {
-                    *buffer = gradientPixelFixed(gradient, t_fixed);
-                    t_fixed += inc_fixed;
-                    ++buffer;
-                }
+                RenderTable.linearGradient()(buffer, length, gradient,
+                                             int(t * FIXPT_SIZE),
+                                             int(inc * FIXPT_SIZE));
             } else {
                 // we have to fall back to float math
                 while (buffer < end) {
@@ -353,38 +324,6 @@ static inline float radialDeterminant(float a, float b, float c)
     return (b * b) - (4 * a * c);
 }
 
-static void fetch(uint32_t *buffer, uint32_t *end, const Operator *op,
-                  const VSpanData *data, float det, float delta_det,
-                  float delta_delta_det, float b, float delta_b)
-{
-    if (op->radial.extended) {
-        while (buffer < end) {
-            uint32_t result = 0;
-            if (det >= 0) {
-                float w = std::sqrt(det) - b;
-                if (data->mGradient.radial.fradius + op->radial.dr * w >= 0)
-                    result = gradientPixel(&data->mGradient, w);
-            }
-
-            *buffer = result;
-
-            det += delta_det;
-            delta_det += delta_delta_det;
-            b += delta_b;
-
-            ++buffer;
-        }
-    } else {
-        while (buffer < end) {
-            *buffer++ = gradientPixel(&data->mGradient, std::sqrt(det) - b);
-
-            det += delta_det;
-            delta_det += delta_delta_det;
-            b += delta_b;
-        }
-    }
-}
-
 void fetch_radial_gradient(uint32_t *buffer, const Operator *op,
                            const VSpanData *data, int y, int x, int length)
 {
@@ -438,8 +377,9 @@ void fetch_radial_gradient(uint32_t *buffer, const Operator *op,
         const float delta_delta_det =
             (delta_b_delta_b + 4 * op->radial.a * delta_rx_plus_ry) * inv_a;
 
-        fetch(buffer, end, op, data, det, delta_det, delta_delta_det, b,
-              delta_b);
+        RenderTable.radialGradient()(buffer, length, &data->mGradient,
+                                     &op->radial, det, delta_det,
+                                     delta_delta_det, b, delta_b);
     } else {
         float rw = data->m23 * (y + float(0.5)) + data->m33 +
                    data->m13 * (x + float(0.5));
@@ -605,6 +545,51 @@ static void blend_image_xform(size_t size, const VRle::Span *array,
         });
 }
 
+/*
+ * steps through the source in 16.16 fixed point, only used when the matrix
+ * keeps the positions in range (VSpanData::fast_matrix).
+ */
+template <bool Smooth>
+static void blend_image_fixed(size_t size, const VRle::Span *array,
+                              void *userData)
+{
+    const auto  data = reinterpret_cast<const VSpanData *>(userData);
+    const auto &src = data->texture();
+
+    if (src.format() != VBitmap::Format::ARGB32_Premultiplied &&
+        src.format() != VBitmap::Format::ARGB32) {
+        //@TODO other formats not yet handled.
+        return;
+    }
+
+    Operator    op = getOperator(data);
+    const auto  fetch =
+        Smooth ? RenderTable.bilinearImage() : RenderTable.nearestImage();
+    const float fixedOne = 65536.0f;
+    const int   fdx = int(data->m11 * fixedOne);
+    const int   fdy = int(data->m12 * fixedOne);
+
+    process_in_chunk(
+        array, size,
+        [&](uint32_t *scratch, size_t x, size_t y, size_t len, uint8_t cov) {
+            const auto coverage = (cov * src.alpha()) >> 8;
+            float      fx, fy;
+            if (Smooth) {
+                // sample at the pixel center.
+                const float cx = x + 0.5f, cy = y + 0.5f;
+                fx = cx * data->m11 + cy * data->m21 + data->dx - 0.5f;
+                fy = cx * data->m12 + cy * data->m22 + data->dy - 0.5f;
+            } else {
+                // same sample position as blend_image_xform().
+                fx = x * data->m11 + y * data->m21 + data->dx + data->m11;
+                fy = x * data->m12 + y * data->m22 + data->dy + data->m12;
+            }
+            fetch(scratch, (int)len, &src, int(fx * fixedOne),
+                  int(fy * fixedOne), fdx, fdy);
+            op.func(data->buffer((int)x, (int)y), (int)len, scratch, coverage);
+        });
+}
+
 static void blend_image(size_t size, const VRle::Span *array, void *userData)
 {
     const auto  data = reinterpret_cast<const VSpanData *>(userData);
@@ -746,6 +731,9 @@ void VSpanData::updateSpanFunc()
         //@TODO update proper image function.
         if (transformType <= VMatrix::MatrixType::Translate) {
             mUnclippedBlendFunc = &blend_image;
+        } else if (fast_matrix) {
+            mUnclippedBlendFunc = mSmoothImage ? &blend_image_fixed<true>
+                                               : &blend_image_fixed<false>;
         } else {
             mUnclippedBlendFunc = &blend_image_xform;
         }
@@ -754,13 +742,3 @@ void VSpanData::updateSpanFunc()
     }
 }
 
-#if !defined(__SSE2__) && !defined(__ARM_NEON__)
-void memfill32(uint32_t *dest, uint32_t value, int length)
-{
-    // let compiler do the auto vectorization.
-    for (int i = 0 ; i < length; i++) {
-        *dest++ = value;
-    }
-}
-#endif
-
@@ -23,6 +23,7 @@
 #ifndef VDRAWHELPER_H
 #define VDRAWHELPER_H
 
+#include <algorithm>
 #include <memory>
 #include <array>
 #include "assert.h"
@@ -33,8 +34,18 @@
 
 V_USE_NAMESPACE
 
+// SSE4 and AVX kernels are built with function target attributes and picked
+// at runtime
+#if defined(__SSE2__) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define LOTTIE_AVX_SUPPORT
+#endif
+
 struct VSpanData;
 struct Operator;
+struct VGradientData;
+struct RadialGradientValues;
+struct VTextureData;
 
 struct RenderFunc
 {
@@ -56,10 +67,40 @@ struct RenderFunc
     };
 };
 
+struct GradientFunc
+{
+    // fixed point position of the i'th pixel is pos + i * inc.
+    using Linear = void (*)(uint32_t *dest, int length,
+                            const VGradientData *gradient, int pos, int inc);
+    // the determinant and b are forward differenced from pixel to pixel.
+    using Radial = void (*)(uint32_t *dest, int length,
+                            const VGradientData *       gradient,
+                            const RadialGradientValues *v, float det,
+                            float deltaDet, float deltaDeltaDet, float b,
+                            float deltaB);
+};
+
+struct ImageFunc
+{
+    // 16.16 fixed point source position of the i'th pixel is
+    // (x + i * dx, y + i * dy), samples are clamped to the texture clip.
+    using Fetch = void (*)(uint32_t *dest, int length,
+                           const VTextureData *texture, int x, int y, int dx,
+                           int dy);
+    // converts decoded RGBA bytes to premultiplied ARGB32 pixels.
+    using Convert = void (*)(uint32_t *dest, const uint8_t *src, int length);
+};
+
 class RenderFuncTable
 {
 public:
-    RenderFuncTable();
+    // instruction set extensions the blend functions are picked from.
+    enum class Simd { None, Neon, Sse2, Sse4, Avx2, Avx512 };
+
+    // the table never uses more than the cpu supports.
+    explicit RenderFuncTable(Simd simd = supportedSimd());
+    static Simd supportedSimd();
+
     RenderFunc::Color color(BlendMode mode) const
     {
         return colorTable[uint32_t(mode)].color_;
@@ -68,9 +109,17 @@ public:
     {
         return srcTable[uint32_t(mode)].src_;
     }
+    GradientFunc::Linear linearGradient() const { return mLinearGradient; }
+    GradientFunc::Radial radialGradient() const { return mRadialGradient; }
+    ImageFunc::Fetch     nearestImage() const { return mNearestImage; }
+    ImageFunc::Fetch     bilinearImage() const { return mBilinearImage; }
+    ImageFunc::Convert   premultiplyImage() const { return mPremultiplyImage; }
 private:
     void neon();
     void sse();
+    void sse4();
+    void avx2();
+    void avx512();
     void updateColor(BlendMode mode, RenderFunc::Color f)
     {
         colorTable[uint32_t(mode)] = {RenderFunc::Type::Color, f};
@@ -82,6 +131,11 @@ private:
 private:
     std::array<RenderFunc, uint32_t(BlendMode::Last)> colorTable;
     std::array<RenderFunc, uint32_t(BlendMode::Last)> srcTable;
+    GradientFunc::Linear                              mLinearGradient;
+    GradientFunc::Radial                              mRadialGradient;
+    ImageFunc::Fetch                                  mNearestImage;
+    ImageFunc::Fetch                                  mBilinearImage;
+    ImageFunc::Convert                                mPremultiplyImage;
 };
 
 typedef void (*SourceFetchProc)(uint32_t *buffer, const Operator *o,
@@ -91,6 +145,7 @@ typedef void (*ProcessRleSpan)(size_t count, const VRle::Span *spans,
                                void *userData);
 
 extern void memfill32(uint32_t *dest, uint32_t value, int count);
+extern void premultiplyImage(uint32_t *dest, const uint8_t *src, int count);
 
 struct LinearGradientValues {
     float dx;
@@ -197,15 +252,24 @@ struct VSpanData {
                int alpha = 255);
     void setupMatrix(const VMatrix &matrix);
 
-    VRect clipRect() const
-    {
-        return VRect(0, 0, mDrawableSize.width(), mDrawableSize.height());
-    }
+    VRect clipRect() const { return mClipRect; }
 
     void setDrawRegion(const VRect &region)
     {
         mOffset = VPoint(region.left(), region.top());
         mDrawableSize = VSize(region.width(), region.height());
+        mClipRect = drawableRect();
+    }
+
+    // restrict drawing to a part of the draw region.
+    void setClipRect(const VRect &clip) { mClipRect = clip & drawableRect(); }
+
+    // the part of the draw region the rle spans can address.
+    VRect drawableRect() const
+    {
+        return VRect(0, 0,
+                     std::min(mDrawableSize.width(), VRle::Span::maxCoord()),
+                     std::min(mDrawableSize.height(), VRle::Span::maxCoord()));
     }
 
     uint32_t *buffer(int x, int y) const
@@ -223,12 +287,14 @@ struct VSpanData {
     std::shared_ptr<const VColorTable> mColorTable{nullptr};
     VPoint                             mOffset;  // offset to the subsurface
     VSize                              mDrawableSize;  // suburface size
+    VRect                              mClipRect;  // drawing is clipped to it
     uint32_t                           mSolid;
     VGradientData                      mGradient;
     VTextureData                       mTexture;
 
     float m11, m12, m13, m21, m22, m23, m33, dx, dy;  // inverse xform matrix
     bool  fast_matrix{true};
+    bool  mSmoothImage{false};  // bilinear filtering of transformed images
     VMatrix::MatrixType transformType{VMatrix::MatrixType::None};
 };
 
@@ -256,6 +322,45 @@ inline constexpr int vAlpha(uint32_t c)
     return c >> 24;
 }
 
+#define FIXPT_BITS 8
+#define FIXPT_SIZE (1 << FIXPT_BITS)
+
+static inline int gradientClamp(const VGradientData *grad, int ipos)
+{
+    int limit;
+
+    if (grad->mSpread == VGradient::Spread::Repeat) {
+        ipos = ipos % VGradient::colorTableSize;
+        ipos = ipos < 0 ? VGradient::colorTableSize + ipos : ipos;
+    } else if (grad->mSpread == VGradient::Spread::Reflect) {
+        limit = VGradient::colorTableSize * 2;
+        ipos = ipos % limit;
+        ipos = ipos < 0 ? limit + ipos : ipos;
+        ipos = ipos >= VGradient::colorTableSize ? limit - 1 - ipos : ipos;
+    } else {
+        if (ipos < 0)
+            ipos = 0;
+        else if (ipos >= VGradient::colorTableSize)
+            ipos = VGradient::colorTableSize - 1;
+    }
+    return ipos;
+}
+
+static inline uint32_t gradientPixelFixed(const VGradientData *grad,
+                                          int                  fixed_pos)
+{
+    int ipos = (fixed_pos + (FIXPT_SIZE / 2)) >> FIXPT_BITS;
+
+    return grad->mColorTable[gradientClamp(grad, ipos)];
+}
+
+static inline uint32_t gradientPixel(const VGradientData *grad, float pos)
+{
+    int ipos = (int)(pos * (VGradient::colorTableSize - 1) + (float)(0.5));
+
+    return grad->mColorTable[gradientClamp(grad, ipos)];
+}
+
 static inline uint32_t interpolate_pixel(uint32_t x, uint32_t a, uint32_t y,
                                          uint32_t b)
 {
@@ -268,4 +373,20 @@ static inline uint32_t interpolate_pixel(uint32_t x, uint32_t a, uint32_t y,
     return x;
 }
 
+/*
+ * (x + 1 + (x >> 8)) >> 8 is x / 255 rounded down for every product of
+ * two 8 bit values.
+ */
+static inline uint32_t div255(uint32_t x)
+{
+    return (x + 1 + (x >> 8)) >> 8;
+}
+
+static inline uint32_t premultiply_pixel(const uint8_t *src)
+{
+    uint32_t a = src[3];
+    return (a << 24) | (div255(src[0] * a) << 16) | (div255(src[1] * a) << 8) |
+           div255(src[2] * a);
+}
+
 #endif  // QDRAWHELPER_P_H
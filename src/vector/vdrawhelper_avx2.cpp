@@ -0,0 +1,637 @@
+/*
+ * Copyright (c) 2020 Samsung Electronics Co., Ltd. All rights reserved.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "vdrawhelper.h"
+
+#if defined(LOTTIE_AVX_SUPPORT)
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cstring>
+
+/*
+ * 8 pixels at a time versions of the blend functions in
+ * vdrawhelper_common.cpp. Every channel is multiplied in its own 16 bit lane
+ * the same way BYTE_MUL() does it, so the result is bit exact with the
+ * scalar table. The tail of a span is handled with masked loads and stores.
+ */
+
+#define V_AVX2 __attribute__((target("avx2")))
+
+// alpha has to be in the form 0x00AA00AA in each pixel.
+V_AVX2 static inline __m256i v8_byte_mul(__m256i c, __m256i a)
+{
+    const __m256i rb_mask = _mm256_set1_epi32(0x00FF00FF);
+    const __m256i ag_mask = _mm256_set1_epi32(int(0xFF00FF00));
+
+    __m256i ag = _mm256_mullo_epi16(_mm256_srli_epi16(c, 8), a);
+    __m256i rb = _mm256_mullo_epi16(_mm256_and_si256(c, rb_mask), a);
+
+    return _mm256_or_si256(_mm256_and_si256(ag, ag_mask),
+                           _mm256_srli_epi16(rb, 8));
+}
+
+// x * a + y * b, same as interpolate_pixel()
+V_AVX2 static inline __m256i v8_interpolate(__m256i x, __m256i a, __m256i y,
+                                            __m256i b)
+{
+    const __m256i rb_mask = _mm256_set1_epi32(0x00FF00FF);
+    const __m256i ag_mask = _mm256_set1_epi32(int(0xFF00FF00));
+
+    __m256i ag = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_srli_epi16(x, 8), a),
+        _mm256_mullo_epi16(_mm256_srli_epi16(y, 8), b));
+    __m256i rb = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_and_si256(x, rb_mask), a),
+        _mm256_mullo_epi16(_mm256_and_si256(y, rb_mask), b));
+
+    return _mm256_or_si256(_mm256_and_si256(ag, ag_mask),
+                           _mm256_srli_epi16(rb, 8));
+}
+
+// alpha of each pixel in the form 0x00AA00AA
+V_AVX2 static inline __m256i v8_alpha(__m256i c)
+{
+    const __m256i shuffle = _mm256_setr_epi8(
+        3, -1, 3, -1, 7, -1, 7, -1, 11, -1, 11, -1, 15, -1, 15, -1,
+        3, -1, 3, -1, 7, -1, 7, -1, 11, -1, 11, -1, 15, -1, 15, -1);
+    return _mm256_shuffle_epi8(c, shuffle);
+}
+
+// 255 - alpha of each pixel in the form 0x00AA00AA
+V_AVX2 static inline __m256i v8_ialpha(__m256i c)
+{
+    return _mm256_xor_si256(v8_alpha(c), _mm256_set1_epi32(0x00FF00FF));
+}
+
+V_AVX2 static inline __m256i v8_splat_alpha(uint32_t alpha)
+{
+    return _mm256_set1_epi32(int(alpha | (alpha << 16)));
+}
+
+V_AVX2 static inline __m256i v8_tail_mask(int length)
+{
+    return _mm256_cmpgt_epi32(_mm256_set1_epi32(length),
+                              _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+}
+
+/*
+ * runs op on every pixel of dest, op gets the dest and src vectors.
+ * src may be null for the color functions.
+ */
+template <typename Op>
+V_AVX2 static inline void v8_blend(uint32_t *dest, int length,
+                                   const uint32_t *src, Op op)
+{
+    for (; length >= 8; length -= 8, dest += 8, src += src ? 8 : 0) {
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<__m256i *>(dest));
+        __m256i s = src ? _mm256_loadu_si256(
+                              reinterpret_cast<const __m256i *>(src))
+                        : d;
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest), op(d, s));
+    }
+
+    if (length > 0) {
+        __m256i mask = v8_tail_mask(length);
+        __m256i d =
+            _mm256_maskload_epi32(reinterpret_cast<const int *>(dest), mask);
+        __m256i s = src ? _mm256_maskload_epi32(
+                              reinterpret_cast<const int *>(src), mask)
+                        : d;
+        _mm256_maskstore_epi32(reinterpret_cast<int *>(dest), mask, op(d, s));
+    }
+}
+
+// dest = color + dest * ialpha
+struct ColorOp {
+    __m256i color;
+    __m256i ialpha;
+    V_AVX2 __m256i operator()(__m256i d, __m256i) const
+    {
+        return _mm256_add_epi32(color, v8_byte_mul(d, ialpha));
+    }
+};
+
+// dest = dest * alpha
+struct DestOp {
+    __m256i alpha;
+    V_AVX2 __m256i operator()(__m256i d, __m256i) const
+    {
+        return v8_byte_mul(d, alpha);
+    }
+};
+
+V_AVX2 static void color_Source(uint32_t *dest, int length, uint32_t color,
+                                uint32_t alpha)
+{
+    if (alpha == 255) {
+        memfill32(dest, color, length);
+    } else {
+        color = BYTE_MUL(color, alpha);
+        v8_blend(dest, length, nullptr,
+                 ColorOp{_mm256_set1_epi32(int(color)),
+                         v8_splat_alpha(255 - alpha)});
+    }
+}
+
+V_AVX2 static void color_SourceOver(uint32_t *dest, int length,
+                                    uint32_t color, uint32_t alpha)
+{
+    if (alpha != 255) color = BYTE_MUL(color, alpha);
+    v8_blend(dest, length, nullptr,
+             ColorOp{_mm256_set1_epi32(int(color)),
+                     v8_splat_alpha(255 - vAlpha(color))});
+}
+
+V_AVX2 static void color_DestinationIn(uint32_t *dest, int length,
+                                       uint32_t color, uint32_t alpha)
+{
+    uint32_t a = vAlpha(color);
+    if (alpha != 255) a = BYTE_MUL(a, alpha) + 255 - alpha;
+    v8_blend(dest, length, nullptr, DestOp{v8_splat_alpha(a)});
+}
+
+V_AVX2 static void color_DestinationOut(uint32_t *dest, int length,
+                                        uint32_t color, uint32_t alpha)
+{
+    uint32_t a = vAlpha(~color);
+    if (alpha != 255) a = BYTE_MUL(a, alpha) + 255 - alpha;
+    v8_blend(dest, length, nullptr, DestOp{v8_splat_alpha(a)});
+}
+
+struct SourceOp {
+    __m256i alpha;
+    __m256i ialpha;
+    V_AVX2 __m256i operator()(__m256i d, __m256i s) const
+    {
+        return v8_interpolate(s, alpha, d, ialpha);
+    }
+};
+
+V_AVX2 static void src_Source(uint32_t *dest, int length, const uint32_t *src,
+                              uint32_t alpha)
+{
+    if (alpha == 255) {
+        memcpy(dest, src, size_t(length) * sizeof(uint32_t));
+    } else {
+        v8_blend(dest, length, src,
+                 SourceOp{v8_splat_alpha(alpha), v8_splat_alpha(255 - alpha)});
+    }
+}
+
+// transparent source pixels leave dest untouched.
+struct SourceOverOp {
+    V_AVX2 __m256i operator()(__m256i d, __m256i s) const
+    {
+        __m256i r = _mm256_add_epi32(s, v8_byte_mul(d, v8_ialpha(s)));
+        __m256i transparent = _mm256_cmpeq_epi32(s, _mm256_setzero_si256());
+        return _mm256_blendv_epi8(r, d, transparent);
+    }
+};
+
+struct SourceOverAlphaOp {
+    __m256i alpha;
+    V_AVX2 __m256i operator()(__m256i d, __m256i s) const
+    {
+        s = v8_byte_mul(s, alpha);
+        return _mm256_add_epi32(s, v8_byte_mul(d, v8_ialpha(s)));
+    }
+};
+
+V_AVX2 static void src_SourceOver(uint32_t *dest, int length,
+                                  const uint32_t *src, uint32_t alpha)
+{
+    if (alpha == 255)
+        v8_blend(dest, length, src, SourceOverOp{});
+    else
+        v8_blend(dest, length, src, SourceOverAlphaOp{v8_splat_alpha(alpha)});
+}
+
+// dest = dest * (a * alpha + 255 - alpha) with a taken from src
+template <bool Inverse>
+struct DestAlphaOp {
+    __m256i alpha;
+    __m256i ialpha;
+    V_AVX2 __m256i operator()(__m256i d, __m256i s) const
+    {
+        __m256i a = Inverse ? v8_ialpha(s) : v8_alpha(s);
+        a = _mm256_add_epi16(
+            _mm256_srli_epi16(_mm256_mullo_epi16(a, alpha), 8), ialpha);
+        return v8_byte_mul(d, a);
+    }
+};
+
+struct DestInOp {
+    V_AVX2 __m256i operator()(__m256i d, __m256i s) const
+    {
+        return v8_byte_mul(d, v8_alpha(s));
+    }
+};
+
+struct DestOutOp {
+    V_AVX2 __m256i operator()(__m256i d, __m256i s) const
+    {
+        return v8_byte_mul(d, v8_ialpha(s));
+    }
+};
+
+V_AVX2 static void src_DestinationIn(uint32_t *dest, int length,
+                                     const uint32_t *src, uint32_t alpha)
+{
+    if (alpha == 255)
+        v8_blend(dest, length, src, DestInOp{});
+    else
+        v8_blend(dest, length, src,
+                 DestAlphaOp<false>{v8_splat_alpha(alpha),
+                                    v8_splat_alpha(255 - alpha)});
+}
+
+V_AVX2 static void src_DestinationOut(uint32_t *dest, int length,
+                                      const uint32_t *src, uint32_t alpha)
+{
+    if (alpha == 255)
+        v8_blend(dest, length, src, DestOutOp{});
+    else
+        v8_blend(dest, length, src,
+                 DestAlphaOp<true>{v8_splat_alpha(alpha),
+                                   v8_splat_alpha(255 - alpha)});
+}
+
+/*
+ * Gradient span kernels. The color table lookups are done with gathers and
+ * the spread is applied with masks and min/max, which matches
+ * gradientClamp() since the table size is a power of two.
+ */
+
+static_assert((VGradient::colorTableSize & (VGradient::colorTableSize - 1)) == 0,
+              "gradient clamp needs a power of two table");
+
+struct PadClamp {
+    V_AVX2 __m256i operator()(__m256i ipos) const
+    {
+        ipos = _mm256_min_epi32(
+            ipos, _mm256_set1_epi32(VGradient::colorTableSize - 1));
+        return _mm256_max_epi32(ipos, _mm256_setzero_si256());
+    }
+};
+
+struct RepeatClamp {
+    V_AVX2 __m256i operator()(__m256i ipos) const
+    {
+        return _mm256_and_si256(
+            ipos, _mm256_set1_epi32(VGradient::colorTableSize - 1));
+    }
+};
+
+struct ReflectClamp {
+    V_AVX2 __m256i operator()(__m256i ipos) const
+    {
+        const __m256i limit = _mm256_set1_epi32(VGradient::colorTableSize * 2 - 1);
+        ipos = _mm256_and_si256(ipos, limit);
+        return _mm256_min_epi32(ipos, _mm256_sub_epi32(limit, ipos));
+    }
+};
+
+template <typename Clamp>
+V_AVX2 static void v8_gradient_linear(uint32_t *dest, int length,
+                                      const VGradientData *gradient, int pos,
+                                      int inc)
+{
+    const Clamp   clamp;
+    const int *   table = reinterpret_cast<const int *>(gradient->mColorTable);
+    const __m256i half = _mm256_set1_epi32(FIXPT_SIZE / 2);
+    const __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    // int overflow wraps the same way in the vector registers.
+    const __m256i step = _mm256_set1_epi32(int(uint32_t(inc) * 8));
+
+    __m256i vpos = _mm256_add_epi32(
+        _mm256_set1_epi32(pos),
+        _mm256_mullo_epi32(index, _mm256_set1_epi32(inc)));
+
+    for (; length >= 8; length -= 8, dest += 8) {
+        __m256i ipos =
+            _mm256_srai_epi32(_mm256_add_epi32(vpos, half), FIXPT_BITS);
+        _mm256_storeu_si256((__m256i *)dest,
+                            _mm256_i32gather_epi32(table, clamp(ipos), 4));
+        vpos = _mm256_add_epi32(vpos, step);
+    }
+
+    if (length) {
+        __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(length), index);
+        __m256i ipos =
+            _mm256_srai_epi32(_mm256_add_epi32(vpos, half), FIXPT_BITS);
+        _mm256_maskstore_epi32((int *)dest, mask,
+                               _mm256_i32gather_epi32(table, clamp(ipos), 4));
+    }
+}
+
+V_AVX2 static void gradient_Linear(uint32_t *dest, int length,
+                                   const VGradientData *gradient, int pos,
+                                   int inc)
+{
+    switch (gradient->mSpread) {
+    case VGradient::Spread::Repeat:
+        v8_gradient_linear<RepeatClamp>(dest, length, gradient, pos, inc);
+        break;
+    case VGradient::Spread::Reflect:
+        v8_gradient_linear<ReflectClamp>(dest, length, gradient, pos, inc);
+        break;
+    default:
+        v8_gradient_linear<PadClamp>(dest, length, gradient, pos, inc);
+        break;
+    }
+}
+
+/*
+ * Every lane runs its own forward difference with a stride of 8 pixels, the
+ * first 8 values are taken from the per pixel recurrence. The 8 pixel step
+ * of the determinant is 8 * delta + 28 * delta delta and grows by
+ * 64 * delta delta. The lanes round differently from the scalar loop, so a
+ * pixel can land on the neighbouring color table entry.
+ */
+template <typename Clamp>
+V_AVX2 static void v8_gradient_radial(uint32_t *dest, int length,
+                                      const VGradientData *       gradient,
+                                      const RadialGradientValues *v, float det,
+                                      float deltaDet, float deltaDeltaDet,
+                                      float b, float deltaB)
+{
+    const Clamp   clamp;
+    const int *   table = reinterpret_cast<const int *>(gradient->mColorTable);
+    const __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256  scale = _mm256_set1_ps(float(VGradient::colorTableSize - 1));
+    const __m256  half = _mm256_set1_ps(0.5f);
+    const __m256  zero = _mm256_setzero_ps();
+    const __m256  fradius = _mm256_set1_ps(gradient->radial.fradius);
+    const __m256  dr = _mm256_set1_ps(v->dr);
+
+    alignas(32) float dets[8];
+    alignas(32) float deltaDets[8];
+    alignas(32) float bs[8];
+    for (int i = 0; i < 8; ++i) {
+        dets[i] = det;
+        deltaDets[i] = 8 * deltaDet;
+        bs[i] = b;
+        det += deltaDet;
+        deltaDet += deltaDeltaDet;
+        b += deltaB;
+    }
+
+    __m256       vdet = _mm256_load_ps(dets);
+    __m256       vb = _mm256_load_ps(bs);
+    __m256       vdeltaDet = _mm256_add_ps(_mm256_load_ps(deltaDets),
+                                     _mm256_set1_ps(28 * deltaDeltaDet));
+    const __m256 vdeltaDeltaDet = _mm256_set1_ps(64 * deltaDeltaDet);
+    const __m256 vdeltaB = _mm256_set1_ps(8 * deltaB);
+
+    for (; length > 0; length -= 8, dest += 8) {
+        __m256  w = _mm256_sub_ps(_mm256_sqrt_ps(vdet), vb);
+        __m256i ipos = _mm256_cvttps_epi32(
+            _mm256_add_ps(_mm256_mul_ps(w, scale), half));
+
+        __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(length), index);
+        __m256i color;
+        if (v->extended) {
+            __m256 valid = _mm256_and_ps(
+                _mm256_cmp_ps(vdet, zero, _CMP_GE_OQ),
+                _mm256_cmp_ps(_mm256_add_ps(fradius, _mm256_mul_ps(dr, w)),
+                              zero, _CMP_GE_OQ));
+            color = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), table,
+                                                clamp(ipos),
+                                                _mm256_castps_si256(valid), 4);
+        } else {
+            color = _mm256_i32gather_epi32(table, clamp(ipos), 4);
+        }
+
+        if (length >= 8)
+            _mm256_storeu_si256((__m256i *)dest, color);
+        else
+            _mm256_maskstore_epi32((int *)dest, mask, color);
+
+        vdet = _mm256_add_ps(vdet, vdeltaDet);
+        vdeltaDet = _mm256_add_ps(vdeltaDet, vdeltaDeltaDet);
+        vb = _mm256_add_ps(vb, vdeltaB);
+    }
+}
+
+V_AVX2 static void gradient_Radial(uint32_t *dest, int length,
+                                   const VGradientData *       gradient,
+                                   const RadialGradientValues *v, float det,
+                                   float deltaDet, float deltaDeltaDet,
+                                   float b, float deltaB)
+{
+    switch (gradient->mSpread) {
+    case VGradient::Spread::Repeat:
+        v8_gradient_radial<RepeatClamp>(dest, length, gradient, v, det,
+                                        deltaDet, deltaDeltaDet, b, deltaB);
+        break;
+    case VGradient::Spread::Reflect:
+        v8_gradient_radial<ReflectClamp>(dest, length, gradient, v, det,
+                                         deltaDet, deltaDeltaDet, b, deltaB);
+        break;
+    default:
+        v8_gradient_radial<PadClamp>(dest, length, gradient, v, det, deltaDet,
+                                     deltaDeltaDet, b, deltaB);
+        break;
+    }
+}
+
+/*
+ * Image sampling kernels. Positions are stepped in 16.16 fixed point like
+ * the scalar ones and the pixels are read with gathers. The bilinear blend
+ * uses v8_interpolate() which multiplies each channel the same way
+ * interpolate_pixel() does.
+ */
+
+struct TextureSampler {
+    V_AVX2 explicit TextureSampler(const VTextureData *texture)
+        : base(reinterpret_cast<const int *>(texture->pixelRef(0, 0))),
+          stride(_mm256_set1_epi32(int(texture->bytesPerLine() / 4))),
+          left(_mm256_set1_epi32(texture->left)),
+          right(_mm256_set1_epi32(texture->right)),
+          top(_mm256_set1_epi32(texture->top)),
+          bottom(_mm256_set1_epi32(texture->bottom))
+    {
+    }
+    V_AVX2 __m256i clampX(__m256i x) const
+    {
+        return _mm256_max_epi32(left, _mm256_min_epi32(x, right));
+    }
+    V_AVX2 __m256i clampY(__m256i y) const
+    {
+        return _mm256_max_epi32(top, _mm256_min_epi32(y, bottom));
+    }
+    // px and py have to be clamped.
+    V_AVX2 __m256i pixel(__m256i px, __m256i py) const
+    {
+        return _mm256_i32gather_epi32(
+            base, _mm256_add_epi32(_mm256_mullo_epi32(py, stride), px), 4);
+    }
+
+    const int *base;
+    __m256i    stride, left, right, top, bottom;
+};
+
+struct NearestOp {
+    V_AVX2 __m256i operator()(const TextureSampler &t, __m256i x,
+                              __m256i y) const
+    {
+        return t.pixel(t.clampX(_mm256_srai_epi32(x, 16)),
+                       t.clampY(_mm256_srai_epi32(y, 16)));
+    }
+};
+
+struct BilinearOp {
+    V_AVX2 __m256i operator()(const TextureSampler &t, __m256i x,
+                              __m256i y) const
+    {
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m256i fraction = _mm256_set1_epi32(0xffff);
+
+        __m256i ix = _mm256_srai_epi32(x, 16);
+        __m256i iy = _mm256_srai_epi32(y, 16);
+        __m256i x1 = t.clampX(ix);
+        __m256i x2 = t.clampX(_mm256_add_epi32(ix, one));
+        __m256i y1 = t.clampY(iy);
+        __m256i y2 = t.clampY(_mm256_add_epi32(iy, one));
+
+        // weights in the form 0x00WW00WW, inverse weights are 256 - w.
+        __m256i distx = _mm256_srli_epi32(_mm256_and_si256(x, fraction), 8);
+        __m256i disty = _mm256_srli_epi32(_mm256_and_si256(y, fraction), 8);
+        distx = _mm256_or_si256(distx, _mm256_slli_epi32(distx, 16));
+        disty = _mm256_or_si256(disty, _mm256_slli_epi32(disty, 16));
+        const __m256i full = _mm256_set1_epi32(0x01000100);
+        __m256i idistx = _mm256_sub_epi16(full, distx);
+        __m256i idisty = _mm256_sub_epi16(full, disty);
+
+        __m256i top = v8_interpolate(t.pixel(x1, y1), idistx, t.pixel(x2, y1),
+                                     distx);
+        __m256i bottom = v8_interpolate(t.pixel(x1, y2), idistx,
+                                        t.pixel(x2, y2), distx);
+        return v8_interpolate(top, idisty, bottom, disty);
+    }
+};
+
+template <typename Op>
+V_AVX2 static void v8_image(uint32_t *dest, int length,
+                            const VTextureData *texture, int x, int y, int dx,
+                            int dy, Op op)
+{
+    const TextureSampler sampler(texture);
+    const __m256i        index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i        stepx = _mm256_set1_epi32(int(uint32_t(dx) * 8));
+    const __m256i        stepy = _mm256_set1_epi32(int(uint32_t(dy) * 8));
+
+    __m256i vx = _mm256_add_epi32(
+        _mm256_set1_epi32(x), _mm256_mullo_epi32(index, _mm256_set1_epi32(dx)));
+    __m256i vy = _mm256_add_epi32(
+        _mm256_set1_epi32(y), _mm256_mullo_epi32(index, _mm256_set1_epi32(dy)));
+
+    for (; length >= 8; length -= 8, dest += 8) {
+        _mm256_storeu_si256((__m256i *)dest, op(sampler, vx, vy));
+        vx = _mm256_add_epi32(vx, stepx);
+        vy = _mm256_add_epi32(vy, stepy);
+    }
+
+    if (length) {
+        __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(length), index);
+        _mm256_maskstore_epi32((int *)dest, mask, op(sampler, vx, vy));
+    }
+}
+
+V_AVX2 static void image_Nearest(uint32_t *dest, int length,
+                                 const VTextureData *texture, int x, int y,
+                                 int dx, int dy)
+{
+    v8_image(dest, length, texture, x, y, dx, dy, NearestOp{});
+}
+
+V_AVX2 static void image_Bilinear(uint32_t *dest, int length,
+                                  const VTextureData *texture, int x, int y,
+                                  int dx, int dy)
+{
+    v8_image(dest, length, texture, x, y, dx, dy, BilinearOp{});
+}
+
+/*
+ * same lane layout as v2_premultiply_sse2(), 4 pixels per call.
+ */
+V_AVX2 static inline __m256i v4_premultiply(__m256i c)
+{
+    const __m256i alpha_mask =
+        _mm256_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0);
+    const __m256i alpha_one = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0,
+                                               255, 0, 0, 0, 255, 0, 0, 0);
+
+    __m256i a = _mm256_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 3, 3));
+    a = _mm256_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+    a = _mm256_or_si256(_mm256_andnot_si256(alpha_mask, a), alpha_one);
+
+    c = _mm256_shufflelo_epi16(c, _MM_SHUFFLE(3, 0, 1, 2));
+    c = _mm256_shufflehi_epi16(c, _MM_SHUFFLE(3, 0, 1, 2));
+    c = _mm256_add_epi16(_mm256_mullo_epi16(c, a), _mm256_set1_epi16(1));
+    return _mm256_mulhi_epu16(c, _mm256_set1_epi16(257));
+}
+
+V_AVX2 static inline __m256i v8_premultiply(__m256i c)
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    // unpack and pack stay within 128 bit lanes, the pixel order is kept.
+    return _mm256_packus_epi16(v4_premultiply(_mm256_unpacklo_epi8(c, zero)),
+                               v4_premultiply(_mm256_unpackhi_epi8(c, zero)));
+}
+
+V_AVX2 static void image_Premultiply(uint32_t *dest, const uint8_t *src,
+                                     int length)
+{
+    for (; length >= 8; length -= 8, src += 32, dest += 8) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)src);
+        _mm256_storeu_si256((__m256i *)dest, v8_premultiply(c));
+    }
+    if (length) {
+        __m256i mask = v8_tail_mask(length);
+        __m256i c = _mm256_maskload_epi32((const int *)src, mask);
+        _mm256_maskstore_epi32((int *)dest, mask, v8_premultiply(c));
+    }
+}
+
+void RenderFuncTable::avx2()
+{
+    updateColor(BlendMode::Src, color_Source);
+    updateColor(BlendMode::SrcOver, color_SourceOver);
+    updateColor(BlendMode::DestIn, color_DestinationIn);
+    updateColor(BlendMode::DestOut, color_DestinationOut);
+
+    updateSrc(BlendMode::Src, src_Source);
+    updateSrc(BlendMode::SrcOver, src_SourceOver);
+    updateSrc(BlendMode::DestIn, src_DestinationIn);
+    updateSrc(BlendMode::DestOut, src_DestinationOut);
+
+    mLinearGradient = gradient_Linear;
+    mRadialGradient = gradient_Radial;
+    mNearestImage = image_Nearest;
+    mBilinearImage = image_Bilinear;
+    mPremultiplyImage = image_Premultiply;
+}
+
+#endif
@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) 2020 Samsung Electronics Co., Ltd. All rights reserved.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "vdrawhelper.h"
+
+#if defined(LOTTIE_AVX_SUPPORT)
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cstring>
+
+// GCC 12 takes the undefined pass-through register of some unmasked
+// intrinsics (sqrt, cvtt, min) for an uninitialized read.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+/*
+ * 16 pixels at a time versions of the blend functions, same arithmetic as
+ * vdrawhelper_avx2.cpp. The tail of a span uses the AVX-512 mask registers.
+ */
+
+#define V_AVX512 __attribute__((target("avx512f,avx512bw")))
+
+// alpha has to be in the form 0x00AA00AA in each pixel.
+V_AVX512 static inline __m512i v16_byte_mul(__m512i c, __m512i a)
+{
+    const __m512i rb_mask = _mm512_set1_epi32(0x00FF00FF);
+    const __m512i ag_mask = _mm512_set1_epi32(int(0xFF00FF00));
+
+    __m512i ag = _mm512_mullo_epi16(_mm512_srli_epi16(c, 8), a);
+    __m512i rb = _mm512_mullo_epi16(_mm512_and_si512(c, rb_mask), a);
+
+    return _mm512_or_si512(_mm512_and_si512(ag, ag_mask),
+                           _mm512_srli_epi16(rb, 8));
+}
+
+// x * a + y * b, same as interpolate_pixel()
+V_AVX512 static inline __m512i v16_interpolate(__m512i x, __m512i a,
+                                               __m512i y, __m512i b)
+{
+    const __m512i rb_mask = _mm512_set1_epi32(0x00FF00FF);
+    const __m512i ag_mask = _mm512_set1_epi32(int(0xFF00FF00));
+
+    __m512i ag = _mm512_add_epi16(
+        _mm512_mullo_epi16(_mm512_srli_epi16(x, 8), a),
+        _mm512_mullo_epi16(_mm512_srli_epi16(y, 8), b));
+    __m512i rb = _mm512_add_epi16(
+        _mm512_mullo_epi16(_mm512_and_si512(x, rb_mask), a),
+        _mm512_mullo_epi16(_mm512_and_si512(y, rb_mask), b));
+
+    return _mm512_or_si512(_mm512_and_si512(ag, ag_mask),
+                           _mm512_srli_epi16(rb, 8));
+}
+
+// alpha of each pixel in the form 0x00AA00AA
+V_AVX512 static inline __m512i v16_alpha(__m512i c)
+{
+    // byte 3, 7, 11 and 15 of each 128 bit lane into both 16 bit halves
+    const __m512i shuffle =
+        _mm512_set4_epi32(int(0xFF0FFF0F), int(0xFF0BFF0B), int(0xFF07FF07),
+                          int(0xFF03FF03));
+    return _mm512_shuffle_epi8(c, shuffle);
+}
+
+// 255 - alpha of each pixel in the form 0x00AA00AA
+V_AVX512 static inline __m512i v16_ialpha(__m512i c)
+{
+    return _mm512_xor_si512(v16_alpha(c), _mm512_set1_epi32(0x00FF00FF));
+}
+
+V_AVX512 static inline __m512i v16_splat_alpha(uint32_t alpha)
+{
+    return _mm512_set1_epi32(int(alpha | (alpha << 16)));
+}
+
+/*
+ * runs op on every pixel of dest, op gets the dest and src vectors.
+ * src may be null for the color functions.
+ */
+template <typename Op>
+V_AVX512 static inline void v16_blend(uint32_t *dest, int length,
+                                      const uint32_t *src, Op op)
+{
+    for (; length >= 16; length -= 16, dest += 16, src += src ? 16 : 0) {
+        __m512i d = _mm512_loadu_si512(dest);
+        __m512i s = src ? _mm512_loadu_si512(src) : d;
+        _mm512_storeu_si512(dest, op(d, s));
+    }
+
+    if (length > 0) {
+        __mmask16 mask = __mmask16((1u << length) - 1);
+        __m512i   d = _mm512_maskz_loadu_epi32(mask, dest);
+        __m512i   s = src ? _mm512_maskz_loadu_epi32(mask, src) : d;
+        _mm512_mask_storeu_epi32(dest, mask, op(d, s));
+    }
+}
+
+// dest = color + dest * ialpha
+struct ColorOp {
+    __m512i color;
+    __m512i ialpha;
+    V_AVX512 __m512i operator()(__m512i d, __m512i) const
+    {
+        return _mm512_add_epi32(color, v16_byte_mul(d, ialpha));
+    }
+};
+
+// dest = dest * alpha
+struct DestOp {
+    __m512i alpha;
+    V_AVX512 __m512i operator()(__m512i d, __m512i) const
+    {
+        return v16_byte_mul(d, alpha);
+    }
+};
+
+V_AVX512 static void color_Source(uint32_t *dest, int length, uint32_t color,
+                                  uint32_t alpha)
+{
+    if (alpha == 255) {
+        memfill32(dest, color, length);
+    } else {
+        color = BYTE_MUL(color, alpha);
+        v16_blend(dest, length, nullptr,
+                  ColorOp{_mm512_set1_epi32(int(color)),
+                          v16_splat_alpha(255 - alpha)});
+    }
+}
+
+V_AVX512 static void color_SourceOver(uint32_t *dest, int length,
+                                      uint32_t color, uint32_t alpha)
+{
+    if (alpha != 255) color = BYTE_MUL(color, alpha);
+    v16_blend(dest, length, nullptr,
+              ColorOp{_mm512_set1_epi32(int(color)),
+                      v16_splat_alpha(255 - vAlpha(color))});
+}
+
+V_AVX512 static void color_DestinationIn(uint32_t *dest, int length,
+                                         uint32_t color, uint32_t alpha)
+{
+    uint32_t a = vAlpha(color);
+    if (alpha != 255) a = BYTE_MUL(a, alpha) + 255 - alpha;
+    v16_blend(dest, length, nullptr, DestOp{v16_splat_alpha(a)});
+}
+
+V_AVX512 static void color_DestinationOut(uint32_t *dest, int length,
+                                          uint32_t color, uint32_t alpha)
+{
+    uint32_t a = vAlpha(~color);
+    if (alpha != 255) a = BYTE_MUL(a, alpha) + 255 - alpha;
+    v16_blend(dest, length, nullptr, DestOp{v16_splat_alpha(a)});
+}
+
+struct SourceOp {
+    __m512i alpha;
+    __m512i ialpha;
+    V_AVX512 __m512i operator()(__m512i d, __m512i s) const
+    {
+        return v16_interpolate(s, alpha, d, ialpha);
+    }
+};
+
+V_AVX512 static void src_Source(uint32_t *dest, int length,
+                                const uint32_t *src, uint32_t alpha)
+{
+    if (alpha == 255) {
+        memcpy(dest, src, size_t(length) * sizeof(uint32_t));
+    } else {
+        v16_blend(dest, length, src,
+                  SourceOp{v16_splat_alpha(alpha),
+                           v16_splat_alpha(255 - alpha)});
+    }
+}
+
+// transparent source pixels leave dest untouched.
+struct SourceOverOp {
+    V_AVX512 __m512i operator()(__m512i d, __m512i s) const
+    {
+        __m512i   r = _mm512_add_epi32(s, v16_byte_mul(d, v16_ialpha(s)));
+        __mmask16 transparent =
+            _mm512_cmpeq_epi32_mask(s, _mm512_setzero_si512());
+        return _mm512_mask_blend_epi32(transparent, r, d);
+    }
+};
+
+struct SourceOverAlphaOp {
+    __m512i alpha;
+    V_AVX512 __m512i operator()(__m512i d, __m512i s) const
+    {
+        s = v16_byte_mul(s, alpha);
+        return _mm512_add_epi32(s, v16_byte_mul(d, v16_ialpha(s)));
+    }
+};
+
+V_AVX512 static void src_SourceOver(uint32_t *dest, int length,
+                                    const uint32_t *src, uint32_t alpha)
+{
+    if (alpha == 255)
+        v16_blend(dest, length, src, SourceOverOp{});
+    else
+        v16_blend(dest, length, src,
+                  SourceOverAlphaOp{v16_splat_alpha(alpha)});
+}
+
+// dest = dest * (a * alpha + 255 - alpha) with a taken from src
+template <bool Inverse>
+struct DestAlphaOp {
+    __m512i alpha;
+    __m512i ialpha;
+    V_AVX512 __m512i operator()(__m512i d, __m512i s) const
+    {
+        __m512i a = Inverse ? v16_ialpha(s) : v16_alpha(s);
+        a = _mm512_add_epi16(
+            _mm512_srli_epi16(_mm512_mullo_epi16(a, alpha), 8), ialpha);
+        return v16_byte_mul(d, a);
+    }
+};
+
+struct DestInOp {
+    V_AVX512 __m512i operator()(__m512i d, __m512i s) const
+    {
+        return v16_byte_mul(d, v16_alpha(s));
+    }
+};
+
+struct DestOutOp {
+    V_AVX512 __m512i operator()(__m512i d, __m512i s) const
+    {
+        return v16_byte_mul(d, v16_ialpha(s));
+    }
+};
+
+V_AVX512 static void src_DestinationIn(uint32_t *dest, int length,
+                                       const uint32_t *src, uint32_t alpha)
+{
+    if (alpha == 255)
+        v16_blend(dest, length, src, DestInOp{});
+    else
+        v16_blend(dest, length, src,
+                  DestAlphaOp<false>{v16_splat_alpha(alpha),
+                                     v16_splat_alpha(255 - alpha)});
+}
+
+V_AVX512 static void src_DestinationOut(uint32_t *dest, int length,
+                                        const uint32_t *src, uint32_t alpha)
+{
+    if (alpha == 255)
+        v16_blend(dest, length, src, DestOutOp{});
+    else
+        v16_blend(dest, length, src,
+                  DestAlphaOp<true>{v16_splat_alpha(alpha),
+                                    v16_splat_alpha(255 - alpha)});
+}
+
+/*
+ * Gradient span kernels, see vdrawhelper_avx2.cpp.
+ */
+
+struct PadClamp {
+    V_AVX512 __m512i operator()(__m512i ipos) const
+    {
+        ipos = _mm512_min_epi32(
+            ipos, _mm512_set1_epi32(VGradient::colorTableSize - 1));
+        return _mm512_max_epi32(ipos, _mm512_setzero_si512());
+    }
+};
+
+struct RepeatClamp {
+    V_AVX512 __m512i operator()(__m512i ipos) const
+    {
+        return _mm512_and_si512(
+            ipos, _mm512_set1_epi32(VGradient::colorTableSize - 1));
+    }
+};
+
+struct ReflectClamp {
+    V_AVX512 __m512i operator()(__m512i ipos) const
+    {
+        const __m512i limit = _mm512_set1_epi32(VGradient::colorTableSize * 2 - 1);
+        ipos = _mm512_and_si512(ipos, limit);
+        return _mm512_min_epi32(ipos, _mm512_sub_epi32(limit, ipos));
+    }
+};
+
+template <typename Clamp>
+V_AVX512 static void v16_gradient_linear(uint32_t *dest, int length,
+                                         const VGradientData *gradient,
+                                         int pos, int inc)
+{
+    const Clamp   clamp;
+    const int *   table = reinterpret_cast<const int *>(gradient->mColorTable);
+    const __m512i half = _mm512_set1_epi32(FIXPT_SIZE / 2);
+    const __m512i step = _mm512_set1_epi32(int(uint32_t(inc) * 16));
+
+    __m512i vpos = _mm512_add_epi32(
+        _mm512_set1_epi32(pos),
+        _mm512_mullo_epi32(
+            _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13,
+                              14, 15),
+            _mm512_set1_epi32(inc)));
+
+    for (; length >= 16; length -= 16, dest += 16) {
+        __m512i ipos =
+            _mm512_srai_epi32(_mm512_add_epi32(vpos, half), FIXPT_BITS);
+        _mm512_storeu_si512(dest,
+                            _mm512_i32gather_epi32(clamp(ipos), table, 4));
+        vpos = _mm512_add_epi32(vpos, step);
+    }
+
+    if (length) {
+        __mmask16 mask = __mmask16((1u << length) - 1);
+        __m512i   ipos =
+            _mm512_srai_epi32(_mm512_add_epi32(vpos, half), FIXPT_BITS);
+        _mm512_mask_storeu_epi32(
+            dest, mask,
+            _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), mask,
+                                        clamp(ipos), table, 4));
+    }
+}
+
+V_AVX512 static void gradient_Linear(uint32_t *dest, int length,
+                                     const VGradientData *gradient, int pos,
+                                     int inc)
+{
+    switch (gradient->mSpread) {
+    case VGradient::Spread::Repeat:
+        v16_gradient_linear<RepeatClamp>(dest, length, gradient, pos, inc);
+        break;
+    case VGradient::Spread::Reflect:
+        v16_gradient_linear<ReflectClamp>(dest, length, gradient, pos, inc);
+        break;
+    default:
+        v16_gradient_linear<PadClamp>(dest, length, gradient, pos, inc);
+        break;
+    }
+}
+
+// 16 pixel stride: 16 * delta + 120 * delta delta, growing by 256 * delta delta.
+template <typename Clamp>
+V_AVX512 static void v16_gradient_radial(uint32_t *dest, int length,
+                                         const VGradientData *       gradient,
+                                         const RadialGradientValues *v,
+                                         float det, float deltaDet,
+                                         float deltaDeltaDet, float b,
+                                         float deltaB)
+{
+    const Clamp   clamp;
+    const int *   table = reinterpret_cast<const int *>(gradient->mColorTable);
+    const __m512  scale = _mm512_set1_ps(float(VGradient::colorTableSize - 1));
+    const __m512  half = _mm512_set1_ps(0.5f);
+    const __m512  zero = _mm512_setzero_ps();
+    const __m512  fradius = _mm512_set1_ps(gradient->radial.fradius);
+    const __m512  dr = _mm512_set1_ps(v->dr);
+
+    alignas(64) float dets[16];
+    alignas(64) float deltaDets[16];
+    alignas(64) float bs[16];
+    for (int i = 0; i < 16; ++i) {
+        dets[i] = det;
+        deltaDets[i] = 16 * deltaDet;
+        bs[i] = b;
+        det += deltaDet;
+        deltaDet += deltaDeltaDet;
+        b += deltaB;
+    }
+
+    __m512       vdet = _mm512_load_ps(dets);
+    __m512       vb = _mm512_load_ps(bs);
+    __m512       vdeltaDet = _mm512_add_ps(_mm512_load_ps(deltaDets),
+                                     _mm512_set1_ps(120 * deltaDeltaDet));
+    const __m512 vdeltaDeltaDet = _mm512_set1_ps(256 * deltaDeltaDet);
+    const __m512 vdeltaB = _mm512_set1_ps(16 * deltaB);
+
+    for (; length > 0; length -= 16, dest += 16) {
+        __m512    w = _mm512_sub_ps(_mm512_sqrt_ps(vdet), vb);
+        __m512i   ipos = _mm512_cvttps_epi32(
+            _mm512_add_ps(_mm512_mul_ps(w, scale), half));
+        __mmask16 store =
+            length >= 16 ? __mmask16(0xffff) : __mmask16((1u << length) - 1);
+        __mmask16 mask = store;
+
+        if (v->extended) {
+            mask &= _mm512_cmp_ps_mask(vdet, zero, _CMP_GE_OQ);
+            mask &= _mm512_cmp_ps_mask(
+                _mm512_add_ps(fradius, _mm512_mul_ps(dr, w)), zero,
+                _CMP_GE_OQ);
+        }
+
+        __m512i color = _mm512_mask_i32gather_epi32(
+            _mm512_setzero_si512(), mask, clamp(ipos), table, 4);
+        _mm512_mask_storeu_epi32(dest, store, color);
+
+        vdet = _mm512_add_ps(vdet, vdeltaDet);
+        vdeltaDet = _mm512_add_ps(vdeltaDet, vdeltaDeltaDet);
+        vb = _mm512_add_ps(vb, vdeltaB);
+    }
+}
+
+V_AVX512 static void gradient_Radial(uint32_t *dest, int length,
+                                     const VGradientData *       gradient,
+                                     const RadialGradientValues *v, float det,
+                                     float deltaDet, float deltaDeltaDet,
+                                     float b, float deltaB)
+{
+    switch (gradient->mSpread) {
+    case VGradient::Spread::Repeat:
+        v16_gradient_radial<RepeatClamp>(dest, length, gradient, v, det,
+                                         deltaDet, deltaDeltaDet, b, deltaB);
+        break;
+    case VGradient::Spread::Reflect:
+        v16_gradient_radial<ReflectClamp>(dest, length, gradient, v, det,
+                                          deltaDet, deltaDeltaDet, b, deltaB);
+        break;
+    default:
+        v16_gradient_radial<PadClamp>(dest, length, gradient, v, det,
+                                      deltaDet, deltaDeltaDet, b, deltaB);
+        break;
+    }
+}
+
+void RenderFuncTable::avx512()
+{
+    updateColor(BlendMode::Src, color_Source);
+    updateColor(BlendMode::SrcOver, color_SourceOver);
+    updateColor(BlendMode::DestIn, color_DestinationIn);
+    updateColor(BlendMode::DestOut, color_DestinationOut);
+
+    updateSrc(BlendMode::Src, src_Source);
+    updateSrc(BlendMode::SrcOver, src_SourceOver);
+    updateSrc(BlendMode::DestIn, src_DestinationIn);
+    updateSrc(BlendMode::DestOut, src_DestinationOut);
+
+    mLinearGradient = gradient_Linear;
+    mRadialGradient = gradient_Radial;
+}
+
+#endif
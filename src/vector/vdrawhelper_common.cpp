@@ -20,6 +20,8 @@
  * SOFTWARE.
  */
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 #include "vdrawhelper.h"
 
@@ -168,8 +170,130 @@ static void src_DestinationOut(uint32_t *dest, int length, const uint32_t *src,
     }
 }
 
-RenderFuncTable::RenderFuncTable()
+static void gradient_Linear(uint32_t *dest, int length,
+                            const VGradientData *gradient, int pos, int inc)
 {
+    for (int i = 0; i < length; ++i) {
+        dest[i] = gradientPixelFixed(gradient, pos);
+        pos += inc;
+    }
+}
+
+static void gradient_Radial(uint32_t *dest, int length,
+                            const VGradientData *       gradient,
+                            const RadialGradientValues *v, float det,
+                            float deltaDet, float deltaDeltaDet, float b,
+                            float deltaB)
+{
+    if (v->extended) {
+        for (int i = 0; i < length; ++i) {
+            uint32_t result = 0;
+            if (det >= 0) {
+                float w = std::sqrt(det) - b;
+                if (gradient->radial.fradius + v->dr * w >= 0)
+                    result = gradientPixel(gradient, w);
+            }
+
+            dest[i] = result;
+
+            det += deltaDet;
+            deltaDet += deltaDeltaDet;
+            b += deltaB;
+        }
+    } else {
+        for (int i = 0; i < length; ++i) {
+            dest[i] = gradientPixel(gradient, std::sqrt(det) - b);
+
+            det += deltaDet;
+            deltaDet += deltaDeltaDet;
+            b += deltaB;
+        }
+    }
+}
+
+static inline int clampTo(int v, int lo, int hi)
+{
+    return std::max(lo, std::min(v, hi));
+}
+
+static void image_Nearest(uint32_t *dest, int length,
+                          const VTextureData *texture, int x, int y, int dx,
+                          int dy)
+{
+    for (int i = 0; i < length; ++i) {
+        int px = clampTo(x >> 16, texture->left, texture->right);
+        int py = clampTo(y >> 16, texture->top, texture->bottom);
+        dest[i] = texture->pixel(px, py);
+        x += dx;
+        y += dy;
+    }
+}
+
+/*
+ * weights are the top 8 bits of the fraction, the 4 neighbours are
+ * blended with interpolate_pixel() first along x then along y.
+ */
+static void image_Bilinear(uint32_t *dest, int length,
+                           const VTextureData *texture, int x, int y, int dx,
+                           int dy)
+{
+    for (int i = 0; i < length; ++i) {
+        int x1 = clampTo(x >> 16, texture->left, texture->right);
+        int x2 = clampTo((x >> 16) + 1, texture->left, texture->right);
+        int y1 = clampTo(y >> 16, texture->top, texture->bottom);
+        int y2 = clampTo((y >> 16) + 1, texture->top, texture->bottom);
+
+        uint32_t distx = uint32_t(x & 0xffff) >> 8;
+        uint32_t disty = uint32_t(y & 0xffff) >> 8;
+
+        uint32_t top = interpolate_pixel(texture->pixel(x1, y1), 256 - distx,
+                                         texture->pixel(x2, y1), distx);
+        uint32_t bottom = interpolate_pixel(texture->pixel(x1, y2),
+                                            256 - distx,
+                                            texture->pixel(x2, y2), distx);
+        dest[i] = interpolate_pixel(top, 256 - disty, bottom, disty);
+        x += dx;
+        y += dy;
+    }
+}
+
+static void image_Premultiply(uint32_t *dest, const uint8_t *src, int length)
+{
+    for (int i = 0; i < length; ++i, src += 4) dest[i] = premultiply_pixel(src);
+}
+
+#if !defined(__SSE2__) && !defined(__ARM_NEON__)
+void memfill32(uint32_t *dest, uint32_t value, int length)
+{
+    // let compiler do the auto vectorization.
+    for (int i = 0 ; i < length; i++) {
+        *dest++ = value;
+    }
+}
+#endif
+
+RenderFuncTable::Simd RenderFuncTable::supportedSimd()
+{
+#if defined(LOTTIE_AVX_SUPPORT)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        return Simd::Avx512;
+    if (__builtin_cpu_supports("avx2")) return Simd::Avx2;
+    if (__builtin_cpu_supports("sse4.1")) return Simd::Sse4;
+#endif
+#if defined(__SSE2__)
+    return Simd::Sse2;
+#elif defined(__ARM_NEON__)
+    return Simd::Neon;
+#else
+    return Simd::None;
+#endif
+}
+
+RenderFuncTable::RenderFuncTable(Simd simd)
+{
+    simd = std::min(simd, supportedSimd());
+
     updateColor(BlendMode::Src, color_Source);
     updateColor(BlendMode::SrcOver, color_SourceOver);
     updateColor(BlendMode::DestIn, color_DestinationIn);
@@ -180,10 +304,21 @@ RenderFuncTable::RenderFuncTable()
     updateSrc(BlendMode::DestIn, src_DestinationIn);
     updateSrc(BlendMode::DestOut, src_DestinationOut);
 
+    mLinearGradient = gradient_Linear;
+    mRadialGradient = gradient_Radial;
+    mNearestImage = image_Nearest;
+    mBilinearImage = image_Bilinear;
+    mPremultiplyImage = image_Premultiply;
+
 #if defined(__ARM_NEON__)
-    neon();
+    if (simd == Simd::Neon) neon();
 #endif
 #if defined(__SSE2__)
-    sse();
+    if (simd >= Simd::Sse2) sse();
+#endif
+#if defined(LOTTIE_AVX_SUPPORT)
+    if (simd >= Simd::Sse4) sse4();
+    if (simd >= Simd::Avx2) avx2();
+    if (simd >= Simd::Avx512) avx512();
 #endif
 }
@@ -1,5 +1,6 @@
 #if defined(__ARM_NEON__)
 
+#include <arm_neon.h>
 #include "vdrawhelper.h"
 
 extern "C" void pixman_composite_src_n_8888_asm_neon(int32_t w, int32_t h,
@@ -26,8 +27,222 @@ static void color_SourceOver(uint32_t *dest, int length,
     pixman_composite_over_n_8888_asm_neon(length, 1, dest, length, color);
 }
 
+// x / 255 rounded down, see div255().
+static inline uint8x8_t v8_div255_neon(uint16x8_t x)
+{
+    return vshrn_n_u16(vaddq_u16(vsraq_n_u16(x, x, 8), vdupq_n_u16(1)), 8);
+}
+
+static inline uint8x16_t v16_byte_mul_neon(uint8x16_t c, uint8x16_t a)
+{
+    return vcombine_u8(
+        v8_div255_neon(vmull_u8(vget_low_u8(c), vget_low_u8(a))),
+        v8_div255_neon(vmull_u8(vget_high_u8(c), vget_high_u8(a))));
+}
+
+static void image_Premultiply(uint32_t *dest, const uint8_t *src, int length)
+{
+    for (; length >= 16; length -= 16, src += 64, dest += 16) {
+        uint8x16x4_t rgba = vld4q_u8(src);
+        uint8x16x4_t bgra;
+        bgra.val[0] = v16_byte_mul_neon(rgba.val[2], rgba.val[3]);
+        bgra.val[1] = v16_byte_mul_neon(rgba.val[1], rgba.val[3]);
+        bgra.val[2] = v16_byte_mul_neon(rgba.val[0], rgba.val[3]);
+        bgra.val[3] = rgba.val[3];
+        vst4q_u8(reinterpret_cast<uint8_t *>(dest), bgra);
+    }
+    for (int i = 0; i < length; ++i, src += 4) dest[i] = premultiply_pixel(src);
+}
+
+/*
+ * 4 pixels at a time gradient span kernels. The spread is applied with
+ * masks and min/max like in vdrawhelper_avx2.cpp, the 4 colors are read
+ * from the table one by one.
+ */
+
+static_assert((VGradient::colorTableSize & (VGradient::colorTableSize - 1)) == 0,
+              "gradient clamp needs a power of two table");
+
+struct PadClamp {
+    int32x4_t operator()(int32x4_t ipos) const
+    {
+        ipos = vminq_s32(ipos, vdupq_n_s32(VGradient::colorTableSize - 1));
+        return vmaxq_s32(ipos, vdupq_n_s32(0));
+    }
+};
+
+struct RepeatClamp {
+    int32x4_t operator()(int32x4_t ipos) const
+    {
+        return vandq_s32(ipos, vdupq_n_s32(VGradient::colorTableSize - 1));
+    }
+};
+
+struct ReflectClamp {
+    int32x4_t operator()(int32x4_t ipos) const
+    {
+        const int32x4_t limit = vdupq_n_s32(VGradient::colorTableSize * 2 - 1);
+        ipos = vandq_s32(ipos, limit);
+        return vminq_s32(ipos, vsubq_s32(limit, ipos));
+    }
+};
+
+// writes the colors of the first min(length, 4) indices to dest.
+static inline void v4_lookup_store(uint32_t *dest, const uint32_t *table,
+                                   int32x4_t index, int length)
+{
+    int32_t i[4];
+    vst1q_s32(i, index);
+    if (length >= 4) {
+        uint32x4_t color = {table[i[0]], table[i[1]], table[i[2]],
+                            table[i[3]]};
+        vst1q_u32(dest, color);
+    } else {
+        for (int n = 0; n < length; ++n) dest[n] = table[i[n]];
+    }
+}
+
+template <typename Clamp>
+static void v4_gradient_linear(uint32_t *dest, int length,
+                               const VGradientData *gradient, int pos, int inc)
+{
+    const Clamp     clamp;
+    const int32x4_t index = {0, 1, 2, 3};
+    // int overflow wraps the same way in the vector registers.
+    const int32x4_t step = vdupq_n_s32(int(uint32_t(inc) * 4));
+
+    int32x4_t vpos = vmlaq_n_s32(vdupq_n_s32(pos), index, inc);
+
+    for (; length > 0; length -= 4, dest += 4) {
+        int32x4_t ipos = vshrq_n_s32(
+            vaddq_s32(vpos, vdupq_n_s32(FIXPT_SIZE / 2)), FIXPT_BITS);
+        v4_lookup_store(dest, gradient->mColorTable, clamp(ipos), length);
+        vpos = vaddq_s32(vpos, step);
+    }
+}
+
+static void gradient_Linear(uint32_t *dest, int length,
+                            const VGradientData *gradient, int pos, int inc)
+{
+    switch (gradient->mSpread) {
+    case VGradient::Spread::Repeat:
+        v4_gradient_linear<RepeatClamp>(dest, length, gradient, pos, inc);
+        break;
+    case VGradient::Spread::Reflect:
+        v4_gradient_linear<ReflectClamp>(dest, length, gradient, pos, inc);
+        break;
+    default:
+        v4_gradient_linear<PadClamp>(dest, length, gradient, pos, inc);
+        break;
+    }
+}
+
+static inline float32x4_t v4_sqrt(float32x4_t x)
+{
+#if defined(__aarch64__)
+    return vsqrtq_f32(x);
+#else
+    // two newton steps bring the estimate close to float precision. the
+    // estimate of 0 is infinity, which would turn the result into a nan.
+    float32x4_t r = vrsqrteq_f32(x);
+    r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(x, r), r));
+    r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(x, r), r));
+    return vbslq_f32(vceqq_f32(x, vdupq_n_f32(0)), x, vmulq_f32(x, r));
+#endif
+}
+
+/*
+ * Every lane runs its own forward difference with a stride of 4 pixels,
+ * see v8_gradient_radial() in vdrawhelper_avx2.cpp. The 4 pixel step of the
+ * determinant is 4 * delta + 6 * delta delta and grows by
+ * 16 * delta delta.
+ */
+template <typename Clamp>
+static void v4_gradient_radial(uint32_t *dest, int length,
+                               const VGradientData *       gradient,
+                               const RadialGradientValues *v, float det,
+                               float deltaDet, float deltaDeltaDet, float b,
+                               float deltaB)
+{
+    const Clamp       clamp;
+    const float32x4_t zero = vdupq_n_f32(0);
+    const float32x4_t fradius = vdupq_n_f32(gradient->radial.fradius);
+
+    float dets[4];
+    float deltaDets[4];
+    float bs[4];
+    for (int i = 0; i < 4; ++i) {
+        dets[i] = det;
+        deltaDets[i] = 4 * deltaDet + 6 * deltaDeltaDet;
+        bs[i] = b;
+        det += deltaDet;
+        deltaDet += deltaDeltaDet;
+        b += deltaB;
+    }
+
+    float32x4_t       vdet = vld1q_f32(dets);
+    float32x4_t       vb = vld1q_f32(bs);
+    float32x4_t       vdeltaDet = vld1q_f32(deltaDets);
+    const float32x4_t vdeltaDeltaDet = vdupq_n_f32(16 * deltaDeltaDet);
+    const float32x4_t vdeltaB = vdupq_n_f32(4 * deltaB);
+
+    for (; length > 0; length -= 4, dest += 4) {
+        float32x4_t w = vsubq_f32(v4_sqrt(vdet), vb);
+        int32x4_t   ipos = vcvtq_s32_f32(vaddq_f32(
+            vmulq_n_f32(w, float(VGradient::colorTableSize - 1)),
+            vdupq_n_f32(0.5f)));
+        uint32_t colors[4];
+        v4_lookup_store(colors, gradient->mColorTable, clamp(ipos), 4);
+        uint32x4_t color = vld1q_u32(colors);
+
+        if (v->extended) {
+            uint32x4_t valid =
+                vandq_u32(vcgeq_f32(vdet, zero),
+                          vcgeq_f32(vmlaq_n_f32(fradius, w, v->dr), zero));
+            color = vandq_u32(color, valid);
+        }
+
+        if (length >= 4) {
+            vst1q_u32(dest, color);
+        } else {
+            vst1q_u32(colors, color);
+            for (int n = 0; n < length; ++n) dest[n] = colors[n];
+        }
+
+        vdet = vaddq_f32(vdet, vdeltaDet);
+        vdeltaDet = vaddq_f32(vdeltaDet, vdeltaDeltaDet);
+        vb = vaddq_f32(vb, vdeltaB);
+    }
+}
+
+static void gradient_Radial(uint32_t *dest, int length,
+                            const VGradientData *       gradient,
+                            const RadialGradientValues *v, float det,
+                            float deltaDet, float deltaDeltaDet, float b,
+                            float deltaB)
+{
+    switch (gradient->mSpread) {
+    case VGradient::Spread::Repeat:
+        v4_gradient_radial<RepeatClamp>(dest, length, gradient, v, det,
+                                        deltaDet, deltaDeltaDet, b, deltaB);
+        break;
+    case VGradient::Spread::Reflect:
+        v4_gradient_radial<ReflectClamp>(dest, length, gradient, v, det,
+                                         deltaDet, deltaDeltaDet, b, deltaB);
+        break;
+    default:
+        v4_gradient_radial<PadClamp>(dest, length, gradient, v, det, deltaDet,
+                                     deltaDeltaDet, b, deltaB);
+        break;
+    }
+}
+
 void RenderFuncTable::neon()
 {
     updateColor(BlendMode::Src , color_SourceOver);
+
+    mLinearGradient = gradient_Linear;
+    mRadialGradient = gradient_Radial;
+    mPremultiplyImage = image_Premultiply;
 }
 #endif
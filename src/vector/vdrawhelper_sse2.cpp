@@ -250,12 +250,47 @@ static void src_Source(uint32_t* dest, int length, const uint32_t* src,
     }
 }
 
+/*
+ * the 16 bit lanes hold r, g, b, a of 2 pixels. They are swapped to b, g, r, a
+ * and multiplied with a, a, a, 255 so the alpha survives the division,
+ * ((x + 1) * 257) >> 16 is x / 255 rounded down like premultiply_pixel().
+ */
+static inline __m128i v2_premultiply_sse2(__m128i c)
+{
+    const __m128i alpha_mask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    const __m128i alpha_one = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+
+    __m128i a = _mm_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 3, 3));
+    a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+    a = _mm_or_si128(_mm_andnot_si128(alpha_mask, a), alpha_one);
+
+    c = _mm_shufflelo_epi16(c, _MM_SHUFFLE(3, 0, 1, 2));
+    c = _mm_shufflehi_epi16(c, _MM_SHUFFLE(3, 0, 1, 2));
+    c = _mm_add_epi16(_mm_mullo_epi16(c, a), _mm_set1_epi16(1));
+    return _mm_mulhi_epu16(c, _mm_set1_epi16(257));
+}
+
+static void image_Premultiply(uint32_t *dest, const uint8_t *src, int length)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; length >= 4; length -= 4, src += 16, dest += 4) {
+        __m128i c = _mm_loadu_si128((const __m128i *)src);
+        __m128i lo = v2_premultiply_sse2(_mm_unpacklo_epi8(c, zero));
+        __m128i hi = v2_premultiply_sse2(_mm_unpackhi_epi8(c, zero));
+        _mm_storeu_si128((__m128i *)dest, _mm_packus_epi16(lo, hi));
+    }
+    for (int i = 0; i < length; ++i, src += 4) dest[i] = premultiply_pixel(src);
+}
+
 void RenderFuncTable::sse()
 {
     updateColor(BlendMode::Src , color_Source);
     updateColor(BlendMode::SrcOver , color_SourceOver);
 
     updateSrc(BlendMode::Src , src_Source);
+
+    mPremultiplyImage = image_Premultiply;
 }
 
 #endif
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2020 Samsung Electronics Co., Ltd. All rights reserved.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "vdrawhelper.h"
+
+#if defined(LOTTIE_AVX_SUPPORT)
+
+#include <smmintrin.h>
+
+/*
+ * 4 pixels at a time gradient span kernels for cpus without AVX2. The
+ * spread is applied with masks and min/max like in vdrawhelper_avx2.cpp,
+ * there are no gathers so the 4 colors are read from the table one by one.
+ */
+
+#define V_SSE4 __attribute__((target("sse4.1")))
+
+static_assert((VGradient::colorTableSize & (VGradient::colorTableSize - 1)) == 0,
+              "gradient clamp needs a power of two table");
+
+struct PadClamp {
+    V_SSE4 __m128i operator()(__m128i ipos) const
+    {
+        ipos = _mm_min_epi32(ipos,
+                             _mm_set1_epi32(VGradient::colorTableSize - 1));
+        return _mm_max_epi32(ipos, _mm_setzero_si128());
+    }
+};
+
+struct RepeatClamp {
+    V_SSE4 __m128i operator()(__m128i ipos) const
+    {
+        return _mm_and_si128(ipos,
+                             _mm_set1_epi32(VGradient::colorTableSize - 1));
+    }
+};
+
+struct ReflectClamp {
+    V_SSE4 __m128i operator()(__m128i ipos) const
+    {
+        const __m128i limit = _mm_set1_epi32(VGradient::colorTableSize * 2 - 1);
+        ipos = _mm_and_si128(ipos, limit);
+        return _mm_min_epi32(ipos, _mm_sub_epi32(limit, ipos));
+    }
+};
+
+V_SSE4 static inline __m128i v4_lookup(const uint32_t *table, __m128i index)
+{
+    return _mm_setr_epi32(int(table[_mm_extract_epi32(index, 0)]),
+                          int(table[_mm_extract_epi32(index, 1)]),
+                          int(table[_mm_extract_epi32(index, 2)]),
+                          int(table[_mm_extract_epi32(index, 3)]));
+}
+
+// writes the first length pixels of color, length is less than 4.
+V_SSE4 static inline void v4_store_tail(uint32_t *dest, __m128i color,
+                                        int length)
+{
+    alignas(16) uint32_t pixels[4];
+    _mm_store_si128((__m128i *)pixels, color);
+    for (int i = 0; i < length; ++i) dest[i] = pixels[i];
+}
+
+template <typename Clamp>
+V_SSE4 static void v4_gradient_linear(uint32_t *dest, int length,
+                                      const VGradientData *gradient, int pos,
+                                      int inc)
+{
+    const Clamp   clamp;
+    const __m128i half = _mm_set1_epi32(FIXPT_SIZE / 2);
+    // int overflow wraps the same way in the vector registers.
+    const __m128i step = _mm_set1_epi32(int(uint32_t(inc) * 4));
+
+    __m128i vpos = _mm_add_epi32(
+        _mm_set1_epi32(pos),
+        _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(inc)));
+
+    for (; length > 0; length -= 4, dest += 4) {
+        __m128i ipos = _mm_srai_epi32(_mm_add_epi32(vpos, half), FIXPT_BITS);
+        __m128i color = v4_lookup(gradient->mColorTable, clamp(ipos));
+        if (length >= 4)
+            _mm_storeu_si128((__m128i *)dest, color);
+        else
+            v4_store_tail(dest, color, length);
+        vpos = _mm_add_epi32(vpos, step);
+    }
+}
+
+V_SSE4 static void gradient_Linear(uint32_t *dest, int length,
+                                   const VGradientData *gradient, int pos,
+                                   int inc)
+{
+    switch (gradient->mSpread) {
+    case VGradient::Spread::Repeat:
+        v4_gradient_linear<RepeatClamp>(dest, length, gradient, pos, inc);
+        break;
+    case VGradient::Spread::Reflect:
+        v4_gradient_linear<ReflectClamp>(dest, length, gradient, pos, inc);
+        break;
+    default:
+        v4_gradient_linear<PadClamp>(dest, length, gradient, pos, inc);
+        break;
+    }
+}
+
+/*
+ * Every lane runs its own forward difference with a stride of 4 pixels,
+ * see v8_gradient_radial() in vdrawhelper_avx2.cpp. The 4 pixel step of the
+ * determinant is 4 * delta + 6 * delta delta and grows by
+ * 16 * delta delta.
+ */
+template <typename Clamp>
+V_SSE4 static void v4_gradient_radial(uint32_t *dest, int length,
+                                      const VGradientData *       gradient,
+                                      const RadialGradientValues *v, float det,
+                                      float deltaDet, float deltaDeltaDet,
+                                      float b, float deltaB)
+{
+    const Clamp   clamp;
+    const __m128  scale = _mm_set1_ps(float(VGradient::colorTableSize - 1));
+    const __m128  half = _mm_set1_ps(0.5f);
+    const __m128  zero = _mm_setzero_ps();
+    const __m128  fradius = _mm_set1_ps(gradient->radial.fradius);
+    const __m128  dr = _mm_set1_ps(v->dr);
+
+    alignas(16) float dets[4];
+    alignas(16) float deltaDets[4];
+    alignas(16) float bs[4];
+    for (int i = 0; i < 4; ++i) {
+        dets[i] = det;
+        deltaDets[i] = 4 * deltaDet;
+        bs[i] = b;
+        det += deltaDet;
+        deltaDet += deltaDeltaDet;
+        b += deltaB;
+    }
+
+    __m128       vdet = _mm_load_ps(dets);
+    __m128       vb = _mm_load_ps(bs);
+    __m128       vdeltaDet = _mm_add_ps(_mm_load_ps(deltaDets),
+                                  _mm_set1_ps(6 * deltaDeltaDet));
+    const __m128 vdeltaDeltaDet = _mm_set1_ps(16 * deltaDeltaDet);
+    const __m128 vdeltaB = _mm_set1_ps(4 * deltaB);
+
+    for (; length > 0; length -= 4, dest += 4) {
+        __m128  w = _mm_sub_ps(_mm_sqrt_ps(vdet), vb);
+        __m128i ipos =
+            _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(w, scale), half));
+        __m128i color = v4_lookup(gradient->mColorTable, clamp(ipos));
+
+        if (v->extended) {
+            __m128 valid = _mm_and_ps(
+                _mm_cmpge_ps(vdet, zero),
+                _mm_cmpge_ps(_mm_add_ps(fradius, _mm_mul_ps(dr, w)), zero));
+            color = _mm_and_si128(color, _mm_castps_si128(valid));
+        }
+
+        if (length >= 4)
+            _mm_storeu_si128((__m128i *)dest, color);
+        else
+            v4_store_tail(dest, color, length);
+
+        vdet = _mm_add_ps(vdet, vdeltaDet);
+        vdeltaDet = _mm_add_ps(vdeltaDet, vdeltaDeltaDet);
+        vb = _mm_add_ps(vb, vdeltaB);
+    }
+}
+
+V_SSE4 static void gradient_Radial(uint32_t *dest, int length,
+                                   const VGradientData *       gradient,
+                                   const RadialGradientValues *v, float det,
+                                   float deltaDet, float deltaDeltaDet,
+                                   float b, float deltaB)
+{
+    switch (gradient->mSpread) {
+    case VGradient::Spread::Repeat:
+        v4_gradient_radial<RepeatClamp>(dest, length, gradient, v, det,
+                                        deltaDet, deltaDeltaDet, b, deltaB);
+        break;
+    case VGradient::Spread::Reflect:
+        v4_gradient_radial<ReflectClamp>(dest, length, gradient, v, det,
+                                         deltaDet, deltaDeltaDet, b, deltaB);
+        break;
+    default:
+        v4_gradient_radial<PadClamp>(dest, length, gradient, v, det, deltaDet,
+                                     deltaDeltaDet, b, deltaB);
+        break;
+    }
+}
+
+void RenderFuncTable::sse4()
+{
+    mLinearGradient = gradient_Linear;
+    mRadialGradient = gradient_Radial;
+}
+
+#endif
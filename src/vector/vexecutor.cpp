@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2020 Samsung Electronics Co., Ltd. All rights reserved.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "vexecutor.h"
+#include "vdebug.h"
+
+#ifdef LOTTIE_THREAD_SUPPORT
+
+#include <algorithm>
+#include <thread>
+#include "vtaskqueue.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+VExecutor &VExecutor::instance()
+{
+    static VExecutor singleton;
+    return singleton;
+}
+
+VExecutor::~VExecutor()
+{
+    stop();
+}
+
+bool VExecutor::configure(Config config)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mState.load() != State::Idle) {
+        vWarning << "thread pool already started, configuration ignored";
+        return false;
+    }
+    mConfig = std::move(config);
+    mThreads.store(mConfig.mThreads, std::memory_order_relaxed);
+    return true;
+}
+
+unsigned VExecutor::concurrency() const
+{
+    auto threads = mThreads.load(std::memory_order_relaxed);
+    if (threads) return threads;
+    // asking the system is a syscall, the answer does not change.
+    static const unsigned cores =
+        std::max(1u, std::thread::hardware_concurrency());
+    return cores;
+}
+
+// applies the thread attributes of the configuration to a worker.
+void VExecutor::setup(unsigned index)
+{
+#if defined(__linux__)
+    if (!mConfig.mName.empty()) {
+        // thread names are limited to 15 characters.
+        auto name = mConfig.mName.substr(0, 11) + "-" + std::to_string(index);
+        pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+    }
+    if (!mConfig.mAffinity.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (auto cpu : mConfig.mAffinity) {
+            if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+        }
+        if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+            vWarning << "failed to set the affinity of " << mConfig.mName;
+    }
+    if (mConfig.mPriority) {
+        if (setpriority(PRIO_PROCESS, pid_t(syscall(SYS_gettid)),
+                        mConfig.mPriority))
+            vWarning << "failed to set the priority of " << mConfig.mName;
+    }
+#else
+    (void)index;
+#endif
+}
+
+TaskScheduler<VExecutor::Job> *VExecutor::start()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mState.load() == State::Idle) {
+        if (!mConfig.mHost) {
+            mPool = std::make_unique<TaskScheduler<Job>>(concurrency());
+            mPool->start([this](unsigned i) {
+                setup(i);
+                Job job;
+                while (mPool->next(i, job)) {
+                    job();
+                    job = nullptr;
+                }
+            });
+        }
+        mState.store(State::Running);
+    }
+    return mState.load() == State::Running ? mPool.get() : nullptr;
+}
+
+void VExecutor::dispatch(Job job)
+{
+    TaskScheduler<Job> *pool = nullptr;
+    auto                state = mState.load(std::memory_order_acquire);
+    if (state == State::Idle) {
+        pool = start();
+        state = mState.load(std::memory_order_acquire);
+    } else if (state == State::Running) {
+        pool = mPool.get();
+    }
+
+    if (state != State::Running) {
+        // stopped, nobody is left to pick the job up.
+        job();
+    } else if (pool) {
+        pool->push(std::move(job));
+    } else {
+        mConfig.mHost(std::move(job));
+    }
+}
+
+void VExecutor::stop()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mState.exchange(State::Stopped) != State::Running) return;
+    if (mPool) mPool->stop();
+}
+
+#else
+
+VExecutor &VExecutor::instance()
+{
+    static VExecutor singleton;
+    return singleton;
+}
+
+VExecutor::~VExecutor() = default;
+
+bool VExecutor::configure(Config)
+{
+    return true;
+}
+
+void VExecutor::dispatch(Job job)
+{
+    job();
+}
+
+unsigned VExecutor::concurrency() const
+{
+    return 1;
+}
+
+void VExecutor::stop() {}
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2020 Samsung Electronics Co., Ltd. All rights reserved.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VEXECUTOR_H
+#define VEXECUTOR_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "config.h"
+
+#ifdef LOTTIE_THREAD_SUPPORT
+#include <atomic>
+#include <memory>
+#include <mutex>
+#endif
+
+template <typename Task>
+class TaskScheduler;
+
+/*
+ * The single thread pool of the library. It executes the asynchronous
+ * render requests as well as the rle generation tasks, so rlottie never
+ * runs more threads than configured no matter how many players and
+ * drawables are active. The pool is created on first use, the
+ * application can size it, pin it and give its threads a name and a
+ * priority or hand all the work to its own executor instead.
+ * Without thread support every job runs on the calling thread.
+ */
+class VExecutor {
+public:
+    using Job = std::function<void()>;
+    using HostExecutor = std::function<void(Job)>;
+
+    struct Config {
+        unsigned         mThreads{0};  // 0 means one thread per core
+        std::vector<int> mAffinity;    // cpus the threads may run on
+        std::string      mName{"rlottie"};
+        int              mPriority{0};  // nice value of the threads
+        HostExecutor     mHost;  // runs the jobs instead of the pool
+    };
+
+    static VExecutor &instance();
+
+    ~VExecutor();
+
+    // returns false if the pool is already running.
+    bool     configure(Config config);
+    void     dispatch(Job job);
+    unsigned concurrency() const;
+    void     stop();
+
+private:
+    VExecutor() = default;
+
+#ifdef LOTTIE_THREAD_SUPPORT
+    enum class State { Idle, Running, Stopped };
+
+    TaskScheduler<Job> *start();
+    void                setup(unsigned index);
+
+    Config                              mConfig;
+    std::unique_ptr<TaskScheduler<Job>> mPool;
+    std::atomic<State>                  mState{State::Idle};
+    // mConfig.mThreads, concurrency() is called without the lock.
+    std::atomic<unsigned>               mThreads{0};
+    std::mutex                          mMutex;
+#endif
+};
+
+#endif  // VEXECUTOR_H
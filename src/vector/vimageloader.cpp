@@ -1,6 +1,7 @@
 #include "vimageloader.h"
 #include "config.h"
 #include "vdebug.h"
+#include "vdrawhelper.h"
 #include <cstring>
 
 #ifdef _WIN32
@@ -114,21 +115,21 @@ struct VImageLoader::Impl {
 
     ~Impl() { moduleFree(); }
 
-    VBitmap createBitmap(unsigned char *data, int width, int height,
-                         int channel)
+    VBitmap createBitmap(unsigned char *data, int width, int height)
     {
-        // premultiply alpha
-        if (channel == 4)
-            convertToBGRAPremul(data, width, height);
-        else
-            convertToBGRA(data, width, height);
-
-        // create a bitmap of same size.
         VBitmap result =
             VBitmap(width, height, VBitmap::Format::ARGB32_Premultiplied);
 
-        // copy the data to bitmap buffer
-        memcpy(result.data(), data, width * height * 4);
+        // swizzle and premultiply straight into the bitmap buffer, images
+        // without alpha are loaded with an opaque alpha channel.
+        if (result.valid()) {
+            const unsigned char *src = data;
+            for (int y = 0; y < height; ++y, src += width * 4) {
+                auto dest = reinterpret_cast<uint32_t *>(result.data() +
+                                                         y * result.stride());
+                premultiplyImage(dest, src, width);
+            }
+        }
 
         // free the image data
         imageFree(data);
@@ -147,7 +148,7 @@ struct VImageLoader::Impl {
             return VBitmap();
         }
 
-        return createBitmap(data, width, height, n);
+        return createBitmap(data, width, height);
     }
 
     VBitmap load(const char *imageData, size_t len)
@@ -162,46 +163,7 @@ struct VImageLoader::Impl {
             return VBitmap();
         }
 
-        return createBitmap(data, width, height, n);
-    }
-    /*
-     * convert from RGBA to BGRA and premultiply
-     */
-    void convertToBGRAPremul(unsigned char *bits, int width, int height)
-    {
-        int            pixelCount = width * height;
-        unsigned char *pix = bits;
-        for (int i = 0; i < pixelCount; i++) {
-            unsigned char r = pix[0];
-            unsigned char g = pix[1];
-            unsigned char b = pix[2];
-            unsigned char a = pix[3];
-
-            r = (r * a) / 255;
-            g = (g * a) / 255;
-            b = (b * a) / 255;
-
-            pix[0] = b;
-            pix[1] = g;
-            pix[2] = r;
-
-            pix += 4;
-        }
-    }
-    /*
-     * convert from RGBA to BGRA
-     */
-    void convertToBGRA(unsigned char *bits, int width, int height)
-    {
-        int            pixelCount = width * height;
-        unsigned char *pix = bits;
-        for (int i = 0; i < pixelCount; i++) {
-            unsigned char r = pix[0];
-            unsigned char b = pix[2];
-            pix[0] = b;
-            pix[2] = r;
-            pix += 4;
-        }
+        return createBitmap(data, width, height);
     }
 };
 
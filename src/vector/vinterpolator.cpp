@@ -24,7 +24,13 @@ void VInterpolator::init(float aX1, float aY1, float aX2, float aY2)
     mX2 = aX2;
     mY2 = aY2;
 
-    if (mX1 != mY1 || mX2 != mY2) CalcSampleValues();
+    if (mX1 != mY1 || mX2 != mY2) {
+        CalcSampleValues();
+    } else {
+        // linear curves never read the table, it is cleared so an
+        // interpolator stored as raw bytes has no uninitialized content.
+        for (auto &v : mSampleValues) v = 0;
+    }
 }
 
 /*static*/ float VInterpolator::CalcBezier(float aT, float aA1, float aA2)
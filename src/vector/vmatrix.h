@@ -41,6 +41,12 @@ public:
         Project = 0x10
     };
     VMatrix() = default;
+    VMatrix(float h11, float h12, float h13, float h21, float h22, float h23,
+            float dx, float dy, float h33)
+        : m11(h11), m12(h12), m13(h13), m21(h21), m22(h22), m23(h23),
+          mtx(dx), mty(dy), m33(h33), dirty(MatrixType::Project)
+    {
+    }
     bool         isAffine() const;
     bool         isIdentity() const;
     bool         isInvertible() const;
@@ -39,21 +39,70 @@ void VPainter::drawRle(const VPoint &, const VRle &rle)
                   &mSpanData);
 }
 
+namespace {
+struct ClipRectData {
+    VSpanData *spanData;
+    VRect      clip;
+};
+}  // namespace
+
+/*
+ * clips the spans to the clip rect before passing them to the
+ * blend function. used when the clip rle is not inside the clip rect.
+ */
+static void clipRectBlend(size_t count, const VRle::Span *spans,
+                          void *userData)
+{
+    auto       d = static_cast<ClipRectData *>(userData);
+    const int  nspans = 256;
+    VRle::Span out[nspans];
+    int        n = 0;
+
+    const int minx = d->clip.left();
+    const int miny = d->clip.top();
+    const int maxx = d->clip.right();
+    const int maxy = d->clip.bottom();
+
+    for (size_t i = 0; i < count; i++, spans++) {
+        if (spans->y < miny || spans->y >= maxy) continue;
+
+        int x1 = std::max(int(spans->x), minx);
+        int x2 = std::min(spans->x + spans->len, maxx);
+        if (x2 <= x1) continue;
+
+        out[n].x = VRle::Span::Coord(x1);
+        out[n].y = spans->y;
+        out[n].len = VRle::Span::Length(x2 - x1);
+        out[n].coverage = spans->coverage;
+        if (++n == nspans) {
+            d->spanData->mUnclippedBlendFunc(n, out, d->spanData);
+            n = 0;
+        }
+    }
+    if (n) d->spanData->mUnclippedBlendFunc(n, out, d->spanData);
+}
+
 void VPainter::drawRle(const VRle &rle, const VRle &clip)
 {
     if (rle.empty() || clip.empty()) return;
 
     if (!mSpanData.mUnclippedBlendFunc) return;
 
-    rle.intersect(clip, mSpanData.mUnclippedBlendFunc, &mSpanData);
+    if (mSpanData.clipRect().contains(clip.boundingRect())) {
+        rle.intersect(clip, mSpanData.mUnclippedBlendFunc, &mSpanData);
+    } else {
+        ClipRectData data{&mSpanData, mSpanData.clipRect()};
+        rle.intersect(clip, clipRectBlend, &data);
+    }
 }
 
 static void fillRect(const VRect &r, VSpanData *data)
 {
-    auto x1 = std::max(r.x(), 0);
-    auto x2 = std::min(r.x() + r.width(), data->mDrawableSize.width());
-    auto y1 = std::max(r.y(), 0);
-    auto y2 = std::min(r.y() + r.height(), data->mDrawableSize.height());
+    auto clip = data->clipRect();
+    auto x1 = std::max(r.x(), clip.left());
+    auto x2 = std::min(r.x() + r.width(), clip.right());
+    auto y1 = std::max(r.y(), clip.top());
+    auto y2 = std::min(r.y() + r.height(), clip.bottom());
 
     if (x2 <= x1 || y2 <= y1) return;
 
@@ -65,9 +114,9 @@ static void fillRect(const VRect &r, VSpanData *data)
         int n = std::min(nspans, y2 - y);
         int i = 0;
         while (i < n) {
-            spans[i].x = short(x1);
-            spans[i].len = uint16_t(x2 - x1);
-            spans[i].y = short(y + i);
+            spans[i].x = VRle::Span::Coord(x1);
+            spans[i].len = VRle::Span::Length(x2 - x1);
+            spans[i].y = VRle::Span::Coord(y + i);
             spans[i].coverage = 255;
             ++i;
         }
@@ -86,8 +135,8 @@ void VPainter::drawBitmapUntransform(const VRect &  target,
     if (!mSpanData.mUnclippedBlendFunc) return;
 
     // update translation matrix for source texture.
-    mSpanData.dx = float(target.x() - source.x());
-    mSpanData.dy = float(target.y() - source.y());
+    mSpanData.dx = float(source.x() - target.x());
+    mSpanData.dy = float(source.y() - target.y());
 
     fillRect(target, &mSpanData);
 }
@@ -111,6 +160,17 @@ void VPainter::setDrawRegion(const VRect &region)
     mSpanData.setDrawRegion(region);
 }
 
+void VPainter::setClipRect(const VRect &clip)
+{
+    mSpanData.setClipRect(clip);
+}
+
+void VPainter::setSmoothImage(bool smooth)
+{
+    mSpanData.mSmoothImage = smooth;
+    mSpanData.updateSpanFunc();
+}
+
 void VPainter::setBrush(const VBrush &brush)
 {
     mSpanData.setup(brush);
@@ -38,8 +38,11 @@ public:
     bool  begin(VBitmap *buffer);
     void  end();
     void  setDrawRegion(const VRect &region); // sub surface rendering area.
+    void  setClipRect(const VRect &clip); // clip area inside the draw region.
     void  setBrush(const VBrush &brush);
     void  setBlendMode(BlendMode mode);
+    void  setSmoothImage(bool smooth); // bilinear sampling of transformed images.
+    bool  smoothImage() const { return mSpanData.mSmoothImage; }
     void  drawRle(const VPoint &pos, const VRle &rle);
     void  drawRle(const VRle &rle, const VRle &clip);
     VRect clipBoundingRect() const;
@@ -33,13 +33,15 @@ V_BEGIN_NAMESPACE
  * if start > end it treates as a loop and trims as two segment
  *  [0-->end] and [start --> 1]
  */
-VPath VPathMesure::trim(const VPath &path)
+void VPathMesure::trim(const VPath &path, VPath &result)
 {
-    if (vCompare(mStart, mEnd)) return VPath();
+    if (vCompare(mStart, mEnd)) return result.reset();
 
     if ((vCompare(mStart, 0.0f) && (vCompare(mEnd, 1.0f))) ||
-        (vCompare(mStart, 1.0f) && (vCompare(mEnd, 0.0f))))
-        return path;
+        (vCompare(mStart, 1.0f) && (vCompare(mEnd, 0.0f)))) {
+        result = path;
+        return;
+    }
 
     float length = path.length();
 
@@ -50,8 +52,7 @@ VPath VPathMesure::trim(const VPath &path)
             std::numeric_limits<float>::max(),  // 2nd segment
         };
         VDasher dasher(array, 4);
-        dasher.dashed(path, mScratchObject);
-        return mScratchObject;
+        dasher.dashed(path, result);
     } else {
         float array[4] = {
             length * mEnd, (mStart - mEnd) * length,  // 1st segment
@@ -59,8 +60,7 @@ VPath VPathMesure::trim(const VPath &path)
             std::numeric_limits<float>::max(),  // 2nd segment
         };
         VDasher dasher(array, 4);
-        dasher.dashed(path, mScratchObject);
-        return mScratchObject;
+        dasher.dashed(path, result);
     }
 }
 
@@ -20,16 +20,25 @@
  * SOFTWARE.
  */
 #include "vraster.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <climits>
+#include <cstddef>
 #include <cstring>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include "config.h"
 #include "v_ft_raster.h"
 #include "v_ft_stroker.h"
 #include "vdebug.h"
+#include "vexecutor.h"
 #include "vmatrix.h"
 #include "vpath.h"
 #include "vrle.h"
+#include "vsharedrle.h"
 
 V_BEGIN_NAMESPACE
 
@@ -43,7 +52,7 @@ public:
     void reserve(size_t size)
     {
         if (mCapacity > size) return;
-        mCapacity = size;
+        mCapacity = std::max(size, mCapacity * 2);
         mData = std::make_unique<T[]>(mCapacity);
     }
     T *        data() const { return mData.get(); }
@@ -78,7 +87,7 @@ public:
     SW_FT_Fixed             ftMiterLimit;
     dyn_array<SW_FT_Vector> mPointMemory{100};
     dyn_array<char>         mTagMemory{100};
-    dyn_array<short>        mContourMemory{10};
+    dyn_array<int>          mContourMemory{10};
     dyn_array<char>         mContourFlagMemory{10};
 };
 
@@ -171,7 +180,7 @@ void FTOutline::convert(CapStyle cap, JoinStyle join, float width,
 
 void FTOutline::moveTo(const VPointF &pt)
 {
-    assert(ft.n_points <= SHRT_MAX - 1);
+    assert(ft.n_points <= INT_MAX - 1);
 
     ft.points[ft.n_points].x = TO_FT_COORD(pt.x());
     ft.points[ft.n_points].y = TO_FT_COORD(pt.y());
@@ -189,7 +198,7 @@ void FTOutline::moveTo(const VPointF &pt)
 
 void FTOutline::lineTo(const VPointF &pt)
 {
-    assert(ft.n_points <= SHRT_MAX - 1);
+    assert(ft.n_points <= INT_MAX - 1);
 
     ft.points[ft.n_points].x = TO_FT_COORD(pt.x());
     ft.points[ft.n_points].y = TO_FT_COORD(pt.y());
@@ -200,7 +209,7 @@ void FTOutline::lineTo(const VPointF &pt)
 void FTOutline::cubicTo(const VPointF &cp1, const VPointF &cp2,
                         const VPointF ep)
 {
-    assert(ft.n_points <= SHRT_MAX - 3);
+    assert(ft.n_points <= INT_MAX - 3);
 
     ft.points[ft.n_points].x = TO_FT_COORD(cp1.x());
     ft.points[ft.n_points].y = TO_FT_COORD(cp1.y());
@@ -219,7 +228,7 @@ void FTOutline::cubicTo(const VPointF &cp1, const VPointF &cp2,
 }
 void FTOutline::close()
 {
-    assert(ft.n_points <= SHRT_MAX - 1);
+    assert(ft.n_points <= INT_MAX - 1);
 
     // mark the contour as a close path.
     ft.contours_flag[ft.n_contours] = 0;
@@ -245,7 +254,7 @@ void FTOutline::close()
 
 void FTOutline::end()
 {
-    assert(ft.n_contours <= SHRT_MAX - 1);
+    assert(ft.n_contours <= INT_MAX - 1);
 
     if (ft.n_points) {
         ft.contours[ft.n_contours] = ft.n_points - 1;
@@ -253,6 +262,14 @@ void FTOutline::end()
     }
 }
 
+static_assert(sizeof(SW_FT_Span) == sizeof(VRle::Span) &&
+                  offsetof(SW_FT_Span, x) == offsetof(VRle::Span, x) &&
+                  offsetof(SW_FT_Span, y) == offsetof(VRle::Span, y) &&
+                  offsetof(SW_FT_Span, len) == offsetof(VRle::Span, len) &&
+                  offsetof(SW_FT_Span, coverage) ==
+                      offsetof(VRle::Span, coverage),
+              "the rasterizer generates VRle spans in place");
+
 static void rleGenerationCb(int count, const SW_FT_Span *spans, void *user)
 {
     VRle *rle = static_cast<VRle *>(user);
@@ -266,53 +283,211 @@ static void bboxCb(int x, int y, int w, int h, void *user)
     rle->setBoundingRect({x, y, w, h});
 }
 
-class SharedRle {
-public:
-    SharedRle() = default;
-    VRle &unsafe() { return _rle; }
-    void  notify()
+/*
+ * what an rle is generated from: the path, the fill rule or stroke
+ * parameters and the clip.
+ */
+struct RleKey {
+    VPath     mPath;
+    VRect     mClip;
+    float     mStrokeWidth{0};
+    float     mMiterLimit{0};
+    FillRule  mFillRule{FillRule::Winding};
+    CapStyle  mCap{CapStyle::Flat};
+    JoinStyle mJoin{JoinStyle::Bevel};
+    bool      mStroke{false};
+    size_t    mHash{0};
+
+    void updateHash()
     {
-        {
-            std::lock_guard<std::mutex> lock(_mutex);
-            _ready = true;
+        auto mix = [this](size_t v) {
+            mHash ^= v + 0x9e3779b9 + (mHash << 6) + (mHash >> 2);
+        };
+        mHash = 0;
+        const auto &points = mPath.points();
+        const auto &elements = mPath.elements();
+        mix(points.size());
+        mix(elements.size());
+        uint32_t word[2];
+        for (const auto &pt : points) {
+            memcpy(word, &pt, sizeof(word));
+            mix(word[0]);
+            mix(word[1]);
+        }
+        for (auto e : elements) mix(size_t(e));
+        mix(size_t(mClip.left()) ^ (size_t(mClip.top()) << 16));
+        mix(size_t(mClip.width()) ^ (size_t(mClip.height()) << 16));
+        if (mStroke) {
+            memcpy(&word[0], &mStrokeWidth, sizeof(float));
+            memcpy(&word[1], &mMiterLimit, sizeof(float));
+            mix(word[0]);
+            mix(word[1]);
+            mix(size_t(mCap) | (size_t(mJoin) << 8) | (1 << 16));
+        } else {
+            mix(size_t(mFillRule));
         }
-        _cv.notify_one();
     }
-    void wait()
-    {
-        if (!_pending) return;
 
-        {
-            std::unique_lock<std::mutex> lock(_mutex);
-            while (!_ready) _cv.wait(lock);
+    bool operator==(const RleKey &o) const
+    {
+        if (mHash != o.mHash || mStroke != o.mStroke || mClip != o.mClip)
+            return false;
+        if (mStroke) {
+            if (mCap != o.mCap || mJoin != o.mJoin ||
+                memcmp(&mStrokeWidth, &o.mStrokeWidth, sizeof(float)) ||
+                memcmp(&mMiterLimit, &o.mMiterLimit, sizeof(float)))
+                return false;
+        } else if (mFillRule != o.mFillRule) {
+            return false;
         }
+        const auto &points = mPath.points();
+        const auto &elements = mPath.elements();
+        const auto &opoints = o.mPath.points();
+        const auto &oelements = o.mPath.elements();
+        return points.size() == opoints.size() &&
+               elements.size() == oelements.size() &&
+               !memcmp(points.data(), opoints.data(),
+                       points.size() * sizeof(VPointF)) &&
+               !memcmp(elements.data(), oelements.data(),
+                       elements.size() * sizeof(VPath::Element));
+    }
 
-        _pending = false;
+    size_t memorySize() const
+    {
+        return mPath.points().size() * sizeof(VPointF) +
+               mPath.elements().size() * sizeof(VPath::Element);
     }
+};
 
-    VRle &get()
+struct RleKeyHash {
+    size_t operator()(const RleKey &key) const { return key.mHash; }
+};
+
+#ifdef LOTTIE_CACHE_SUPPORT
+
+/*
+ * Shares the rle of identical requests between rasterizers, so several
+ * animations showing the same content at the same size generate each
+ * shape once. A request is only cached the second time it is seen, a path
+ * that changes every frame of a single animation never enters the cache.
+ * The cache is bounded by the bytes of the spans and paths it holds and
+ * evicts the least recently used rle first.
+ */
+class RleCache {
+public:
+    static RleCache &instance()
     {
-        wait();
-        return _rle;
+        static RleCache singleton;
+        return singleton;
     }
+    bool find(const RleKey &key, VRle &rle)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+
+        auto search = mHash.find(key);
+        if (search == mHash.end()) return false;
+
+        mList.splice(mList.begin(), mList, search->second.mPos);
+        rle = search->second.mRle;
+        return true;
+    }
+    void add(RleKey &&key, const VRle &rle)
+    {
+        size_t cost = rle.size() * sizeof(VRle::Span) + key.memorySize();
+
+        std::lock_guard<std::mutex> guard(mMutex);
 
-    void reset()
+        if (cost > mBudget) return;
+
+        if (!seenBefore(key.mHash)) return;
+
+        // the shape keeps reusing the storage of its path only if the
+        // cache holds a copy of its own.
+        VPath path;
+        path.clone(key.mPath);
+        key.mPath = std::move(path);
+
+        auto result = mHash.emplace(std::move(key), Entry{rle, cost, {}});
+        if (!result.second) return;
+
+        mList.push_front(&result.first->first);
+        result.first->second.mPos = mList.begin();
+        mUsed += cost;
+
+        trim();
+    }
+    void configureCacheSize(size_t bytes)
     {
-        wait();
-        _ready = false;
-        _pending = true;
+        std::lock_guard<std::mutex> guard(mMutex);
+        mBudget = bytes;
+        if (!mBudget) mSeen.fill(0);
+
+        trim();
     }
 
 private:
-    VRle                    _rle;
-    std::mutex              _mutex;
-    std::condition_variable _cv;
-    bool                    _ready{true};
-    bool                    _pending{false};
+    struct Entry {
+        VRle                                mRle;
+        size_t                              mSize;
+        std::list<const RleKey *>::iterator mPos;
+    };
+
+    RleCache() = default;
+
+    void trim()
+    {
+        while (mUsed > mBudget) {
+            auto search = mHash.find(*mList.back());
+            mUsed -= search->second.mSize;
+            mList.pop_back();
+            mHash.erase(search);
+        }
+    }
+
+    // hashes of the requests seen once, grouped in small buckets so two
+    // requests of the same frame rarely evict each other. A full bucket
+    // forgets the request it saw the longest time ago.
+    static constexpr size_t maxSeen = 4096;
+    static constexpr size_t seenWays = 4;
+
+    bool seenBefore(size_t hash)
+    {
+        size_t *bucket = &mSeen[(hash % (maxSeen / seenWays)) * seenWays];
+        for (size_t i = 0; i < seenWays; i++)
+            if (bucket[i] == hash) return true;
+        std::memmove(bucket + 1, bucket, (seenWays - 1) * sizeof(size_t));
+        bucket[0] = hash;
+        return false;
+    }
+
+    std::list<const RleKey *>                       mList;
+    std::unordered_map<RleKey, Entry, RleKeyHash> mHash;
+    std::array<size_t, maxSeen>                     mSeen{};
+    std::mutex                                      mMutex;
+    size_t                                          mBudget{8 * 1024 * 1024};
+    size_t                                          mUsed{0};
+};
+
+#else
+
+class RleCache {
+public:
+    static RleCache &instance()
+    {
+        static RleCache singleton;
+        return singleton;
+    }
+    bool find(const RleKey &, VRle &) { return false; }
+    void add(RleKey &&, const VRle &) {}
+    void configureCacheSize(size_t) {}
 };
 
+#endif
+
 struct VRleTask {
-    SharedRle mRle;
+    SharedRle         mRle;
+    VRle              mSpare;  // storage kept while mRle is a cached one
+    std::atomic<bool> mClaimed{true};
     VPath     mPath;
     float     mStrokeWidth;
     float     mMiterLimit;
@@ -322,10 +497,15 @@ struct VRleTask {
     JoinStyle mJoin;
     bool      mGenerateStroke;
 
-    VRle &rle() { return mRle.get(); }
+    VRle &rle()
+    {
+        run();
+        return mRle.get();
+    }
 
     void update(VPath path, FillRule fillRule, const VRect &clip)
     {
+        run();
         mRle.reset();
         mPath = std::move(path);
         mFillRule = fillRule;
@@ -336,6 +516,7 @@ struct VRleTask {
     void update(VPath path, CapStyle cap, JoinStyle join, float width,
                 float miterLimit, const VRect &clip)
     {
+        run();
         mRle.reset();
         mPath = std::move(path);
         mCap = cap;
@@ -349,6 +530,12 @@ struct VRleTask {
     {
         SW_FT_Raster_Params params;
 
+        // the previous rle may still be shared with the cache, the spans
+        // of the last rle generated here are reused then.
+        if (!mRle.unsafe().unique()) {
+            mRle.unsafe() = mSpare;
+            mSpare = VRle();
+        }
         mRle.unsafe().reset();
 
         params.flags = SW_FT_RASTER_FLAG_DIRECT | SW_FT_RASTER_FLAG_AA;
@@ -360,19 +547,74 @@ struct VRleTask {
         if (!mClip.empty()) {
             params.flags |= SW_FT_RASTER_FLAG_CLIP;
 
+            // spans can't address pixels past VRle::Span::maxCoord().
             params.clip_box.xMin = mClip.left();
             params.clip_box.yMin = mClip.top();
-            params.clip_box.xMax = mClip.right();
-            params.clip_box.yMax = mClip.bottom();
+            params.clip_box.xMax =
+                std::min(mClip.right(), VRle::Span::maxCoord());
+            params.clip_box.yMax =
+                std::min(mClip.bottom(), VRle::Span::maxCoord());
         }
         // compute rle
         sw_ft_grays_raster.raster_render(nullptr, &params);
     }
 
+    // makes the task runnable again after update().
+    void arm() { mClaimed.store(false, std::memory_order_release); }
+
+    /*
+     * generates the rle unless some other thread already took the task.
+     * Both the executor and the owner of the rle call it, so an owner that
+     * needs the rle before the executor got to it simply does the work
+     * itself instead of blocking a thread the task may be queued behind.
+     */
+    void run()
+    {
+        if (mClaimed.exchange(true, std::memory_order_acq_rel)) return;
+
+        struct Context {
+            Context() { SW_FT_Stroker_New(&stroker); }
+            ~Context() { SW_FT_Stroker_Done(stroker); }
+            FTOutline     outline{};
+            SW_FT_Stroker stroker;
+        };
+        // per thread objects.
+        static thread_local Context context;
+
+        (*this)(context.outline, context.stroker);
+    }
+
     void operator()(FTOutline &outRef, SW_FT_Stroker &stroker)
     {
-        if (mPath.points().size() > SHRT_MAX ||
-            mPath.points().size() + mPath.segments() > SHRT_MAX) {
+        // the outline indices are ints, the stroker adds a few points for
+        // every point of the path.
+        if (mPath.points().size() + mPath.segments() > INT_MAX / 8) {
+            mRle.unsafe() = VRle();
+            mPath = VPath();
+            mRle.notify();
+            return;
+        }
+
+        RleKey key;
+        key.mPath = mPath;
+        key.mClip = mClip;
+        key.mStroke = mGenerateStroke;
+        if (mGenerateStroke) {
+            key.mCap = mCap;
+            key.mJoin = mJoin;
+            key.mStrokeWidth = mStrokeWidth;
+            key.mMiterLimit = mMiterLimit;
+        } else {
+            key.mFillRule = mFillRule;
+        }
+        key.updateHash();
+
+        VRle cached;
+        if (RleCache::instance().find(key, cached)) {
+            if (mRle.unsafe().unique()) mSpare = mRle.unsafe();
+            mRle.unsafe() = cached;
+            mPath = VPath();
+            mRle.notify();
             return;
         }
 
@@ -407,6 +649,10 @@ struct VRleTask {
 
         render(outRef);
 
+        // settle the lazily computed bounding box before the rle is shared.
+        mRle.unsafe().boundingRect();
+        RleCache::instance().add(std::move(key), mRle.unsafe());
+
         mPath = VPath();
 
         mRle.notify();
@@ -415,146 +661,155 @@ struct VRleTask {
 
 using VTask = std::shared_ptr<VRleTask>;
 
-#ifdef LOTTIE_THREAD_SUPPORT
-
-#include <thread>
-#include "vtaskqueue.h"
-
-class RleTaskScheduler {
-    const unsigned                _count{std::thread::hardware_concurrency()};
-    std::vector<std::thread>      _threads;
-    std::vector<TaskQueue<VTask>> _q{_count};
-    std::atomic<unsigned>         _index{0};
+struct VRasterizer::VRasterizerImpl {
+    VRleTask mTask;
 
-    void run(unsigned i)
-    {
-        /*
-         * initalize  per thread objects.
-         */
-        FTOutline     outlineRef;
-        SW_FT_Stroker stroker;
-        SW_FT_Stroker_New(&stroker);
-
-        // Task Loop
-        VTask task;
-        while (true) {
-            bool success = false;
-
-            for (unsigned n = 0; n != _count * 2; ++n) {
-                if (_q[(i + n) % _count].try_pop(task)) {
-                    success = true;
-                    break;
-                }
-            }
+    VRle &    rle() { return mTask.rle(); }
+    VRleTask &task() { return mTask; }
+};
 
-            if (!success && !_q[i].pop(task)) break;
+VRle VRasterizer::rle()
+{
+    if (!d) return VRle();
+    return d->rle();
+}
 
-            (*task)(outlineRef, stroker);
-        }
+void VRasterizer::init()
+{
+    if (!d) d = std::make_shared<VRasterizerImpl>();
+}
 
-        // cleanup
-        SW_FT_Stroker_Done(stroker);
-    }
+/*
+ * The requests of a batch are handed to the thread pool as a few jobs that
+ * take the tasks in chunks from a shared index. The owner of an rle still
+ * runs its task itself if no job got to it yet. The last job to finish
+ * hands the batch back to the pool.
+ */
+struct VRasterizer::Batch::Impl {
+    enum { Chunk = 8 };
 
-    RleTaskScheduler()
-    {
-        for (unsigned n = 0; n != _count; ++n) {
-            _threads.emplace_back([&, n] { run(n); });
-        }
+    std::vector<VTask>  mTasks;
+    std::atomic<size_t> mNext{0};
+    std::atomic<size_t> mJobs{0};
 
-        IsRunning = true;
-    }
+    void run();
+};
 
+/*
+ * Batches are recycled together with the capacity of their task list, so
+ * handing the requests of a frame to the thread pool does not allocate.
+ */
+class BatchPool {
 public:
-    static bool IsRunning;
+    using Impl = VRasterizer::Batch::Impl;
 
-    static RleTaskScheduler &instance()
+    BatchPool() { mFree.reserve(maxFree); }
+    ~BatchPool()
     {
-        static RleTaskScheduler singleton;
-        return singleton;
+        for (auto batch : mFree) delete batch;
     }
-
-    ~RleTaskScheduler() { stop(); }
-
-    void stop()
+    Impl *get()
     {
-        if (IsRunning) {
-            IsRunning = false;
-
-            for (auto &e : _q) e.done();
-            for (auto &e : _threads) e.join();
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+            if (!mFree.empty()) {
+                Impl *batch = mFree.back();
+                mFree.pop_back();
+                return batch;
+            }
         }
+        return new Impl;
     }
-
-    void process(VTask task)
+    void release(Impl *batch)
     {
-        auto i = _index++;
-
-        for (unsigned n = 0; n != _count; ++n) {
-            if (_q[(i + n) % _count].try_push(std::move(task))) return;
-        }
-
-        if (_count > 0) {
-            _q[i % _count].push(std::move(task));
+        batch->mTasks.clear();
+        batch->mNext.store(0, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+            if (mFree.size() < maxFree) {
+                mFree.push_back(batch);
+                return;
+            }
         }
+        delete batch;
     }
-};
 
-#else
+private:
+    static constexpr size_t maxFree = 16;
 
-class RleTaskScheduler {
-public:
-    FTOutline     outlineRef{};
-    SW_FT_Stroker stroker;
+    std::vector<Impl *> mFree;
+    std::mutex          mMutex;
+};
 
-public:
-    static bool IsRunning;
+// outlives the executor, its threads may still release a batch while it
+// shuts down.
+static BatchPool batchPool;
 
-    static RleTaskScheduler &instance()
-    {
-        static RleTaskScheduler singleton;
-        return singleton;
+void VRasterizer::Batch::Impl::run()
+{
+    const size_t count = mTasks.size();
+    size_t       start;
+    while ((start = mNext.fetch_add(Chunk, std::memory_order_relaxed)) <
+           count) {
+        size_t end = std::min(start + Chunk, count);
+        for (size_t i = start; i < end; i++) mTasks[i]->run();
     }
+    if (mJobs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        batchPool.release(this);
+}
 
-    void stop() {}
-
-    RleTaskScheduler() { SW_FT_Stroker_New(&stroker); }
-
-    ~RleTaskScheduler() { SW_FT_Stroker_Done(stroker); }
-
-    void process(VTask task) { (*task)(outlineRef, stroker); }
-};
-#endif
-
-bool RleTaskScheduler::IsRunning{false};
-
-struct VRasterizer::VRasterizerImpl {
-    VRleTask mTask;
+// the innermost batch alive on this thread.
+static thread_local VRasterizer::Batch *currentBatch = nullptr;
 
-    VRle &    rle() { return mTask.rle(); }
-    VRleTask &task() { return mTask; }
-};
+VRasterizer::Batch::Batch() : mPrev(currentBatch)
+{
+    currentBatch = this;
+}
 
-VRle VRasterizer::rle()
+VRasterizer::Batch::~Batch()
 {
-    if (!d) return VRle();
-    return d->rle();
+    submit();
+    currentBatch = mPrev;
 }
 
-void VRasterizer::init()
+void VRasterizer::Batch::submit()
 {
-    if (!d) d = std::make_shared<VRasterizerImpl>();
+    if (!d) return;
+
+    // no more jobs than chunks or threads that could run them.
+    Impl * batch = d;
+    size_t jobs = (batch->mTasks.size() + Impl::Chunk - 1) / Impl::Chunk;
+    jobs = std::min<size_t>(jobs, VExecutor::instance().concurrency());
+    d = nullptr;
+
+    batch->mJobs.store(jobs, std::memory_order_relaxed);
+    // the job only carries a pointer, so it fits in the job itself.
+    for (size_t i = 0; i < jobs; i++)
+        VExecutor::instance().dispatch([batch]() { batch->run(); });
 }
 
 void VRasterizer::updateRequest()
 {
     VTask taskObj = VTask(d, &d->task());
-    RleTaskScheduler::instance().process(std::move(taskObj));
+    taskObj->arm();
+    if (currentBatch) {
+        auto &batch = currentBatch->d;
+        if (!batch) batch = batchPool.get();
+        batch->mTasks.push_back(std::move(taskObj));
+    } else {
+        VExecutor::instance().dispatch([taskObj]() { taskObj->run(); });
+    }
+}
+
+void VRasterizer::configureCacheSize(size_t bytes)
+{
+    RleCache::instance().configureCacheSize(bytes);
 }
 
 void VRasterizer::rasterize(VPath path, FillRule fillRule, const VRect &clip)
 {
     init();
+    mGeneration++;
     if (path.empty()) {
         d->rle().reset();
         return;
@@ -567,6 +822,7 @@ void VRasterizer::rasterize(VPath path, CapStyle cap, JoinStyle join,
                             float width, float miterLimit, const VRect &clip)
 {
     init();
+    mGeneration++;
     if (path.empty() || vIsZero(width)) {
         d->rle().reset();
         return;
@@ -575,11 +831,4 @@ void VRasterizer::rasterize(VPath path, CapStyle cap, JoinStyle join,
     updateRequest();
 }
 
-void lottieShutdownRasterTaskScheduler()
-{
-    if (RleTaskScheduler::IsRunning) {
-        RleTaskScheduler::instance().stop();
-    }
-}
-
 V_END_NAMESPACE
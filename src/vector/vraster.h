@@ -34,15 +34,40 @@ class VRle;
 class VRasterizer
 {
 public:
+    /*
+     * the requests made on this thread while a batch is alive are handed
+     * to the thread pool together when it is submitted or destroyed.
+     */
+    class Batch {
+    public:
+        Batch();
+        ~Batch();
+        Batch(const Batch &) = delete;
+        Batch &operator=(const Batch &) = delete;
+        void submit();
+
+    private:
+        friend class VRasterizer;
+        friend class BatchPool;
+        struct Impl;
+        Impl * d{nullptr};
+        Batch *mPrev{nullptr};
+    };
+
     void rasterize(VPath path, FillRule fillRule = FillRule::Winding, const VRect &clip = VRect());
     void rasterize(VPath path, CapStyle cap, JoinStyle join, float width,
                    float miterLimit, const VRect &clip = VRect());
     VRle rle();
+    // changes every time a new rle is requested.
+    size_t generation() const { return mGeneration; }
+    // bytes of rle shared between identical requests, 0 disables sharing.
+    static void configureCacheSize(size_t bytes);
 private:
     struct VRasterizerImpl;
     void init();
     void updateRequest();
     std::shared_ptr<VRasterizerImpl> d{nullptr};
+    size_t                           mGeneration{0};
 };
 
 V_END_NAMESPACE
@@ -62,6 +62,9 @@ public:
 
     VRect intersected(const VRect &r) const;
     VRect operator&(const VRect &r) const;
+    // bounding rect of both rects.
+    VRect  operator|(const VRect &r) const;
+    VRect &operator|=(const VRect &r) { return *this = *this | r; }
 
 private:
     int x1{0};
@@ -75,6 +78,19 @@ inline VRect VRect::intersected(const VRect &r) const
     return *this & r;
 }
 
+inline VRect VRect::operator|(const VRect &r) const
+{
+    if (empty()) return r;
+    if (r.empty()) return *this;
+
+    VRect u;
+    u.x1 = x1 < r.x1 ? x1 : r.x1;
+    u.y1 = y1 < r.y1 ? y1 : r.y1;
+    u.x2 = x2 > r.x2 ? x2 : r.x2;
+    u.y2 = y2 > r.y2 ? y2 : r.y2;
+    return u;
+}
+
 inline bool VRect::intersects(const VRect &r)
 {
     return (right() > r.left() && left() < r.right() && bottom() > r.top() &&
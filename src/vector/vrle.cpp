@@ -32,12 +32,16 @@
 #include "vdebug.h"
 #include "vglobal.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 V_BEGIN_NAMESPACE
 
 using Result = std::array<VRle::Span, 255>;
 using rle_view = VRle::View;
-static size_t _opGeneric(rle_view &a, rle_view &b, Result &result,
-                         VRle::Data::Op op);
+static void   _opGeneric(rle_view &a, rle_view &b,
+                         std::vector<VRle::Span> &out, VRle::Data::Op op);
 static size_t _opIntersect(const VRect &, rle_view &, Result &);
 static size_t _opIntersect(rle_view &, rle_view &, Result &);
 
@@ -49,9 +53,9 @@ static inline uint8_t divBy255(int x)
 inline static void copy(const VRle::Span *span, size_t count,
                         std::vector<VRle::Span> &v)
 {
-    // make sure enough memory available
-    if (v.capacity() < v.size() + count) v.reserve(v.size() + count);
-    std::copy(span, span + count, back_inserter(v));
+    // let the vector grow geometrically, reserving the exact size
+    // reallocates for every batch of spans the rasterizer hands over.
+    v.insert(v.end(), span, span + count);
 }
 
 void VRle::Data::addSpan(const VRle::Span *span, size_t count)
@@ -197,13 +201,7 @@ void VRle::Data::opSubstract(const VRle::Data &aObj, const VRle::Data &bObj)
         b = {bPtr, size_t(bEnd - bPtr)};
 
         // 3. calculate the intersect region
-        Result result;
-
-        // run till all the spans are processed
-        while (a.size() && b.size()) {
-            auto count = _opGeneric(a, b, result, Op::Substract);
-            if (count) copy(result.data(), count, mSpans);
-        }
+        _opGeneric(a, b, mSpans, Op::Substract);
 
         // 4. copy the rest of a
         if (a.size()) copy(a.data(), a.size(), mSpans);
@@ -223,15 +221,13 @@ void VRle::Data::opGeneric(const VRle::Data &aObj, const VRle::Data &bObj,
     // reserve some space for the result vector.
     mSpans.reserve(a.size() + b.size());
 
-    // if two rle are disjoint
-    if (!aObj.bbox().intersects(bObj.bbox())) {
-        if (a.data()[0].y < b.data()[0].y) {
-            copy(a.data(), a.size(), mSpans);
-            copy(b.data(), b.size(), mSpans);
-        } else {
-            copy(b.data(), b.size(), mSpans);
-            copy(a.data(), a.size(), mSpans);
-        }
+    // if one rle is above the other, rles side by side still share rows.
+    if (aObj.bbox().bottom() <= bObj.bbox().top()) {
+        copy(a.data(), a.size(), mSpans);
+        copy(b.data(), b.size(), mSpans);
+    } else if (bObj.bbox().bottom() <= aObj.bbox().top()) {
+        copy(b.data(), b.size(), mSpans);
+        copy(a.data(), a.size(), mSpans);
     } else {
         auto aPtr = a.data();
         auto aEnd = a.data() + a.size();
@@ -256,13 +252,8 @@ void VRle::Data::opGeneric(const VRle::Data &aObj, const VRle::Data &bObj,
         b = {bPtr, size_t(bEnd - bPtr)};
 
         // 3. calculate the intersect region
-        Result result;
+        _opGeneric(a, b, mSpans, op);
 
-        // run till all the spans are processed
-        while (a.size() && b.size()) {
-            auto count = _opGeneric(a, b, result, op);
-            if (count) copy(result.data(), count, mSpans);
-        }
         // 3. copy the rest
         if (b.size()) copy(b.data(), b.size(), mSpans);
         if (a.size()) copy(a.data(), a.size(), mSpans);
@@ -300,7 +291,7 @@ void VRle::Data::opIntersect(VRle::View a, VRle::View b)
         if (count) copy(result.data(), count, mSpans);
     }
 
-    updateBbox();
+    mBboxDirty = true;
 }
 
 static void _opIntersect(rle_view a, rle_view b, VRle::VRleSpanCb cb,
@@ -425,7 +416,8 @@ static size_t _opIntersect(const VRect &clip, rle_view &obj, Result &result)
             out->x = minx;
         } else {
             out->x = span.x;
-            out->len = std::min(span.len, uint16_t(maxx - span.x + 1));
+            out->len =
+                std::min(span.len, VRle::Span::Length(maxx - span.x + 1));
         }
         if (out->len != 0) {
             out->y = span.y;
@@ -442,212 +434,268 @@ static size_t _opIntersect(const VRect &clip, rle_view &obj, Result &result)
     return result.max_size() - available;
 }
 
-static void blitXor(VRle::Span *spans, int count, uint8_t *buffer, int offsetX)
+/*
+ * the blend of one span coverage c with the buffer coverage d. the SSE2
+ * versions work on 8 pixels widened to 16 bit lanes, every product fits
+ * a lane and divBy255() is done the same way, so they are bit exact with
+ * the scalar ones.
+ */
+#if defined(__SSE2__)
+static inline __m128i divBy255(__m128i x)
 {
-    while (count--) {
-        int    x = spans->x + offsetX;
-        int    l = spans->len;
-        uint8_t *ptr = buffer + x;
-        while (l--) {
-            int da = *ptr;
-            *ptr = divBy255((255 - spans->coverage) * (da) +
-                            spans->coverage * (255 - da));
-            ptr++;
-        }
-        spans++;
-    }
+    x = _mm_add_epi16(x, _mm_srli_epi16(x, 8));
+    x = _mm_add_epi16(x, _mm_set1_epi16(0x80));
+    return _mm_srli_epi16(x, 8);
 }
+#endif
 
-static void blitDestinationOut(VRle::Span *spans, int count, uint8_t *buffer,
-                               int offsetX)
-{
-    while (count--) {
-        int    x = spans->x + offsetX;
-        int    l = spans->len;
-        uint8_t *ptr = buffer + x;
-        while (l--) {
-            *ptr = divBy255((255 - spans->coverage) * (*ptr));
-            ptr++;
-        }
-        spans++;
+struct BlendSrc {
+    explicit BlendSrc(uint8_t c) : c(c) {}
+    uint8_t operator()(uint8_t d) const { return std::max(c, d); }
+#if defined(__SSE2__)
+    __m128i operator()(__m128i d) const
+    {
+        return _mm_max_epi16(d, _mm_set1_epi16(c));
     }
-}
+#endif
+    uint8_t c;
+};
 
-static void blitSrcOver(VRle::Span *spans, int count, uint8_t *buffer,
-                        int offsetX)
-{
-    while (count--) {
-        int    x = spans->x + offsetX;
-        int    l = spans->len;
-        uint8_t *ptr = buffer + x;
-        while (l--) {
-            *ptr = spans->coverage + divBy255((255 - spans->coverage) * (*ptr));
-            ptr++;
-        }
-        spans++;
+struct BlendSrcOver {
+    explicit BlendSrcOver(uint8_t c) : c(c) {}
+    uint8_t operator()(uint8_t d) const
+    {
+        return c + divBy255((255 - c) * d);
     }
-}
+#if defined(__SSE2__)
+    __m128i operator()(__m128i d) const
+    {
+        d = divBy255(_mm_mullo_epi16(d, _mm_set1_epi16(255 - c)));
+        return _mm_add_epi16(d, _mm_set1_epi16(c));
+    }
+#endif
+    uint8_t c;
+};
+
+struct BlendDestinationOut {
+    explicit BlendDestinationOut(uint8_t c) : c(c) {}
+    uint8_t operator()(uint8_t d) const { return divBy255((255 - c) * d); }
+#if defined(__SSE2__)
+    __m128i operator()(__m128i d) const
+    {
+        return divBy255(_mm_mullo_epi16(d, _mm_set1_epi16(255 - c)));
+    }
+#endif
+    uint8_t c;
+};
+
+struct BlendXor {
+    explicit BlendXor(uint8_t c) : c(c) {}
+    uint8_t operator()(uint8_t d) const
+    {
+        return divBy255((255 - c) * d + c * (255 - d));
+    }
+#if defined(__SSE2__)
+    __m128i operator()(__m128i d) const
+    {
+        __m128i id = _mm_sub_epi16(_mm_set1_epi16(255), d);
+        d = _mm_mullo_epi16(d, _mm_set1_epi16(255 - c));
+        id = _mm_mullo_epi16(id, _mm_set1_epi16(c));
+        return divBy255(_mm_add_epi16(d, id));
+    }
+#endif
+    uint8_t c;
+};
 
-void blitSrc(VRle::Span *spans, int count, uint8_t *buffer, int offsetX)
+template <typename Blend>
+static void blit(const VRle::Span *spans, int count, uint8_t *buffer,
+                 int offsetX)
 {
     while (count--) {
-        int    x = spans->x + offsetX;
-        int    l = spans->len;
-        uint8_t *ptr = buffer + x;
-        while (l--) {
-            *ptr = std::max(spans->coverage, *ptr);
-            ptr++;
+        Blend    blend(spans->coverage);
+        uint8_t *ptr = buffer + spans->x + offsetX;
+        int      l = spans->len;
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        for (; l >= 16; l -= 16, ptr += 16) {
+            __m128i d = _mm_loadu_si128(reinterpret_cast<__m128i *>(ptr));
+            __m128i lo = blend(_mm_unpacklo_epi8(d, zero));
+            __m128i hi = blend(_mm_unpackhi_epi8(d, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(ptr),
+                             _mm_packus_epi16(lo, hi));
         }
+#endif
+        for (; l; l--, ptr++) *ptr = blend(*ptr);
         spans++;
     }
 }
 
-size_t bufferToRle(uint8_t *buffer, int size, int offsetX, int y,
-                   VRle::Span *out)
+static size_t bufferToRle(const uint8_t *buffer, int size, int offsetX, int y,
+                          VRle::Span *out)
 {
     size_t count = 0;
-    uint8_t value = buffer[0];
-    int    curIndex = 0;
-
-    // size = offsetX < 0 ? size + offsetX : size;
-    for (int i = 0; i < size; i++) {
-        uint8_t curValue = buffer[0];
-        if (value != curValue) {
-            if (value) {
-                out->y = y;
-                out->x = offsetX + curIndex;
-                out->len = i - curIndex;
-                out->coverage = value;
-                out++;
-                count++;
+    int    start = 0;
+    while (start < size) {
+        uint8_t value = buffer[start];
+        int     end = start + 1;
+#if defined(__SSE2__)
+        // skip 16 pixels at a time while the coverage stays the same.
+        const __m128i v = _mm_set1_epi8(char(value));
+        while (end + 16 <= size) {
+            auto d = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(buffer + end));
+            int same = _mm_movemask_epi8(_mm_cmpeq_epi8(d, v));
+            if (same != 0xffff) {
+                end += __builtin_ctz(~same);
+                break;
             }
-            curIndex = i;
-            value = curValue;
+            end += 16;
         }
-        buffer++;
-    }
-    if (value) {
-        out->y = y;
-        out->x = offsetX + curIndex;
-        out->len = size - curIndex;
-        out->coverage = value;
-        count++;
+#endif
+        while (end < size && buffer[end] == value) end++;
+        if (value) {
+            out->x = offsetX + start;
+            out->y = y;
+            out->len = end - start;
+            out->coverage = value;
+            out++;
+            count++;
+        }
+        start = end;
     }
     return count;
 }
 
+/*
+ * rows of both rles that share the same y are blended into a coverage
+ * buffer as wide as the row and converted back to spans. the buffers are
+ * per thread and only grow, so a merge doesn't allocate once they fit the
+ * widest row.
+ */
+static vthread_local std::vector<uint8_t>    Merge_Buffer;
+static vthread_local std::vector<VRle::Span> Merge_Spans;
+
 struct SpanMerger {
     explicit SpanMerger(VRle::Data::Op op)
+        : _keep(op != VRle::Data::Op::Substract)
     {
         switch (op) {
         case VRle::Data::Op::Add:
-            _blitter = &blitSrcOver;
+            _blitter = &blit<BlendSrcOver>;
             break;
         case VRle::Data::Op::Xor:
-            _blitter = &blitXor;
+            _blitter = &blit<BlendXor>;
             break;
         case VRle::Data::Op::Substract:
-            _blitter = &blitDestinationOut;
+            _blitter = &blit<BlendDestinationOut>;
             break;
         }
     }
-    using blitter = void (*)(VRle::Span *, int, uint8_t *, int);
-    blitter                     _blitter;
-    std::array<VRle::Span, 256> _result;
-    std::array<uint8_t, 1024>   _buffer;
-    VRle::Span *                _aStart{nullptr};
-    VRle::Span *                _bStart{nullptr};
-
-    void revert(VRle::Span *&aPtr, VRle::Span *&bPtr)
-    {
-        aPtr = _aStart;
-        bPtr = _bStart;
-    }
-    VRle::Span *data() { return _result.data(); }
-    size_t merge(VRle::Span *&aPtr, const VRle::Span *aEnd, VRle::Span *&bPtr,
-                 const VRle::Span *bEnd);
+    using blitter = void (*)(const VRle::Span *, int, uint8_t *, int);
+    blitter _blitter;
+    bool    _keep;  // b spans are part of the result
+
+    void merge(VRle::Span *&aPtr, const VRle::Span *aEnd, VRle::Span *&bPtr,
+               const VRle::Span *bEnd, std::vector<VRle::Span> &out);
+    bool interleave(const VRle::Span *a, const VRle::Span *aEnd,
+                    const VRle::Span *b, const VRle::Span *bEnd,
+                    std::vector<VRle::Span> &out);
 };
 
-size_t SpanMerger::merge(VRle::Span *&aPtr, const VRle::Span *aEnd,
-                         VRle::Span *&bPtr, const VRle::Span *bEnd)
+/*
+ * when no span of a row overlaps a span of the other rle the spans are
+ * already the result, they only have to be sorted by x. returns false and
+ * leaves out untouched as soon as two spans overlap.
+ */
+bool SpanMerger::interleave(const VRle::Span *a, const VRle::Span *aEnd,
+                            const VRle::Span *b, const VRle::Span *bEnd,
+                            std::vector<VRle::Span> &out)
+{
+    size_t mark = out.size();
+    while (a < aEnd || b < bEnd) {
+        bool fromA = (b == bEnd) || (a < aEnd && a->x < b->x);
+        auto span = fromA ? a++ : b++;
+        auto next = fromA ? (b < bEnd ? b : nullptr) : (a < aEnd ? a : nullptr);
+        if (next && span->x + span->len > next->x) {
+            out.resize(mark);
+            return false;
+        }
+        if (fromA || _keep) out.push_back(*span);
+    }
+    return true;
+}
+
+void SpanMerger::merge(VRle::Span *&aPtr, const VRle::Span *aEnd,
+                       VRle::Span *&bPtr, const VRle::Span *bEnd,
+                       std::vector<VRle::Span> &out)
 {
     assert(aPtr->y == bPtr->y);
 
-    _aStart = aPtr;
-    _bStart = bPtr;
-    int lb = std::min(aPtr->x, bPtr->x);
-    int y = aPtr->y;
+    auto aStart = aPtr;
+    auto bStart = bPtr;
+    int  lb = std::min(aPtr->x, bPtr->x);
+    int  y = aPtr->y;
 
     while (aPtr < aEnd && aPtr->y == y) aPtr++;
     while (bPtr < bEnd && bPtr->y == y) bPtr++;
 
+    if (interleave(aStart, aPtr, bStart, bPtr, out)) return;
+
     int ub = std::max((aPtr - 1)->x + (aPtr - 1)->len,
                       (bPtr - 1)->x + (bPtr - 1)->len);
-    int length = (lb < 0) ? ub + lb : ub - lb;
+    int length = ub - lb;
+
+    if (length <= 0) return;
 
-    if (length <= 0 || size_t(length) >= _buffer.max_size()) {
-        // can't handle merge . skip
-        return 0;
+    if (Merge_Buffer.size() < size_t(length)) {
+        Merge_Buffer.resize(length);
+        Merge_Spans.resize(length);
     }
 
     // clear buffer
-    memset(_buffer.data(), 0, length);
+    memset(Merge_Buffer.data(), 0, length);
 
     // blit a to buffer
-    blitSrc(_aStart, aPtr - _aStart, _buffer.data(), -lb);
+    blit<BlendSrc>(aStart, int(aPtr - aStart), Merge_Buffer.data(), -lb);
 
     // blit b to buffer
-    _blitter(_bStart, bPtr - _bStart, _buffer.data(), -lb);
+    _blitter(bStart, int(bPtr - bStart), Merge_Buffer.data(), -lb);
 
     // convert buffer to span
-    return bufferToRle(_buffer.data(), length, lb, y, _result.data());
+    auto count =
+        bufferToRle(Merge_Buffer.data(), length, lb, y, Merge_Spans.data());
+    copy(Merge_Spans.data(), count, out);
 }
 
-static size_t _opGeneric(rle_view &a, rle_view &b, Result &result,
-                         VRle::Data::Op op)
+static void _opGeneric(rle_view &a, rle_view &b, std::vector<VRle::Span> &out,
+                       VRle::Data::Op op)
 {
     SpanMerger merger{op};
 
-    auto   out = result.data();
-    size_t available = result.max_size();
-    auto   aPtr = a.data();
-    auto   aEnd = a.data() + a.size();
-    auto   bPtr = b.data();
-    auto   bEnd = b.data() + b.size();
+    auto aPtr = a.data();
+    auto aEnd = a.data() + a.size();
+    auto bPtr = b.data();
+    auto bEnd = b.data() + b.size();
 
     // only logic change for substract operation.
     const bool keep = op != (VRle::Data::Op::Substract);
 
-    while (available && aPtr < aEnd && bPtr < bEnd) {
+    while (aPtr < aEnd && bPtr < bEnd) {
         if (aPtr->y < bPtr->y) {
-            *out++ = *aPtr++;
-            available--;
+            auto start = aPtr;
+            while (aPtr < aEnd && aPtr->y < bPtr->y) aPtr++;
+            copy(start, aPtr - start, out);
         } else if (bPtr->y < aPtr->y) {
-            if (keep) {
-                *out++ = *bPtr;
-                available--;
-            }
-            bPtr++;
+            auto start = bPtr;
+            while (bPtr < bEnd && bPtr->y < aPtr->y) bPtr++;
+            if (keep) copy(start, bPtr - start, out);
         } else {  // same y
-            auto count = merger.merge(aPtr, aEnd, bPtr, bEnd);
-            if (available >= count) {
-                if (count) {
-                    memcpy(out, merger.data(), count * sizeof(VRle::Span));
-                    out += count;
-                    available -= count;
-                }
-            } else {
-                // not enough space try next time.
-                merger.revert(aPtr, bPtr);
-                break;
-            }
+            merger.merge(aPtr, aEnd, bPtr, bEnd, out);
         }
     }
     // update the span list that yet to be processed
     a = {aPtr, size_t(aEnd - aPtr)};
     b = {bPtr, size_t(bEnd - bPtr)};
-
-    return result.max_size() - available;
 }
 
 /*
@@ -713,6 +761,18 @@ void VRle::operator&=(const VRle &o)
     d.write() = Scratch_Object;
 }
 
+void VRle::operator+=(const VRle &o)
+{
+    if (o.empty()) return;
+    if (empty()) {
+        clone(o);
+        return;
+    }
+    Scratch_Object.reset();
+    Scratch_Object.opGeneric(d.read(), o.d.read(), Data::Op::Add);
+    d.write() = Scratch_Object;
+}
+
 VRle operator-(const VRect &rect, const VRle &o)
 {
     if (rect.empty()) return {};
@@ -23,7 +23,9 @@
 #ifndef VRLE_H
 #define VRLE_H
 
+#include <limits>
 #include <vector>
+#include "config.h"
 #include "vcowptr.h"
 #include "vglobal.h"
 #include "vpoint.h"
@@ -33,11 +35,29 @@ V_BEGIN_NAMESPACE
 
 class VRle {
 public:
+    /*
+     * 16 bit coordinates keep the spans of a mobile sized frame small but
+     * can't address pixels past 32767, LOTTIE_WIDE_SPAN_SUPPORT widens them.
+     * the layout has to match SW_FT_Span, the rasterizer writes the spans.
+     */
     struct Span {
-        short  x{0};
-        short  y{0};
-        uint16_t len{0};
-        uint8_t  coverage{0};
+#ifdef LOTTIE_WIDE_SPAN_SUPPORT
+        using Coord = int32_t;
+        using Length = int32_t;
+#else
+        using Coord = int16_t;
+        using Length = uint16_t;
+#endif
+        // largest coordinate a span can address.
+        static constexpr int maxCoord()
+        {
+            return std::numeric_limits<Coord>::max();
+        }
+
+        Coord   x{0};
+        Coord   y{0};
+        Length  len{0};
+        uint8_t coverage{0};
     };
     using VRleSpanCb = void (*)(size_t count, const VRle::Span *spans,
                                 void *userData);
@@ -58,6 +78,7 @@ public:
     void intersect(const VRle &rle, VRleSpanCb cb, void *userData) const;
 
     void operator&=(const VRle &o);
+    void operator+=(const VRle &o);
     VRle operator&(const VRle &o) const;
     VRle operator-(const VRle &o) const;
     VRle operator+(const VRle &o) const { return opGeneric(o, Data::Op::Add); }
@@ -66,6 +87,8 @@ public:
     friend VRle operator-(const VRect &rect, const VRle &o);
     friend VRle operator&(const VRect &rect, const VRle &o);
 
+    // number of spans.
+    size_t size() const { return d->mSpans.size(); }
     bool   unique() const { return d.unique(); }
     size_t refCount() const { return d.refCount(); }
     void   clone(const VRle &o) { d.write().clone(o.d.read()); }
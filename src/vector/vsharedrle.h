@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2020 Samsung Electronics Co., Ltd. All rights reserved.
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VSHAREDRLE_H
+#define VSHAREDRLE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include "vrle.h"
+
+V_BEGIN_NAMESPACE
+
+struct RleParking {
+    std::mutex              mutex;
+    std::condition_variable cv;
+};
+
+// one of a few process wide parking spots, picked by the address of the rle.
+inline RleParking &rleParking(const void *rle)
+{
+    // never destroyed, executor threads may still notify while it shuts down.
+    static RleParking *lot = new RleParking[16];
+    return lot[(reinterpret_cast<uintptr_t>(rle) >> 6) % 16];
+}
+
+/*
+ * The rle is handed from the thread that generates it to its owner with a
+ * single atomic state. The owner only blocks when it asks for an rle that
+ * another thread is still generating, it then parks on one of a few
+ * process wide condition variables picked by the address of the rle, so
+ * a drawable does not carry its own mutex and condition variable.
+ */
+class SharedRle {
+public:
+    SharedRle() = default;
+    VRle &unsafe() { return _rle; }
+    void  notify()
+    {
+        if (_state.exchange(Ready, std::memory_order_acq_rel) == Waiting) {
+            // the waiter checks the state under the lock, so it either saw
+            // Ready or is already waiting when the lock is taken here.
+            RleParking &park = parking();
+            std::lock_guard<std::mutex> lock(park.mutex);
+            park.cv.notify_all();
+        }
+    }
+    void wait()
+    {
+        if (_state.load(std::memory_order_acquire) == Ready) return;
+
+        RleParking &park = parking();
+        std::unique_lock<std::mutex> lock(park.mutex);
+        uint8_t state = Pending;
+        _state.compare_exchange_strong(state, Waiting,
+                                       std::memory_order_acq_rel);
+        while (_state.load(std::memory_order_acquire) != Ready)
+            park.cv.wait(lock);
+    }
+
+    VRle &get()
+    {
+        wait();
+        return _rle;
+    }
+
+    void reset()
+    {
+        wait();
+        _state.store(Pending, std::memory_order_relaxed);
+    }
+
+private:
+    enum : uint8_t { Ready, Pending, Waiting };
+
+    RleParking &parking() const { return rleParking(this); }
+
+    VRle                 _rle;
+    std::atomic<uint8_t> _state{Ready};
+};
+
+V_END_NAMESPACE
+
+#endif  // VSHAREDRLE_H
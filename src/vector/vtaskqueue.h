@@ -23,65 +23,386 @@
 #ifndef VTASKQUEUE_H
 #define VTASKQUEUE_H
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
-template <typename Task>
-class TaskQueue {
-    using lock_t = std::unique_lock<std::mutex>;
-    std::deque<Task>      _q;
-    bool                    _done{false};
-    std::mutex              _mutex;
-    std::condition_variable _ready;
+/*
+ * Chase-Lev work stealing deque of pointers. Only the owner thread pushes
+ * and pops at the bottom (LIFO, the most recent task is still hot in the
+ * cache), any other thread can steal from the top (FIFO).
+ */
+template <typename T>
+class WorkStealingDeque {
+    struct Ring {
+        explicit Ring(int64_t capacity)
+            : mMask(capacity - 1), mData(new std::atomic<T>[size_t(capacity)])
+        {
+        }
+        int64_t capacity() const { return mMask + 1; }
+        T       get(int64_t i) const
+        {
+            return mData[i & mMask].load(std::memory_order_relaxed);
+        }
+        void put(int64_t i, T v)
+        {
+            mData[i & mMask].store(v, std::memory_order_relaxed);
+        }
+        Ring *grow(int64_t top, int64_t bottom) const
+        {
+            auto ring = new Ring(capacity() * 2);
+            for (int64_t i = top; i < bottom; i++) ring->put(i, get(i));
+            return ring;
+        }
+
+        int64_t                           mMask;
+        std::unique_ptr<std::atomic<T>[]> mData;
+    };
+
+    std::atomic<int64_t> mTop{0};
+    std::atomic<int64_t> mBottom{0};
+    std::atomic<Ring *>  mRing{nullptr};
+    // a stealer may still read from a ring that was replaced by grow(),
+    // so the old rings are only released with the deque.
+    std::vector<std::unique_ptr<Ring>> mRings;
 
 public:
-    bool try_pop(Task &task)
+    WorkStealingDeque()
+    {
+        mRings.emplace_back(new Ring(64));
+        mRing.store(mRings.back().get(), std::memory_order_relaxed);
+    }
+
+    void push(T v)
     {
-        lock_t lock{_mutex, std::try_to_lock};
-        if (!lock || _q.empty()) return false;
-        task = std::move(_q.front());
-        _q.pop_front();
+        int64_t b = mBottom.load(std::memory_order_relaxed);
+        int64_t t = mTop.load(std::memory_order_acquire);
+        Ring *  ring = mRing.load(std::memory_order_relaxed);
+        if (b - t > ring->capacity() - 1) {
+            mRings.emplace_back(ring->grow(t, b));
+            ring = mRings.back().get();
+            mRing.store(ring, std::memory_order_release);
+        }
+        ring->put(b, v);
+        mBottom.store(b + 1, std::memory_order_release);
+    }
+
+    bool pop(T &v)
+    {
+        int64_t b = mBottom.load(std::memory_order_relaxed) - 1;
+        Ring *  ring = mRing.load(std::memory_order_relaxed);
+        mBottom.store(b, std::memory_order_seq_cst);
+        int64_t t = mTop.load(std::memory_order_seq_cst);
+        if (t > b) {
+            mBottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        v = ring->get(b);
+        if (t != b) return true;
+
+        // last element, race against the stealers for it.
+        bool won = mTop.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        mBottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+
+    bool steal(T &v)
+    {
+        int64_t t = mTop.load(std::memory_order_seq_cst);
+        int64_t b = mBottom.load(std::memory_order_seq_cst);
+        if (t >= b) return false;
+        Ring *ring = mRing.load(std::memory_order_acquire);
+        v = ring->get(t);
+        return mTop.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+};
+
+/*
+ * Bounded multi producer multi consumer queue of pointers for the tasks
+ * that are pushed from outside of the pool. Every cell carries a sequence
+ * number so producers and consumers only contend on their own counters.
+ * If the ring is full the task goes to a locked overflow list.
+ */
+template <typename T>
+class InjectionQueue {
+    struct Cell {
+        std::atomic<size_t> mSeq;
+        T                   mData;
+    };
+    static constexpr size_t Capacity = 4096;
+
+    std::unique_ptr<Cell[]> mCells{new Cell[Capacity]};
+    std::atomic<size_t>     mHead{0};
+    std::atomic<size_t>     mTail{0};
+    std::mutex              mMutex;
+    std::deque<T>           mOverflow;
+    std::atomic<size_t>     mOverflowSize{0};
+
+public:
+    InjectionQueue()
+    {
+        for (size_t i = 0; i < Capacity; i++)
+            mCells[i].mSeq.store(i, std::memory_order_relaxed);
+    }
+
+    void push(T v)
+    {
+        size_t pos = mTail.load(std::memory_order_relaxed);
+        while (true) {
+            Cell & cell = mCells[pos & (Capacity - 1)];
+            size_t seq = cell.mSeq.load(std::memory_order_acquire);
+            if (seq == pos) {
+                if (mTail.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+                    cell.mData = v;
+                    cell.mSeq.store(pos + 1, std::memory_order_release);
+                    return;
+                }
+            } else if (seq < pos) {
+                // full.
+                std::lock_guard<std::mutex> lock(mMutex);
+                mOverflow.push_back(v);
+                mOverflowSize.fetch_add(1, std::memory_order_release);
+                return;
+            } else {
+                pos = mTail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(T &v)
+    {
+        size_t pos = mHead.load(std::memory_order_relaxed);
+        while (true) {
+            Cell & cell = mCells[pos & (Capacity - 1)];
+            size_t seq = cell.mSeq.load(std::memory_order_acquire);
+            if (seq == pos + 1) {
+                if (mHead.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+                    v = cell.mData;
+                    cell.mSeq.store(pos + Capacity, std::memory_order_release);
+                    return true;
+                }
+            } else if (seq < pos + 1) {
+                // empty.
+                break;
+            } else {
+                pos = mHead.load(std::memory_order_relaxed);
+            }
+        }
+
+        if (!mOverflowSize.load(std::memory_order_acquire)) return false;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mOverflow.empty()) return false;
+        v = mOverflow.front();
+        mOverflow.pop_front();
+        mOverflowSize.fetch_sub(1, std::memory_order_relaxed);
         return true;
     }
+};
 
-    bool try_push(Task &&task)
+/*
+ * Thread pool with one work stealing deque per worker.
+ * Tasks pushed by a worker go to its own deque, tasks pushed from any
+ * other thread go to the shared injection queue. An idle worker first
+ * pops its own deque, then the injection queue and then tries to steal
+ * from the other workers before it parks. Pushers only touch the
+ * condition variable when some worker is actually parked.
+ */
+template <typename Task>
+class TaskScheduler {
+    struct Worker {
+        WorkStealingDeque<Task *> mDeque;
+        std::vector<Task *>       mFree;  // nodes only this worker touches
+    };
+    struct Slot {
+        const void *mOwner{nullptr};
+        unsigned    mIndex{0};
+    };
+
+    static constexpr size_t maxFree = 64;
+    static constexpr size_t maxSpare = 256;
+
+    const unsigned              mCount;
+    std::vector<Worker>         mWorkers;
+    std::vector<std::thread>    mThreads;
+    InjectionQueue<Task *>      mInjector;
+    InjectionQueue<Task *>      mSpare;  // nodes of finished tasks
+    std::atomic<size_t>         mSpareCount{0};
+    std::atomic<int64_t>        mQueued{0};
+    std::atomic<unsigned>       mSleepers{0};
+    std::atomic<unsigned>       mEpoch{0};
+    std::atomic<bool>           mStop{false};
+    std::mutex                  mMutex;
+    std::condition_variable     mWake;
+
+    static Slot &current()
+    {
+        static thread_local Slot slot;
+        return slot;
+    }
+
+    bool find(unsigned i, Task *&node)
+    {
+        if (mWorkers[i].mDeque.pop(node)) return true;
+        if (mInjector.pop(node)) return true;
+        for (unsigned n = 1; n < mCount; n++) {
+            if (mWorkers[(i + n) % mCount].mDeque.steal(node)) return true;
+        }
+        return false;
+    }
+
+    /*
+     * the queues hold pointers, the nodes are reused so a push does not
+     * allocate once the pool is warm. a worker keeps the nodes of the tasks
+     * it ran in its own free list and only shares the surplus through the
+     * spare queue, where the threads outside of the pool pick them up.
+     */
+    Task *makeNode(Task &&task, Worker *worker)
+    {
+        Task *node;
+        if (worker && !worker->mFree.empty()) {
+            node = worker->mFree.back();
+            worker->mFree.pop_back();
+        } else if (mSpare.pop(node)) {
+            mSpareCount.fetch_sub(1, std::memory_order_relaxed);
+        } else {
+            return new Task(std::move(task));
+        }
+        *node = std::move(task);
+        return node;
+    }
+
+    void recycle(Task *node, Worker &worker)
     {
+        *node = Task();
+        if (worker.mFree.size() < maxFree) {
+            worker.mFree.push_back(node);
+        } else if (mSpareCount.fetch_add(1, std::memory_order_relaxed) <
+                   maxSpare) {
+            mSpare.push(node);
+        } else {
+            mSpareCount.fetch_sub(1, std::memory_order_relaxed);
+            delete node;
+        }
+    }
+
+    // returns false once the scheduler is stopped.
+    bool park()
+    {
+        unsigned epoch = mEpoch.load();
+        mSleepers.fetch_add(1);
+        if (mStop.load()) {
+            mSleepers.fetch_sub(1);
+            return false;
+        }
+        if (mQueued.load() > 0) {
+            // a task is on its way, don't go to sleep.
+            mSleepers.fetch_sub(1);
+            std::this_thread::yield();
+            return true;
+        }
         {
-            lock_t lock{_mutex, std::try_to_lock};
-            if (!lock) return false;
-            _q.push_back(std::move(task));
+            std::unique_lock<std::mutex> lock(mMutex);
+            while (mEpoch.load() == epoch && !mStop.load()) mWake.wait(lock);
         }
-        _ready.notify_one();
+        mSleepers.fetch_sub(1);
         return true;
     }
 
-    void done()
+public:
+    explicit TaskScheduler(
+        unsigned count = std::thread::hardware_concurrency())
+        : mCount(count ? count : 1), mWorkers(mCount)
     {
-        {
-            lock_t lock{_mutex};
-            _done = true;
+        for (auto &worker : mWorkers) worker.mFree.reserve(maxFree);
+    }
+
+    ~TaskScheduler()
+    {
+        stop();
+        Task *node;
+        for (auto &worker : mWorkers) {
+            while (worker.mDeque.pop(node)) delete node;
+            for (auto free : worker.mFree) delete free;
         }
-        _ready.notify_all();
+        while (mInjector.pop(node)) delete node;
+        while (mSpare.pop(node)) delete node;
     }
 
-    bool pop(Task &task)
+    TaskScheduler(const TaskScheduler &) = delete;
+    TaskScheduler &operator=(const TaskScheduler &) = delete;
+
+    unsigned concurrency() const { return mCount; }
+
+    /*
+     * starts the worker threads. each of them calls worker(index) which
+     * is expected to run next() in a loop, so it can keep its own per
+     * thread state around the loop.
+     */
+    template <typename WorkerFunc>
+    void start(WorkerFunc worker)
     {
-        lock_t lock{_mutex};
-        while (_q.empty() && !_done) _ready.wait(lock);
-        if (_q.empty()) return false;
-        task = std::move(_q.front());
-        _q.pop_front();
-        return true;
+        for (unsigned n = 0; n != mCount; ++n) {
+            mThreads.emplace_back([this, worker, n] {
+                current() = {this, n};
+                worker(n);
+            });
+        }
     }
 
-    void push(Task &&task)
+    void stop()
     {
+        if (mStop.exchange(true)) return;
         {
-            lock_t lock{_mutex};
-            _q.push_back(std::move(task));
+            std::lock_guard<std::mutex> lock(mMutex);
+            mEpoch.fetch_add(1);
         }
-        _ready.notify_one();
+        mWake.notify_all();
+        for (auto &e : mThreads) e.join();
     }
 
+    void push(Task &&task)
+    {
+        auto &slot = current();
+        auto  worker = slot.mOwner == this ? &mWorkers[slot.mIndex] : nullptr;
+        auto  node = makeNode(std::move(task), worker);
+
+        mQueued.fetch_add(1);
+        if (worker)
+            worker->mDeque.push(node);
+        else
+            mInjector.push(node);
+
+        if (mSleepers.load() > 0) {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mEpoch.fetch_add(1);
+            }
+            mWake.notify_one();
+        }
+    }
+
+    // waits for the next task, returns false once the scheduler is stopped.
+    bool next(unsigned i, Task &task)
+    {
+        Task *node;
+        while (!find(i, node)) {
+            if (!park()) return false;
+        }
+        mQueued.fetch_sub(1);
+        task = std::move(*node);
+        recycle(node, mWorkers[i]);
+        return true;
+    }
 };
 
 #endif  // VTASKQUEUE_H
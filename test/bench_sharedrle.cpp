@@ -0,0 +1,117 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "vsharedrle.h"
+
+/*
+ * Cost of handing the rles of a frame from the thread that generates them
+ * to their owner, SharedRle against a mutex and condition variable per rle.
+ *
+ * Usage : ./sharedRleBench [rles per frame]
+ *
+ * Built with the tests, configure with -DLOTTIE_TEST=ON and
+ * -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+
+// the mutex and condition variable per rle that SharedRle replaced.
+class CondvarRle {
+public:
+    void notify()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _ready = true;
+        }
+        _cv.notify_one();
+    }
+    void wait()
+    {
+        if (!_pending) return;
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (!_ready) _cv.wait(lock);
+        }
+
+        _pending = false;
+    }
+    VRle &get()
+    {
+        wait();
+        return _rle;
+    }
+    void reset()
+    {
+        wait();
+        _ready = false;
+        _pending = true;
+    }
+
+private:
+    VRle                    _rle;
+    std::mutex              _mutex;
+    std::condition_variable _cv;
+    bool                    _ready{true};
+    bool                    _pending{false};
+};
+
+using Clock = std::chrono::steady_clock;
+static const int frames = 20000;
+
+// the owner generates every rle itself: reset, notify and get.
+template <typename Rle>
+static double ownerFrame(size_t count)
+{
+    std::vector<Rle> rles(count);
+    auto             start = Clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        for (auto &rle : rles) rle.reset();
+        for (auto &rle : rles) rle.notify();
+        for (auto &rle : rles) rle.get();
+    }
+    std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+    return elapsed.count() / frames;
+}
+
+// a worker thread generates the rles while the owner waits for them.
+template <typename Rle>
+static double workerFrame(size_t count)
+{
+    std::vector<Rle> rles(count);
+    std::atomic<int> requested{-1};
+    std::thread      worker([&]() {
+        for (int frame = 0; frame < frames; frame++) {
+            while (requested.load(std::memory_order_acquire) != frame)
+                std::this_thread::yield();
+            for (auto &rle : rles) rle.notify();
+        }
+    });
+
+    auto start = Clock::now();
+    for (int frame = 0; frame < frames; frame++) {
+        for (auto &rle : rles) rle.reset();
+        requested.store(frame, std::memory_order_release);
+        for (auto &rle : rles) rle.get();
+    }
+    std::chrono::duration<double, std::micro> elapsed = Clock::now() - start;
+    worker.join();
+    return elapsed.count() / frames;
+}
+
+int main(int argc, char **argv)
+{
+    size_t count = argc > 1 ? size_t(atoi(argv[1])) : 300;
+
+    printf("%zu rles per frame (us per frame)\n", count);
+    printf("  %-22s %12s %12s\n", "", "condvar", "SharedRle");
+    printf("  %-22s %12.2f %12.2f\n", "owner generates",
+           ownerFrame<CondvarRle>(count), ownerFrame<SharedRle>(count));
+    printf("  %-22s %12.2f %12.2f\n", "worker generates",
+           workerFrame<CondvarRle>(count), workerFrame<SharedRle>(count));
+    return 0;
+}
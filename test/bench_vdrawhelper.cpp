@@ -0,0 +1,178 @@
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+#include "vdrawhelper.h"
+
+/*
+ * Throughput of the span kernels of RenderFuncTable for every instruction
+ * set the cpu supports, in nanoseconds per pixel over 512 pixel spans.
+ *
+ * Usage : ./drawHelperBench
+ *
+ * Built with the tests, configure with -DLOTTIE_TEST=ON and
+ * -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+
+using Simd = RenderFuncTable::Simd;
+
+static const int spanLength = 512;
+
+static const char *simdName(Simd simd)
+{
+    switch (simd) {
+    case Simd::None: return "scalar";
+    case Simd::Neon: return "neon";
+    case Simd::Sse2: return "sse2";
+    case Simd::Sse4: return "sse4";
+    case Simd::Avx2: return "avx2";
+    case Simd::Avx512: return "avx512";
+    }
+    return "";
+}
+
+// the instruction sets a table can be built from on this cpu.
+static std::vector<Simd> simds()
+{
+    auto supported = RenderFuncTable::supportedSimd();
+    if (supported == Simd::Neon) return {Simd::None, Simd::Neon};
+
+    std::vector<Simd> result{Simd::None};
+    for (auto simd : {Simd::Sse2, Simd::Sse4, Simd::Avx2, Simd::Avx512})
+        if (simd <= supported) result.push_back(simd);
+    return result;
+}
+
+// runs the span function until about 50ms passed, returns ns per pixel.
+static double measure(const std::function<void()> &span)
+{
+    using clock = std::chrono::steady_clock;
+    size_t iterations = 0;
+    auto   start = clock::now();
+    std::chrono::duration<double, std::nano> elapsed{0};
+    do {
+        for (int i = 0; i < 100; i++) span();
+        iterations += 100;
+        elapsed = clock::now() - start;
+    } while (elapsed.count() < 50e6);
+    return elapsed.count() / (double(iterations) * spanLength);
+}
+
+static void report(const char *name, const std::function<double(Simd)> &run)
+{
+    printf("  %-28s", name);
+    for (auto simd : simds()) printf(" %8.3f", run(simd));
+    printf("\n");
+}
+
+static void header(const char *title)
+{
+    printf("\n%s (ns per pixel)\n  %-28s", title, "");
+    for (auto simd : simds()) printf(" %8s", simdName(simd));
+    printf("\n");
+}
+
+static void benchBlend()
+{
+    // mix of transparent, opaque and translucent pixels.
+    std::mt19937          gen(7);
+    std::vector<uint32_t> src(spanLength);
+    std::vector<uint32_t> dest(spanLength);
+    for (auto &pixel : src) {
+        uint32_t alpha = (gen() % 3) ? gen() % 256 : 255 * (gen() % 2);
+        pixel = alpha << 24 | (gen() & 0xffffff);
+    }
+
+    const struct {
+        const char *name;
+        BlendMode   mode;
+    } modes[] = {{"Src", BlendMode::Src},
+                 {"SrcOver", BlendMode::SrcOver},
+                 {"DestIn", BlendMode::DestIn},
+                 {"DestOut", BlendMode::DestOut}};
+
+    header("blend");
+    char name[64];
+    for (uint32_t alpha : {255u, 128u}) {
+        for (auto &m : modes) {
+            snprintf(name, sizeof(name), "src %s alpha %u", m.name, alpha);
+            report(name, [&](Simd simd) {
+                RenderFuncTable table(simd);
+                return measure([&]() {
+                    table.src(m.mode)(dest.data(), spanLength, src.data(),
+                                      alpha);
+                });
+            });
+        }
+        for (auto &m : modes) {
+            snprintf(name, sizeof(name), "color %s alpha %u", m.name, alpha);
+            report(name, [&](Simd simd) {
+                RenderFuncTable table(simd);
+                return measure([&]() {
+                    table.color(m.mode)(dest.data(), spanLength, 0x80402010,
+                                        alpha);
+                });
+            });
+        }
+    }
+}
+
+static void benchGradient()
+{
+    std::vector<uint32_t> dest(spanLength);
+    std::vector<uint32_t> colorTable(VGradient::colorTableSize);
+    for (size_t i = 0; i < colorTable.size(); i++)
+        colorTable[i] = 0xff000000 | uint32_t(i * 0x010101);
+
+    VGradientData gradient;
+    gradient.mColorTable = colorTable.data();
+    gradient.radial.fradius = 0.25f;
+
+    const struct {
+        const char *      name;
+        VGradient::Spread spread;
+    } spreads[] = {{"pad", VGradient::Spread::Pad},
+                   {"repeat", VGradient::Spread::Repeat},
+                   {"reflect", VGradient::Spread::Reflect}};
+
+    header("gradient fetch");
+    char name[64];
+    for (auto &s : spreads) {
+        gradient.mSpread = s.spread;
+        snprintf(name, sizeof(name), "linear %s", s.name);
+        report(name, [&](Simd simd) {
+            RenderFuncTable table(simd);
+            return measure([&]() {
+                // crosses the ends of the table a few times.
+                table.linearGradient()(dest.data(), spanLength, &gradient,
+                                       -70000, 1500);
+            });
+        });
+    }
+    for (bool extended : {false, true}) {
+        for (auto &s : spreads) {
+            gradient.mSpread = s.spread;
+            RadialGradientValues v{};
+            v.dr = -0.1f;
+            v.extended = extended;
+            snprintf(name, sizeof(name), "radial %s%s", s.name,
+                     extended ? " extended" : "");
+            report(name, [&](Simd simd) {
+                RenderFuncTable table(simd);
+                return measure([&]() {
+                    table.radialGradient()(dest.data(), spanLength,
+                                           &gradient, &v, 0.3f, 0.01f,
+                                           0.0005f, -0.2f, 0.02f);
+                });
+            });
+        }
+    }
+}
+
+int main()
+{
+    benchBlend();
+    benchGradient();
+    return 0;
+}
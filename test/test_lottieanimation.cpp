@@ -1,6 +1,51 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <thread>
+#include <vector>
 #include "rlottie.h"
 
+// counts the heap allocations of the process while a test looks at them.
+static std::atomic<bool>   countAllocations{false};
+static std::atomic<size_t> allocations{0};
+
+// GCC pairs the replaced operator new with the std::free() it finds once
+// the replaced operator delete is inlined.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void *operator new(size_t size)
+{
+    if (countAllocations.load(std::memory_order_relaxed)) allocations++;
+    void *ptr = std::malloc(size ? size : 1);
+    if (!ptr) std::abort();
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
 class AnimationTest : public ::testing::Test {
 public:
     void SetUp()
@@ -32,3 +77,626 @@ TEST_F(AnimationTest, loadFromFile) {
     ASSERT_EQ(width, 500);
     ASSERT_EQ(height, 500);
 }
+
+TEST_F(AnimationTest, renderBands) {
+    std::string filePath = DEMO_DIR;
+    filePath +="matte_two_item_with_lowerlayer.json";
+    auto single = rlottie::Animation::loadFromFile(filePath);
+    auto banded = rlottie::Animation::loadFromFile(filePath);
+    ASSERT_TRUE(single && banded);
+    banded->setRenderBands(4);
+
+    size_t width = 200, height = 260;
+    std::vector<uint32_t> expected(width * height);
+    std::vector<uint32_t> result(width * height);
+    for (size_t frame = 0; frame < single->totalFrame(); frame += 5) {
+        rlottie::Surface s1(expected.data(), width, height, width * 4);
+        rlottie::Surface s2(result.data(), width, height, width * 4);
+        s1.setDrawRegion(10, 20, 180, 200);
+        s2.setDrawRegion(10, 20, 180, 200);
+        single->renderSync(frame, s1);
+        banded->renderSync(frame, s2);
+        ASSERT_EQ(expected, result);
+    }
+}
+
+TEST_F(AnimationTest, renderTreeAndBands) {
+    // the render tree and the band painters share the drawable list of
+    // a shape layer, building one must not break the other.
+    std::string filePath = DEMO_DIR;
+    filePath +="1643-exploding-star.json";
+    auto single = rlottie::Animation::loadFromFile(filePath);
+    auto banded = rlottie::Animation::loadFromFile(filePath);
+    ASSERT_TRUE(single && banded);
+    banded->setRenderBands(4);
+
+    size_t width = 200, height = 200;
+    std::vector<uint32_t> expected(width * height);
+    std::vector<uint32_t> result(width * height);
+    for (size_t frame = 1; frame < single->totalFrame(); frame += 7) {
+        rlottie::Surface s1(expected.data(), width, height, width * 4);
+        rlottie::Surface s2(result.data(), width, height, width * 4);
+        single->renderSync(frame, s1);
+        banded->renderTree(frame - 1, width, height);
+        banded->renderSync(frame, s2);
+        ASSERT_EQ(expected, result);
+        ASSERT_TRUE(banded->renderTree(frame, width, height));
+    }
+}
+
+TEST_F(AnimationTest, renderRange) {
+    size_t width = 100, height = 100;
+    size_t frames = animation->totalFrame();
+    std::vector<uint32_t> expected(width * height * frames);
+    std::vector<uint32_t> result(width * height * frames);
+    for (size_t frame = 0; frame < frames; frame++) {
+        rlottie::Surface surface(expected.data() + frame * width * height,
+                                 width, height, width * 4);
+        animation->renderSync(frame, surface);
+    }
+    animation->renderRange(0, frames - 1, [&](size_t frame) {
+        return rlottie::Surface(result.data() + frame * width * height,
+                                width, height, width * 4);
+    });
+    ASSERT_EQ(expected, result);
+}
+
+TEST_F(AnimationTest, renderRangeOverrides) {
+    std::string filePath = DEMO_DIR;
+    filePath +="1643-exploding-star.json";
+    auto single = rlottie::Animation::loadFromFile(filePath, false);
+    auto ranged = rlottie::Animation::loadFromFile(filePath, false);
+    ASSERT_TRUE(single && ranged);
+
+    // a value set over and over, then a narrower keypath overridden by
+    // setting the wider one again. the second render tree of renderRange()
+    // has to end up with the same overrides as the first.
+    for (auto animation : {single.get(), ranged.get()}) {
+        for (int i = 0; i < 100; i++)
+            animation->setValue<rlottie::Property::FillOpacity>(
+                "**", float(i));
+        animation->setValue<rlottie::Property::FillColor>(
+            "**", rlottie::Color(1, 0, 0));
+        animation->setValue<rlottie::Property::FillColor>(
+            "etoile Silhouettes.**", rlottie::Color(0, 0, 1));
+        animation->setValue<rlottie::Property::FillColor>(
+            "**", rlottie::Color(1, 1, 0));
+    }
+
+    size_t width = 100, height = 100, frames = 20;
+    std::vector<uint32_t> expected(width * height * frames);
+    std::vector<uint32_t> result(width * height * frames);
+    for (size_t frame = 0; frame < frames; frame++) {
+        rlottie::Surface surface(expected.data() + frame * width * height,
+                                 width, height, width * 4);
+        single->renderSync(frame, surface);
+    }
+    ranged->renderRange(0, frames - 1, [&](size_t frame) {
+        return rlottie::Surface(result.data() + frame * width * height,
+                                width, height, width * 4);
+    });
+    ASSERT_EQ(expected, result);
+}
+
+TEST_F(AnimationTest, frameCache) {
+    rlottie::configureFrameCacheSize(1024 * 1024);
+
+    std::string filePath = DEMO_DIR;
+    filePath +="1643-exploding-star.json";
+    auto first = rlottie::Animation::loadFromFile(filePath);
+    auto second = rlottie::Animation::loadFromFile(filePath);
+    auto colored = rlottie::Animation::loadFromFile(filePath);
+    ASSERT_TRUE(first && second && colored);
+    colored->setValue<rlottie::Property::FillColor>("**",
+                                                    rlottie::Color(0, 1, 0));
+
+    size_t width = 100, height = 100;
+    std::vector<uint32_t> expected(width * height);
+    std::vector<uint32_t> result(width * height, 0xffffffff);
+    rlottie::Surface s1(expected.data(), width, height, width * 4);
+    rlottie::Surface s2(result.data(), width, height, width * 4);
+    first->renderSync(10, s1);
+    second->renderSync(10, s2);
+    ASSERT_EQ(expected, result);
+
+    // overrides must not pick up the frame rendered without them.
+    colored->renderSync(10, s2);
+    ASSERT_NE(expected, result);
+
+    // frames are keyed by the cached model, without it nothing is reused.
+    if (!rlottie::modelCacheStats().enabled) {
+        rlottie::configureFrameCacheSize(0);
+        return;
+    }
+
+    // a cached frame only fills its draw region, the other tiles of an
+    // atlas stay as they are.
+    std::vector<uint32_t> atlas(width * 2 * height);
+    rlottie::Surface tile(atlas.data(), width * 2, height, width * 8);
+    tile.setDrawRegion(width, 0, width, height);
+    first->renderSync(20, tile);
+    auto rendered = atlas;
+    for (size_t y = 0; y < height; y++)
+        std::fill_n(atlas.begin() + y * width * 2, width, 0xff00ff00);
+    second->renderSync(20, tile);
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width * 2; x++) {
+            auto i = y * width * 2 + x;
+            ASSERT_EQ(atlas[i], x < width ? 0xff00ff00 : rendered[i]);
+        }
+    }
+
+    // a frame rendered with one image quality is not reused for the other.
+    filePath = DEMO_DIR;
+    filePath +="image_embedded.json";
+    auto fast = rlottie::Animation::loadFromFile(filePath);
+    auto smooth = rlottie::Animation::loadFromFile(filePath);
+    auto reference = rlottie::Animation::loadFromFile(filePath, false);
+    ASSERT_TRUE(fast && smooth && reference);
+    smooth->setImageQuality(rlottie::ImageQuality::Smooth);
+    reference->setImageQuality(rlottie::ImageQuality::Smooth);
+    reference->renderSync(30, s1);
+    // nothing to compare when the image loader is not available.
+    if (std::all_of(expected.begin(), expected.end(),
+                    [](uint32_t pixel) { return pixel == 0; })) {
+        rlottie::configureFrameCacheSize(0);
+        return;
+    }
+    fast->renderSync(30, s2);
+    ASSERT_NE(expected, result);
+    smooth->renderSync(30, s2);
+    ASSERT_EQ(expected, result);
+
+    rlottie::configureFrameCacheSize(0);
+}
+
+TEST_F(AnimationTest, modelCache) {
+    std::string filePath = DEMO_DIR;
+    filePath +="done.json";
+
+    rlottie::trimModelCache(0);
+    auto before = rlottie::modelCacheStats();
+    ASSERT_EQ(before.entries, 0);
+    ASSERT_EQ(before.bytes, 0);
+
+    auto first = rlottie::Animation::loadFromFile(filePath);
+    auto second = rlottie::Animation::loadFromFile(filePath);
+    ASSERT_TRUE(first && second);
+
+    auto stats = rlottie::modelCacheStats();
+    if (!before.enabled) {
+        // built without the cache, both files are parsed and nothing kept.
+        ASSERT_EQ(stats.entries, 0);
+        ASSERT_EQ(stats.hits, 0);
+        ASSERT_EQ(stats.misses, 0);
+        return;
+    }
+
+    ASSERT_EQ(stats.entries, 1);
+    ASSERT_GT(stats.bytes, 0);
+    ASSERT_EQ(stats.misses, before.misses + 1);
+    ASSERT_EQ(stats.hits, before.hits + 1);
+
+    // a budget smaller than the model evicts it.
+    rlottie::configureModelCacheMemory(stats.bytes - 1);
+    stats = rlottie::modelCacheStats();
+    ASSERT_EQ(stats.entries, 0);
+    ASSERT_EQ(stats.evictions, before.evictions + 1);
+
+    rlottie::configureModelCacheMemory(std::numeric_limits<size_t>::max());
+}
+
+TEST_F(AnimationTest, imageCache) {
+    std::string filePath = DEMO_DIR;
+    filePath +="image_embedded.json";
+
+    size_t width = 100, height = 100;
+    std::vector<uint32_t> expected(width * height);
+    std::vector<uint32_t> result(width * height);
+    rlottie::Surface s1(expected.data(), width, height, width * 4);
+    rlottie::Surface s2(result.data(), width, height, width * 4);
+
+    // without the cache every animation decodes its own copy.
+    rlottie::configureImageCacheSize(0);
+    auto first = rlottie::Animation::loadFromFile(filePath);
+    ASSERT_TRUE(first != nullptr);
+    first->renderSync(0, s1);
+
+    rlottie::configureImageCacheSize(64 * 1024 * 1024);
+    auto second = rlottie::Animation::loadFromFile(filePath);
+    auto third = rlottie::Animation::loadFromFile(filePath);
+    ASSERT_TRUE(second && third);
+    second->renderSync(0, s2);
+    ASSERT_EQ(expected, result);
+    third->renderSync(0, s2);
+    ASSERT_EQ(expected, result);
+}
+
+TEST_F(AnimationTest, surfaceCache) {
+    // solid alpha mattes are clipped without offscreen surfaces.
+    std::string filePath = DEMO_DIR;
+    filePath +="mughead.json";
+    auto first = rlottie::Animation::loadFromFile(filePath);
+    auto second = rlottie::Animation::loadFromFile(filePath);
+    ASSERT_TRUE(first && second);
+
+    size_t width = 100, height = 100;
+    std::vector<uint32_t> expected(width * height);
+    std::vector<uint32_t> result(width * height);
+    rlottie::Surface s1(expected.data(), width, height, width * 4);
+    rlottie::Surface s2(result.data(), width, height, width * 4);
+
+    // the second animation reuses the matte surfaces of the first one.
+    rlottie::trimSurfaceCache(0);
+    first->renderSync(0, s1);
+    auto before = rlottie::surfaceCacheStats();
+    ASSERT_GT(before.entries, 0);
+    second->renderSync(0, s2);
+    ASSERT_EQ(expected, result);
+    auto stats = rlottie::surfaceCacheStats();
+    ASSERT_GT(stats.hits, before.hits);
+    ASSERT_EQ(stats.misses, before.misses);
+    ASSERT_EQ(stats.inUse, 0);
+
+    // without a budget no surface is kept.
+    rlottie::configureSurfaceCacheSize(0);
+    stats = rlottie::surfaceCacheStats();
+    ASSERT_EQ(stats.entries, 0);
+    ASSERT_EQ(stats.bytes, 0);
+    second->renderSync(0, s2);
+    ASSERT_EQ(expected, result);
+    ASSERT_EQ(rlottie::surfaceCacheStats().bytes, 0);
+    rlottie::configureSurfaceCacheSize(32 * 1024 * 1024);
+}
+
+TEST_F(AnimationTest, rleCache) {
+    std::string filePath = DEMO_DIR;
+    filePath +="1643-exploding-star.json";
+    auto reference = rlottie::Animation::loadFromFile(filePath);
+    auto first = rlottie::Animation::loadFromFile(filePath);
+    auto second = rlottie::Animation::loadFromFile(filePath);
+    ASSERT_TRUE(reference && first && second);
+
+    size_t width = 100, height = 100;
+    std::vector<uint32_t> expected(width * height);
+    std::vector<uint32_t> result(width * height);
+    rlottie::Surface s1(expected.data(), width, height, width * 4);
+    rlottie::Surface s2(result.data(), width, height, width * 4);
+    for (size_t frame = 0; frame < reference->totalFrame(); frame += 5) {
+        rlottie::configureRleCacheSize(0);
+        reference->renderSync(frame, s1);
+
+        // the second instance picks up the shapes of the first one.
+        rlottie::configureRleCacheSize(8 * 1024 * 1024);
+        first->renderSync(frame, s2);
+        ASSERT_EQ(expected, result);
+        second->renderSync(frame, s2);
+        ASSERT_EQ(expected, result);
+    }
+}
+
+// a closed polygon around (50, 50) with radius 40, filled red or stroked blue.
+static std::string polygonJson(int vertices, bool stroke)
+{
+    std::string v, t;
+    char buf[64];
+    for (int i = 0; i < vertices; i++) {
+        double angle = 2 * M_PI * i / vertices;
+        snprintf(buf, sizeof(buf), "%s[%.3f,%.3f]", i ? "," : "",
+                 50 + 40 * std::cos(angle), 50 + 40 * std::sin(angle));
+        v += buf;
+        t += i ? ",[0,0]" : "[0,0]";
+    }
+    std::string paint =
+        stroke ? R"({"ty":"st","c":{"a":0,"k":[0,0,1,1]},"o":{"a":0,"k":100},)"
+                 R"("w":{"a":0,"k":4},"lc":1,"lj":1})"
+               : R"({"ty":"fl","c":{"a":0,"k":[1,0,0,1]},"o":{"a":0,"k":100}})";
+    return R"({"v":"5.5.2","fr":30,"ip":0,"op":1,"w":100,"h":100,"layers":[)"
+           R"({"ty":4,"ind":1,"ip":0,"op":1,"st":0,"ks":{},"shapes":[)"
+           R"({"ty":"sh","ks":{"a":0,"k":{"c":true,"v":[)" +
+           v + R"(],"i":[)" + t + R"(],"o":[)" + t + "]}}}," + paint +
+           "]}]}";
+}
+
+TEST_F(AnimationTest, largePath) {
+    // every vertex is a cubic, the outline has more than SHRT_MAX points.
+    auto fill = rlottie::Animation::loadFromData(polygonJson(12000, false),
+                                                 "large_fill");
+    auto stroke = rlottie::Animation::loadFromData(polygonJson(12000, true),
+                                                   "large_stroke");
+    ASSERT_TRUE(fill && stroke);
+
+    size_t width = 100, height = 100;
+    std::vector<uint32_t> buffer(width * height);
+    rlottie::Surface surface(buffer.data(), width, height, width * 4);
+    fill->renderSync(0, surface);
+    ASSERT_EQ(buffer[50 * width + 50], 0xffff0000);
+    stroke->renderSync(0, surface);
+    ASSERT_EQ(buffer[50 * width + 90], 0xff0000ff);
+    ASSERT_EQ(buffer[50 * width + 50], 0);
+}
+
+TEST_F(AnimationTest, wideSurface) {
+    auto fill = rlottie::Animation::loadFromData(polygonJson(64, false),
+                                                 "wide_fill");
+    ASSERT_TRUE(fill);
+
+    // stretched from about x 4000 to 36000, past what 16 bit spans address.
+    size_t width = 40000, height = 100;
+    std::vector<uint32_t> buffer(width * height);
+    rlottie::Surface surface(buffer.data(), width, height, width * 4);
+    fill->renderSync(0, surface, false);
+
+    const uint32_t *row = buffer.data() + 50 * width;
+    for (size_t x = 0; x < 3000; x++) ASSERT_EQ(row[x], 0u) << x;
+    for (size_t x = 5000; x < 32000; x++) ASSERT_EQ(row[x], 0xffff0000) << x;
+    // the compact span layout leaves the rest unpainted, it never wraps.
+    for (size_t x = 32768; x < 35000; x++) {
+        ASSERT_TRUE(row[x] == 0 || row[x] == 0xffff0000) << x;
+        ASSERT_EQ(row[x], row[32768]) << x;
+    }
+}
+
+static std::string readFile(const std::string &path)
+{
+    std::ifstream f(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+}
+
+static void writeFile(const std::string &path, const std::string &data)
+{
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    f.write(data.data(), std::streamsize(data.size()));
+}
+
+static void putU32(std::string &data, size_t offset, uint32_t value)
+{
+    memcpy(&data[offset], &value, sizeof(value));
+}
+
+static std::string u32(uint32_t value)
+{
+    return std::string(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+TEST_F(AnimationTest, compiledModel) {
+    std::string binPath = "test_compiled_model.bin";
+    ASSERT_TRUE(animation->saveCompiled(binPath));
+
+    auto compiled = rlottie::Animation::loadCompiled(binPath, false);
+    ASSERT_TRUE(compiled != nullptr);
+    ASSERT_EQ(compiled->totalFrame(), animation->totalFrame());
+
+    size_t width = 100, height = 100;
+    std::vector<uint32_t> expected(width * height);
+    std::vector<uint32_t> result(width * height);
+    for (size_t frame = 0; frame < animation->totalFrame(); frame += 5) {
+        rlottie::Surface s1(expected.data(), width, height, width * 4);
+        rlottie::Surface s2(result.data(), width, height, width * 4);
+        animation->renderSync(frame, s1);
+        compiled->renderSync(frame, s2);
+        ASSERT_EQ(expected, result);
+    }
+    const auto model = readFile(binPath);
+
+    // a truncated file is rejected.
+    for (size_t size = 0; size < model.size(); size++) {
+        writeFile(binPath, model.substr(0, size));
+        ASSERT_FALSE(rlottie::Animation::loadCompiled(binPath, false))
+            << "size " << size;
+    }
+
+    // a flipped bit is either rejected or still renders.
+    for (size_t i = 0; i < model.size(); i++) {
+        for (int bit = 0; bit < 8; bit++) {
+            auto data = model;
+            data[i] = char(data[i] ^ (1 << bit));
+            writeFile(binPath, data);
+            auto flipped = rlottie::Animation::loadCompiled(binPath, false);
+            if (!flipped) continue;
+            size_t total = flipped->totalFrame();
+            for (size_t frame : {size_t(0), total / 2}) {
+                flipped->renderSync(frame, {result.data(), 10, 10, 40});
+            }
+        }
+    }
+    std::remove(binPath.c_str());
+
+    // json is not a compiled model.
+    std::string filePath = DEMO_DIR;
+    filePath +="mask.json";
+    ASSERT_FALSE(rlottie::Animation::loadCompiled(filePath, false));
+
+    filePath = DEMO_DIR;
+    filePath += "image_embedded.json";
+    auto image = rlottie::Animation::loadFromFile(filePath, false);
+    ASSERT_TRUE(image && image->saveCompiled(binPath));
+    const auto imageData = readFile(binPath);
+
+    // an image asset claiming more pixels than the file holds. the asset
+    // stores its key and ref id, the layer count, width and height before
+    // the flag of the decoded bitmap.
+    auto refId = imageData.find("image_0", imageData.find("image_0") + 1);
+    ASSERT_NE(refId, std::string::npos);
+    size_t valid = refId + 7 + 3 * 4;
+    auto data = imageData;
+    if (!data[valid]) {
+        data[valid] = 1;
+        data.insert(valid + 1, 9, '\0');
+        data[valid + 1] = 3;  // ARGB32_Premultiplied
+    }
+    putU32(data, valid + 2, 4000000);
+    putU32(data, valid + 6, 4000000);
+    data.append(4000000, '\0');
+    writeFile(binPath, data);
+    ASSERT_FALSE(rlottie::Animation::loadCompiled(binPath, false));
+
+    // a layer listing its own ancestor as a child. the root layer is the
+    // first object when no asset has layers, its first child the second.
+    size_t children = std::string::npos;
+    for (size_t i = 0; i + 9 < imageData.size(); i++) {
+        uint32_t id, nameSize, count, child;
+        memcpy(&id, &imageData[i], 4);
+        memcpy(&nameSize, &imageData[i + 5], 4);
+        // id, type, name, static and hidden flags, child count.
+        size_t at = i + 9 + nameSize + 2;
+        if (id != 1 || imageData[i + 4] != 2 /* Layer */ ||
+            at + 8 > imageData.size())
+            continue;
+        memcpy(&count, &imageData[at], 4);
+        memcpy(&child, &imageData[at + 4], 4);
+        if (count && child == 2) {
+            children = at;
+            break;
+        }
+    }
+    ASSERT_NE(children, std::string::npos);
+    data = imageData;
+    uint32_t count;
+    memcpy(&count, &data[children], 4);
+    putU32(data, children, count + 1);
+    data.insert(children + 4, u32(1));
+    writeFile(binPath, data);
+    ASSERT_FALSE(rlottie::Animation::loadCompiled(binPath, false));
+
+    std::remove(binPath.c_str());
+}
+
+TEST_F(AnimationTest, renderAtTime) {
+    size_t width = 100, height = 100;
+    std::vector<uint32_t> frame(width * height);
+    std::vector<uint32_t> next(width * height);
+    std::vector<uint32_t> between(width * height);
+    double fps = animation->frameRate();
+    size_t frameNo = 10;
+
+    animation->renderSync(frameNo, {frame.data(), width, height, width * 4});
+    animation->renderSync(frameNo + 1, {next.data(), width, height, width * 4});
+    animation->renderAtTimeSync(frameNo / fps,
+                                {between.data(), width, height, width * 4});
+    ASSERT_EQ(frame, between);
+
+    // half way in between the two frames matches neither of them.
+    animation->renderAtTimeSync((frameNo + 0.5) / fps,
+                                {between.data(), width, height, width * 4});
+    ASSERT_NE(frame, between);
+    ASSERT_NE(next, between);
+
+    // layers with a time stretch or remap are mapped to whole frames as
+    // before when the time is the one of a whole frame.
+    std::string filePath = DEMO_DIR;
+    filePath +="worm.json";
+    auto stretched = rlottie::Animation::loadFromFile(filePath, false);
+    ASSERT_TRUE(stretched);
+    fps = stretched->frameRate();
+    for (frameNo = 0; frameNo < stretched->totalFrame(); frameNo += 3) {
+        stretched->renderSync(frameNo,
+                              {frame.data(), width, height, width * 4});
+        stretched->renderAtTimeSync(
+            frameNo / fps, {between.data(), width, height, width * 4});
+        ASSERT_EQ(frame, between) << "frame " << frameNo;
+    }
+}
+
+// a 10x10 red square moving from x 0 to 200 over 200 frames inside a
+// precomp layer that plays at half speed.
+static const char *stretchedJson =
+    R"({"v":"5.5.2","fr":30,"ip":0,"op":60,"w":220,"h":20,)"
+    R"("assets":[{"id":"c","layers":[{"ty":4,"ind":1,"ip":0,"op":400,)"
+    R"("st":0,"ks":{"p":{"a":1,"k":[{"t":0,"s":[0,5,0],"e":[200,5,0],)"
+    R"("i":{"x":[1],"y":[1]},"o":{"x":[0],"y":[0]}},{"t":200}]}},)"
+    R"("shapes":[{"ty":"rc","p":{"a":0,"k":[5,5]},"s":{"a":0,"k":[10,10]},)"
+    R"("r":{"a":0,"k":0}},{"ty":"fl","c":{"a":0,"k":[1,0,0,1]},)"
+    R"("o":{"a":0,"k":100}}]}]}],)"
+    R"("layers":[{"ty":0,"ind":1,"refId":"c","sr":2,"ip":0,"op":120,)"
+    R"("st":0,"w":220,"h":20,"ks":{}}]})";
+
+TEST_F(AnimationTest, renderAtTimeMonotonic) {
+    auto stretched = rlottie::Animation::loadFromData(stretchedJson,
+                                                      "stretched_square");
+    ASSERT_TRUE(stretched);
+
+    size_t width = 220, height = 20;
+    std::vector<uint32_t> buffer(width * height);
+    rlottie::Surface surface(buffer.data(), width, height, width * 4);
+    double fps = stretched->frameRate();
+    double last = -1;
+    // the square never moves back, neither between nor at whole frames.
+    for (double frame = 0; frame < 60; frame += 0.25) {
+        stretched->renderAtTimeSync(frame / fps, surface);
+        const uint32_t *row = buffer.data() + 10 * width;
+        double sum = 0, weight = 0;
+        for (size_t x = 0; x < width; x++) {
+            double alpha = row[x] >> 24;
+            sum += alpha * x;
+            weight += alpha;
+        }
+        ASSERT_GT(weight, 0) << "frame " << frame;
+        double center = sum / weight;
+        ASSERT_GE(center, last - 1e-3) << "frame " << frame;
+        last = center;
+    }
+    ASSERT_GT(last, 20);
+}
+
+TEST_F(AnimationTest, renderIncremental) {
+    size_t width = 100, height = 100;
+    std::vector<uint32_t> full(width * height);
+    std::vector<uint32_t> incremental(width * height);
+    std::string filePath = DEMO_DIR;
+    filePath += "mask.json";
+    auto reference = rlottie::Animation::loadFromFile(filePath, false);
+    ASSERT_TRUE(reference);
+
+    for (size_t i = 0; i < animation->totalFrame(); i++) {
+        reference->renderSync(i, {full.data(), width, height, width * 4});
+        auto area = animation->renderIncremental(
+            i, {incremental.data(), width, height, width * 4});
+        if (i == 0) {
+            ASSERT_EQ(area.w() * area.h(), width * height);
+        }
+        ASSERT_EQ(full, incremental);
+    }
+
+    // the buffer already holds the last frame.
+    auto area = animation->renderIncremental(
+        animation->totalFrame() - 1,
+        {incremental.data(), width, height, width * 4});
+    ASSERT_TRUE(area.empty());
+}
+
+TEST_F(AnimationTest, steadyStateAllocations) {
+    size_t width = 100, height = 100;
+    std::vector<uint32_t> buffer(width * height);
+    rlottie::Surface surface(buffer.data(), width, height, width * 4);
+    std::string filePath = DEMO_DIR;
+    filePath += "tractor.json";
+    // admitting an rle to the cache allocates by design.
+    rlottie::configureRleCacheSize(0);
+    auto player = rlottie::Animation::loadFromFile(filePath, false);
+    ASSERT_TRUE(player);
+
+    // frames come at the display rate, the thread pool drains in between.
+    auto renderLoop = [&](bool count) {
+        for (size_t i = 0; i < player->totalFrame(); i++) {
+            countAllocations = count;
+            player->renderSync(i, surface);
+            countAllocations = false;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    };
+
+    // the first loops size the storage the following ones reuse.
+    renderLoop(false);
+    renderLoop(false);
+
+    // pooled storage still grows when the workers fall behind a frame
+    // for the first time, a loop after that doesn't allocate any more.
+    size_t loops = 0;
+    do {
+        allocations = 0;
+        renderLoop(true);
+    } while (allocations.load() && ++loops < 5);
+    rlottie::configureRleCacheSize(8 * 1024 * 1024);
+    ASSERT_EQ(allocations.load(), 0u);
+}
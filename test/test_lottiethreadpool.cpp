@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "rlottie.h"
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <fstream>
+
+// threads of the process whose name starts with prefix.
+static size_t namedThreads(const std::string &prefix)
+{
+    size_t count = 0;
+    DIR *  dir = opendir("/proc/self/task");
+    if (!dir) return 0;
+    while (auto entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') continue;
+        std::ifstream comm(std::string("/proc/self/task/") + entry->d_name +
+                           "/comm");
+        std::string   name;
+        std::getline(comm, name);
+        if (name.compare(0, prefix.size(), prefix) == 0) count++;
+    }
+    closedir(dir);
+    return count;
+}
+#endif
+
+/*
+ * The pool is a process wide singleton that can only be configured before
+ * the first render, so this test has its own executable.
+ */
+TEST(ThreadPoolTest, configuredThreads) {
+    rlottie::ThreadPoolConfig config;
+    config.threads = 2;
+    config.threadName = "rlottietest";
+    ASSERT_TRUE(rlottie::configureThreadPool(config));
+
+    std::string filePath = DEMO_DIR;
+    filePath +="1643-exploding-star.json";
+    auto animation = rlottie::Animation::loadFromFile(filePath);
+    ASSERT_TRUE(animation);
+    animation->setRenderBands(4);
+
+    size_t width = 200, height = 200;
+    std::vector<uint32_t> buffer(width * height);
+    rlottie::Surface surface(buffer.data(), width, height, width * 4);
+    for (size_t frame = 0; frame < animation->totalFrame(); frame += 10)
+        animation->render(frame, surface).get();
+
+#ifdef LOTTIE_THREAD_SUPPORT
+#if defined(__linux__)
+    // the render requests, the bands and the rle tasks all share the two
+    // configured workers.
+    ASSERT_EQ(namedThreads("rlottietest-"), 2u);
+#endif
+    // the pool is running, it can't be reconfigured anymore.
+    config.threads = 1;
+    ASSERT_FALSE(rlottie::configureThreadPool(config));
+#else
+    // without thread support everything ran on this thread.
+    ASSERT_TRUE(rlottie::configureThreadPool(config));
+#endif
+}
@@ -0,0 +1,278 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "vdrawhelper.h"
+
+using Simd = RenderFuncTable::Simd;
+
+class VDrawHelperTest : public ::testing::Test {
+public:
+    void SetUp()
+    {
+        std::mt19937 gen(7);
+        src.resize(size);
+        dest.resize(size);
+        // mix of transparent, opaque and random (not always premultiplied)
+        // pixels.
+        for (size_t i = 0; i < size; i++) {
+            switch (gen() % 4) {
+            case 0: src[i] = 0; break;
+            case 1: src[i] = gen() | 0xff000000; break;
+            default: src[i] = gen(); break;
+            }
+            dest[i] = gen();
+        }
+        // opaque entries that keep their own index.
+        for (size_t i = 0; i < colorTable.size(); i++)
+            colorTable[i] = 0xff000000 | uint32_t(i);
+    }
+
+    void compare(Simd simd)
+    {
+        RenderFuncTable scalar(Simd::None);
+        RenderFuncTable table(simd);
+
+        const BlendMode modes[] = {BlendMode::Src, BlendMode::SrcOver,
+                                   BlendMode::DestIn, BlendMode::DestOut};
+        const uint32_t alphas[] = {0, 1, 127, 128, 254, 255};
+        const uint32_t colors[] = {0, 0xff000000, 0x80402010, 0xffffffff};
+
+        for (auto mode : modes) {
+            for (auto alpha : alphas) {
+                // odd offsets and lengths to hit the unaligned and tail paths
+                for (int offset = 0; offset < 3; offset++) {
+                    for (int length = 0; length < 70; length++) {
+                        SCOPED_TRACE(testing::Message()
+                                     << "mode " << int(mode) << " alpha "
+                                     << alpha << " offset " << offset
+                                     << " length " << length);
+                        auto expected = dest;
+                        auto result = dest;
+                        scalar.src(mode)(&expected[offset], length,
+                                         &src[offset + 1], alpha);
+                        table.src(mode)(&result[offset], length,
+                                        &src[offset + 1], alpha);
+                        ASSERT_EQ(expected, result);
+
+                        for (auto color : colors) {
+                            expected = dest;
+                            result = dest;
+                            scalar.color(mode)(&expected[offset], length,
+                                               color, alpha);
+                            table.color(mode)(&result[offset], length, color,
+                                              alpha);
+                            ASSERT_EQ(expected, result);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void compareGradient(Simd simd)
+    {
+        RenderFuncTable scalar(Simd::None);
+        RenderFuncTable table(simd);
+
+        VGradientData gradient;
+        gradient.mColorTable = colorTable.data();
+        gradient.radial.fradius = 0.25f;
+
+        const VGradient::Spread spreads[] = {VGradient::Spread::Pad,
+                                             VGradient::Spread::Repeat,
+                                             VGradient::Spread::Reflect};
+        // fixed point start and step, crossing both ends of the table.
+        const int linear[][2] = {{0, 256},         {-70000, 9000},
+                                 {600000, -12345}, {-5000000, 700001},
+                                 {128, 1},         {262016, -3}};
+        // det, delta det, delta delta det, b, delta b
+        const float radial[][5] = {{0.3f, 0.01f, 0.0005f, -0.2f, 0.02f},
+                                   {-0.5f, 0.07f, 0.002f, 0.4f, -0.03f},
+                                   {40.0f, -1.3f, 0.01f, -5.0f, 0.11f},
+                                   {1e-3f, 1e-4f, 1e-6f, 3.0f, -0.2f}};
+
+        for (auto spread : spreads) {
+            gradient.mSpread = spread;
+            for (int length = 0; length < 70; length++) {
+                for (auto &l : linear) {
+                    SCOPED_TRACE(testing::Message()
+                                 << "spread " << int(spread) << " length "
+                                 << length << " linear " << l[0]);
+                    auto expected = dest;
+                    auto result = dest;
+                    scalar.linearGradient()(&expected[1], length, &gradient,
+                                            l[0], l[1]);
+                    table.linearGradient()(&result[1], length, &gradient, l[0],
+                                           l[1]);
+                    ASSERT_EQ(expected, result);
+                }
+                for (auto &r : radial) {
+                    for (bool extended : {false, true}) {
+                        SCOPED_TRACE(testing::Message()
+                                     << "spread " << int(spread) << " length "
+                                     << length << " radial " << r[0]
+                                     << " extended " << extended);
+                        RadialGradientValues v{};
+                        v.dr = -0.1f;
+                        v.extended = extended;
+                        auto expected = dest;
+                        auto result = dest;
+                        scalar.radialGradient()(&expected[1], length,
+                                                &gradient, &v, r[0], r[1],
+                                                r[2], r[3], r[4]);
+                        table.radialGradient()(&result[1], length, &gradient,
+                                               &v, r[0], r[1], r[2], r[3],
+                                               r[4]);
+                        // the lanes round differently, allow the
+                        // neighbouring table entry.
+                        for (size_t i = 0; i < size; i++) {
+                            int d = std::abs(int(expected[i] & 0xffffff) -
+                                             int(result[i] & 0xffffff));
+                            ASSERT_EQ(expected[i] >> 24, result[i] >> 24) << i;
+                            ASSERT_LE(std::min(d, VGradient::colorTableSize - d), 1)
+                                << i;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void compareImage(Simd simd)
+    {
+        RenderFuncTable scalar(Simd::None);
+        RenderFuncTable table(simd);
+
+        VBitmap image(13, 11, VBitmap::Format::ARGB32_Premultiplied);
+        std::mt19937 gen(11);
+        for (size_t y = 0; y < image.height(); y++) {
+            auto line = reinterpret_cast<uint32_t *>(image.data() +
+                                                     y * image.stride());
+            for (size_t x = 0; x < image.width(); x++) line[x] = gen();
+        }
+
+        VTextureData texture;
+        texture.prepare(&image);
+        // full image and a source rect inside it.
+        const VRect clips[] = {image.rect(), VRect(2, 3, 7, 5)};
+        // 16.16 start and step, stepping out of the image on every side.
+        const int steps[][4] = {{-3 * 65536, -2 * 65536, 20000, 15000},
+                                {13 * 65536, 12 * 65536, -30000, -9000},
+                                {5 * 65536, 0, 65536, 4000},
+                                {-100000, 700000, 4321, -1234}};
+
+        for (auto &clip : clips) {
+            texture.setClip(clip);
+            for (int length = 0; length < 70; length++) {
+                for (auto &p : steps) {
+                    SCOPED_TRACE(testing::Message()
+                                 << "length " << length << " x " << p[0]);
+                    auto expected = dest;
+                    auto result = dest;
+                    scalar.nearestImage()(&expected[1], length, &texture,
+                                          p[0], p[1], p[2], p[3]);
+                    table.nearestImage()(&result[1], length, &texture, p[0],
+                                         p[1], p[2], p[3]);
+                    ASSERT_EQ(expected, result);
+
+                    expected = dest;
+                    result = dest;
+                    scalar.bilinearImage()(&expected[1], length, &texture,
+                                           p[0], p[1], p[2], p[3]);
+                    table.bilinearImage()(&result[1], length, &texture, p[0],
+                                          p[1], p[2], p[3]);
+                    ASSERT_EQ(expected, result);
+                }
+            }
+        }
+    }
+
+public:
+    const size_t          size{80};
+    std::vector<uint32_t> src;
+    std::vector<uint32_t> dest;
+    std::array<uint32_t, VGradient::colorTableSize> colorTable;
+};
+
+TEST_F(VDrawHelperTest, neonGradient)
+{
+    if (RenderFuncTable::supportedSimd() != Simd::Neon) return;
+    compareGradient(Simd::Neon);
+}
+
+TEST_F(VDrawHelperTest, sse4Gradient)
+{
+    if (RenderFuncTable::supportedSimd() < Simd::Sse4) return;
+    compareGradient(Simd::Sse4);
+}
+
+TEST_F(VDrawHelperTest, avx2)
+{
+    if (RenderFuncTable::supportedSimd() < Simd::Avx2) return;
+    compare(Simd::Avx2);
+}
+
+TEST_F(VDrawHelperTest, avx2Gradient)
+{
+    if (RenderFuncTable::supportedSimd() < Simd::Avx2) return;
+    compareGradient(Simd::Avx2);
+}
+
+TEST_F(VDrawHelperTest, avx2Image)
+{
+    if (RenderFuncTable::supportedSimd() < Simd::Avx2) return;
+    compareImage(Simd::Avx2);
+}
+
+TEST_F(VDrawHelperTest, avx512)
+{
+    if (RenderFuncTable::supportedSimd() < Simd::Avx512) return;
+    compare(Simd::Avx512);
+}
+
+TEST_F(VDrawHelperTest, avx512Gradient)
+{
+    if (RenderFuncTable::supportedSimd() < Simd::Avx512) return;
+    compareGradient(Simd::Avx512);
+}
+
+TEST_F(VDrawHelperTest, premultiply)
+{
+    // every color and alpha pair, the rgb channels are rotated so each of
+    // them sees all values.
+    std::vector<uint8_t> rgba;
+    std::vector<uint32_t> expected;
+    for (uint32_t a = 0; a < 256; a++) {
+        for (uint32_t c = 0; c < 256; c++) {
+            uint32_t r = c, g = (c + 85) & 0xff, b = (c + 170) & 0xff;
+            rgba.insert(rgba.end(), {uint8_t(r), uint8_t(g), uint8_t(b),
+                                     uint8_t(a)});
+            expected.push_back(a << 24 | (r * a / 255) << 16 |
+                               (g * a / 255) << 8 | (b * a / 255));
+        }
+    }
+
+    // the table falls back to what the cpu supports.
+    const Simd simds[] = {Simd::None, Simd::Sse2, Simd::Avx2};
+    for (auto simd : simds) {
+        RenderFuncTable table(simd);
+        std::vector<uint32_t> result(expected.size());
+        table.premultiplyImage()(result.data(), rgba.data(),
+                                 int(result.size()));
+        ASSERT_EQ(expected, result);
+
+        // lengths that leave a tail, dest is not written past the end.
+        for (int length = 0; length < 40; length++) {
+            SCOPED_TRACE(testing::Message() << "length " << length);
+            result.assign(42, 0xdeadbeef);
+            table.premultiplyImage()(&result[1], &rgba[4 * 1000], length);
+            for (int i = 0; i < 42; i++) {
+                uint32_t want = (i >= 1 && i <= length) ? expected[999 + i]
+                                                        : 0xdeadbeef;
+                ASSERT_EQ(want, result[i]);
+            }
+        }
+    }
+}
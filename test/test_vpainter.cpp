@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "vpainter.h"
+
+class VPainterTest : public ::testing::Test {
+public:
+    static constexpr size_t size = 8;
+
+    // opaque pixels that keep their own position in the blue channel, far
+    // enough apart to survive the rounding of the blend.
+    static std::vector<uint32_t> pattern()
+    {
+        std::vector<uint32_t> pixels(size * size);
+        for (size_t i = 0; i < pixels.size(); i++)
+            pixels[i] = 0xff000000 | uint32_t(i * 4);
+        return pixels;
+    }
+};
+
+TEST_F(VPainterTest, drawBitmapSourceOffset) {
+    auto    src = pattern();
+    VBitmap source(reinterpret_cast<uint8_t *>(src.data()), size, size,
+                   size * 4, VBitmap::Format::ARGB32_Premultiplied);
+
+    std::vector<uint32_t> dst(size * size);
+    VBitmap target(reinterpret_cast<uint8_t *>(dst.data()), size, size,
+                   size * 4, VBitmap::Format::ARGB32_Premultiplied);
+
+    VPainter painter(&target);
+    painter.drawBitmap(VRect(4, 3, 3, 2), source, VRect(1, 2, 3, 2));
+    painter.end();
+
+    for (int y = 0; y < int(size); y++) {
+        for (int x = 0; x < int(size); x++) {
+            bool inside = x >= 4 && x < 7 && y >= 3 && y < 5;
+            auto pixel = dst[size_t(y) * size + size_t(x)];
+            if (!inside) {
+                ASSERT_EQ(pixel, 0u) << "pixel " << x << "," << y;
+                continue;
+            }
+            // target (4, 3) maps to source (1, 2)
+            auto expected = src[size_t((y - 1) * int(size) + x - 3)];
+            ASSERT_NEAR(int(pixel & 0xff), int(expected & 0xff), 1)
+                << "pixel " << x << "," << y;
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+#include "vrle.h"
+
+class VRleTest : public ::testing::Test {
+public:
+    static constexpr int width = 1600;
+    static constexpr int height = 8;
+
+    // rle of the given spans, in y then x order.
+    static VRle rle(const std::vector<VRle::Span> &spans)
+    {
+        VRle result;
+        result.addSpan(spans.data(), spans.size());
+        return result;
+    }
+
+    // coverage of every pixel, the spans have to come in y order.
+    static std::vector<int> coverage(const VRle &rle)
+    {
+        struct Canvas {
+            std::vector<int> pixels = std::vector<int>(width * height);
+            int              lastY{0};
+            bool             sorted{true};
+        } canvas;
+
+        rle.intersect(
+            VRect(0, 0, width, height),
+            [](size_t count, const VRle::Span *spans, void *userData) {
+                auto canvas = static_cast<Canvas *>(userData);
+                for (size_t i = 0; i < count; i++) {
+                    const auto &span = spans[i];
+                    if (span.y < canvas->lastY) canvas->sorted = false;
+                    canvas->lastY = span.y;
+                    for (int x = span.x; x < span.x + span.len; x++)
+                        canvas->pixels[span.y * width + x] += span.coverage;
+                }
+            },
+            &canvas);
+        EXPECT_TRUE(canvas.sorted);
+        return canvas.pixels;
+    }
+
+    template <typename Op>
+    static void check(const VRle &a, const VRle &b, const VRle &result, Op op)
+    {
+        auto ca = coverage(a);
+        auto cb = coverage(b);
+        auto cr = coverage(result);
+        for (size_t i = 0; i < cr.size(); i++)
+            ASSERT_NEAR(cr[i], op(ca[i], cb[i]), 1) << "pixel " << i;
+    }
+
+    static int add(int a, int b) { return int(std::lround(b + (255 - b) * a / 255.0)); }
+    static int substract(int a, int b) { return int(std::lround(a * (255 - b) / 255.0)); }
+};
+
+TEST_F(VRleTest, sideBySide) {
+    // the bounding rects don't intersect but the rows do.
+    VRle a = rle({{0, 0, 10, 255}, {0, 1, 10, 255}, {0, 2, 10, 100}});
+    VRle b = rle({{20, 1, 10, 255}, {20, 2, 10, 50}, {20, 3, 10, 255}});
+    check(a, b, a + b, add);
+    check(a, b, a - b, substract);
+}
+
+TEST_F(VRleTest, wideRow) {
+    VRle a = rle({{0, 0, 1500, 128}, {0, 1, 1500, 128}});
+    VRle b = rle({{1200, 0, 200, 200}, {1200, 1, 200, 200}});
+    check(a, b, a + b, add);
+    check(a, b, a - b, substract);
+}
+
+TEST_F(VRleTest, manySpans) {
+    std::vector<VRle::Span> stripes;
+    for (short y = 0; y < 2; y++)
+        for (short x = 0; x < 1200; x += 2) stripes.push_back({x, y, 1, 255});
+    VRle a = rle(stripes);
+    VRle b = rle({{100, 0, 700, 128}, {100, 1, 700, 128}});
+    check(a, b, a + b, add);
+    check(a, b, a - b, substract);
+}
+
+TEST_F(VRleTest, intersectBoundingRect) {
+    VRle a = rle({{0, 1, 40, 255}, {0, 2, 40, 255}, {0, 3, 40, 255}});
+    VRle b = rle({{10, 2, 10, 255}, {10, 3, 10, 255}, {10, 4, 10, 255}});
+    ASSERT_EQ((a & b).boundingRect(), VRect(10, 2, 10, 2));
+    ASSERT_EQ((VRect(5, 0, 10, 2) & a).boundingRect(), VRect(5, 1, 10, 1));
+    a &= b;
+    ASSERT_EQ(a.boundingRect(), VRect(10, 2, 10, 2));
+}
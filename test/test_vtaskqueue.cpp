@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "vtaskqueue.h"
+
+class VTaskQueueTest : public ::testing::Test {
+public:
+    static constexpr int threads = 4;
+
+    // every value in [0, count) has to be taken exactly once.
+    static void check(std::vector<std::vector<int64_t>> &taken, int64_t count)
+    {
+        std::vector<int64_t> all;
+        for (auto &list : taken) all.insert(all.end(), list.begin(), list.end());
+        std::sort(all.begin(), all.end());
+        ASSERT_EQ(all.size(), size_t(count));
+        for (int64_t i = 0; i < count; i++) ASSERT_EQ(all[size_t(i)], i);
+    }
+};
+
+TEST_F(VTaskQueueTest, dequePushPopSteal) {
+    // the owner pushes in bursts that make the ring grow and pops some of
+    // them back while the other threads steal from the top.
+    const int64_t                      count = 200000;
+    WorkStealingDeque<int64_t>         deque;
+    std::vector<std::vector<int64_t>> taken(threads + 1);
+    std::atomic<bool>                  done{false};
+
+    std::vector<std::thread> stealers;
+    for (int t = 0; t < threads; t++) {
+        stealers.emplace_back([&, t] {
+            int64_t v;
+            while (true) {
+                if (deque.steal(v)) {
+                    taken[size_t(t)].push_back(v);
+                } else if (done.load()) {
+                    // the owner drained the rest.
+                    break;
+                }
+            }
+        });
+    }
+
+    auto &own = taken[threads];
+    for (int64_t i = 0; i < count;) {
+        int64_t burst = std::min<int64_t>(count - i, 1 + i % 300);
+        for (int64_t n = 0; n < burst; n++) deque.push(i++);
+        int64_t v;
+        for (int64_t n = 0; n < burst / 2 && deque.pop(v); n++)
+            own.push_back(v);
+    }
+    int64_t v;
+    while (deque.pop(v)) own.push_back(v);
+    done.store(true);
+    for (auto &t : stealers) t.join();
+
+    check(taken, count);
+}
+
+TEST_F(VTaskQueueTest, injectionQueue) {
+    // more values than the ring holds, so some go through the overflow list.
+    const int64_t                      perThread = 5000;
+    const int64_t                      count = perThread * threads;
+    InjectionQueue<int64_t>            queue;
+    std::vector<std::vector<int64_t>> taken(threads);
+    std::atomic<int64_t>               left{count};
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            for (int64_t i = 0; i < perThread; i++)
+                queue.push(t * perThread + i);
+        });
+        workers.emplace_back([&, t] {
+            int64_t v;
+            while (left.load() > 0) {
+                if (queue.pop(v)) {
+                    taken[size_t(t)].push_back(v);
+                    left--;
+                }
+            }
+        });
+    }
+    for (auto &t : workers) t.join();
+
+    int64_t v;
+    ASSERT_FALSE(queue.pop(v));
+    check(taken, count);
+}
+
+TEST_F(VTaskQueueTest, scheduler) {
+    // tasks pushed from outside fan out into tasks pushed by the workers.
+    using Task = std::function<void()>;
+    const int            outer = 2000, inner = 8;
+    std::atomic<int>     ran{0};
+    TaskScheduler<Task>  pool(threads);
+    pool.start([&](unsigned i) {
+        Task task;
+        while (pool.next(i, task)) {
+            task();
+            task = nullptr;
+        }
+    });
+
+    for (int round = 0; round < 3; round++) {
+        ran.store(0);
+        for (int i = 0; i < outer; i++) {
+            pool.push([&] {
+                for (int n = 0; n < inner; n++) pool.push([&] { ran++; });
+                ran++;
+            });
+        }
+        while (ran.load() != outer * (inner + 1)) std::this_thread::yield();
+    }
+    pool.stop();
+    ASSERT_EQ(ran.load(), outer * (inner + 1));
+}